@@ -1,46 +1,37 @@
+#include "lox/syntax/source.hpp"
 #include "lox/vm/vm.hpp"
 
 #include <spdlog/cfg/env.h>
 
-#include <format>
-#include <fstream>
-#include <iterator>
+#include <cstdio>
 #include <print>
-#include <stdexcept>
-#include <string>
-
-/**
- *
- * @param filename The path to the file to read.
- * @return A string containing the file's contents.
- */
-static auto read_to_string(std::string_view filename) -> std::string {
-    const std::string filename_str(filename);
-    std::ifstream file{filename_str, std::ios::binary};
-    if (!file.is_open()) {
-        throw std::runtime_error(std::format("Failed to open file {}", filename_str));
-    }
-
-    // Read the file into a string.
-    const std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-
-    file.close();
-
-    return contents;
-}
 
 auto main(const int argc, const char *argv[]) noexcept -> int {
     spdlog::cfg::load_env_levels();
 
     if (argc != 2) {
-        std::println("Usage: clox <script>");
+        std::println("Usage: clox <script>  (use - to read the script from stdin)");
         return 64;
     }
 
-    lox::vm::VirtualMachine vm;
+    // Declared before the VM so that loaded scripts outlive the code compiled from them.
+    lox::syntax::SourceManager sources;
 
     // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-    auto source = read_to_string(argv[1]);
+    const auto file = sources.load(argv[1]);
+    if (!file) {
+        std::println(stderr, "{}", file.error());
+        return 74;
+    }
 
-    std::println("{}", lox::vm::interpret_result_to_string(vm.interpret(source)));
+    lox::vm::VirtualMachine vm;
+    switch (vm.interpret(*file.value())) {
+    case lox::vm::InterpretResult::ok:
+        return 0;
+    case lox::vm::InterpretResult::compile_error:
+        return 65;
+    case lox::vm::InterpretResult::runtime_error:
+        return 70;
+    }
+    return 70;
 }
@@ -0,0 +1,130 @@
+#include "lox/ast/parse.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <format>
+#include <new>
+#include <print>
+#include <string>
+#include <utility>
+
+namespace {
+
+    std::size_t allocation_count = 0;
+    std::size_t live_bytes = 0;
+
+    // Every block carries its size in a header so frees can be subtracted from the live total.
+    constexpr std::size_t header_size = alignof(std::max_align_t);
+
+} // namespace
+
+auto operator new(const std::size_t size) -> void * {
+    auto *block = static_cast<std::byte *>(std::malloc(size + header_size));
+    if (block == nullptr) {
+        throw std::bad_alloc{};
+    }
+    *reinterpret_cast<std::size_t *>(block) = size;
+    ++allocation_count;
+    live_bytes += size;
+    return block + header_size;
+}
+
+auto operator new[](const std::size_t size) -> void * { return operator new(size); }
+
+void operator delete(void *ptr) noexcept {
+    if (ptr == nullptr) {
+        return;
+    }
+    auto *block = static_cast<std::byte *>(ptr) - header_size;
+    live_bytes -= *reinterpret_cast<std::size_t *>(block);
+    std::free(block);
+}
+
+void operator delete[](void *ptr) noexcept { operator delete(ptr); }
+void operator delete(void *ptr, std::size_t /*size*/) noexcept { operator delete(ptr); }
+void operator delete[](void *ptr, std::size_t /*size*/) noexcept { operator delete(ptr); }
+
+/**
+ * @brief Builds an expression-heavy script of roughly @p target_bytes bytes.
+ */
+static auto make_corpus(const std::size_t target_bytes) -> std::string {
+    std::string source;
+    source.reserve(target_bytes + 256);
+
+    for (std::size_t i = 0; source.size() < target_bytes; ++i) {
+        source += std::format("var r{0} = (a + b * c - d / (e + {0})) * -g + h(i, j * 2) >= k and l != m or !n;\n"
+                              "r{0} = r{0} * (1 + 2 * (3 + 4 * (5 + 6 * (7 + 8)))) - x / y / z;\n",
+                              i);
+    }
+
+    return source;
+}
+
+auto main() -> int {
+    spdlog::set_level(spdlog::level::warn);
+
+    constexpr std::size_t corpus_bytes = 4 * 1024 * 1024;
+    constexpr int iterations = 5;
+    constexpr int constructions = 100'000;
+
+    const auto source = make_corpus(corpus_bytes);
+    const auto megabytes = static_cast<double>(source.size()) / (1024.0 * 1024.0);
+
+    std::size_t statements = 0;
+    std::size_t allocations = 0;
+    std::size_t tree_bytes = 0;
+    std::size_t arena_used = 0;
+    std::size_t arena_reserved = 0;
+    std::chrono::duration<double> best{std::chrono::duration<double>::max()};
+    std::chrono::duration<double> best_free{std::chrono::duration<double>::max()};
+    for (int iteration = 0; iteration < iterations; ++iteration) {
+        const auto allocations_before = allocation_count;
+        const auto live_before = live_bytes;
+        const auto start = std::chrono::steady_clock::now();
+
+        auto parser = lox::ast::Parser(source);
+        auto program = parser.parse();
+        if (!program) {
+            std::println("Parse error: {}", program.error());
+            return EXIT_FAILURE;
+        }
+
+        const auto parsed = std::chrono::steady_clock::now();
+        best = std::min<std::chrono::duration<double>>(best, parsed - start);
+        allocations = allocation_count - allocations_before;
+        tree_bytes = live_bytes - live_before;
+        statements = program->size();
+        arena_used = program->arena().bytes_used();
+        arena_reserved = program->arena().bytes_reserved();
+
+        {
+            const auto discarded = std::move(program.value());
+        }
+        best_free = std::min<std::chrono::duration<double>>(best_free, std::chrono::steady_clock::now() - parsed);
+    }
+
+    std::println("parse: {:.2f} MiB, {} statements", megabytes, statements);
+    std::println("parse: best of {}: {:.3f} ms, {:.1f} MiB/s", iterations, best.count() * 1000.0,
+                 megabytes / best.count());
+    std::println("parse: {} allocations, {:.1f} MiB live after parse, {:.3f} ms to free", allocations,
+                 static_cast<double>(tree_bytes) / (1024.0 * 1024.0), best_free.count() * 1000.0);
+    std::println("parse: arena {:.1f} MiB used of {:.1f} MiB reserved",
+                 static_cast<double>(arena_used) / (1024.0 * 1024.0),
+                 static_cast<double>(arena_reserved) / (1024.0 * 1024.0));
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < constructions; ++i) {
+        auto parser = lox::ast::Parser("1;");
+        if (!parser.parse()) {
+            return EXIT_FAILURE;
+        }
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::println("parse: construct + parse trivial input: {:.1f} ns", elapsed.count() * 1e9 / constructions);
+
+    return EXIT_SUCCESS;
+}
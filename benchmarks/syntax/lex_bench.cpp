@@ -0,0 +1,143 @@
+#include "lox/syntax/lex.hpp"
+#include "lox/syntax/scan_kernels.hpp"
+#include "lox/syntax/token.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <format>
+#include <new>
+#include <optional>
+#include <print>
+#include <string>
+#include <utility>
+
+namespace {
+
+    std::size_t allocation_count = 0;
+
+} // namespace
+
+// Count every heap allocation made by the process so the benchmark can report allocations per token.
+auto operator new(const std::size_t size) -> void * {
+    ++allocation_count;
+    if (void *ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc{};
+}
+
+auto operator new[](const std::size_t size) -> void * { return operator new(size); }
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t /*size*/) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::size_t /*size*/) noexcept { std::free(ptr); }
+
+/**
+ * @brief Builds a synthetic script of roughly @p target_bytes bytes that exercises every token class.
+ */
+static auto make_corpus(const std::size_t target_bytes) -> std::string {
+    std::string source;
+    source.reserve(target_bytes + 256);
+
+    for (std::size_t i = 0; source.size() < target_bytes; ++i) {
+        source += std::format("var generated_value_{0} = {0}.25 * (loop_counter_{0} + 17) - other_value / 3;\n"
+                              "if (generated_value_{0} <= upper_limit and !done) {{\n"
+                              "        print \"generated iteration number {0} of the benchmark corpus\";\n"
+                              "}}\n"
+                              "while (generated_value_{0} != 0) generated_value_{0} = generated_value_{0} - 1;\n",
+                              i);
+    }
+
+    return source;
+}
+
+/**
+ * @brief Builds a data-table style script dominated by long runs: deep indentation, long identifiers and long string
+ * literals, as emitted by our code generators.
+ */
+static auto make_long_run_corpus(const std::size_t target_bytes) -> std::string {
+    std::string source;
+    source.reserve(target_bytes + 512);
+
+    const std::string indent(24, ' ');
+    const std::string text(160, 'x');
+    for (std::size_t i = 0; source.size() < target_bytes; ++i) {
+        source += std::format("{{\n{0}var generated_table_entry_with_a_descriptive_name_{1} = \"{2}\";\n"
+                              "{0}print generated_table_entry_with_a_descriptive_name_{1};\n}}\n",
+                              indent, i, text);
+    }
+
+    return source;
+}
+
+struct LexResult {
+    std::size_t tokens = 0;
+    std::size_t allocations = 0;
+    std::chrono::duration<double> best{std::chrono::duration<double>::max()};
+};
+
+static auto lex_corpus(const std::string &source, const lox::syntax::ScanKernels &kernels, const int iterations)
+    -> std::optional<LexResult> {
+    LexResult result;
+
+    for (int iteration = 0; iteration < iterations; ++iteration) {
+        result.tokens = 0;
+        const auto allocations_before = allocation_count;
+        const auto start = std::chrono::steady_clock::now();
+
+        auto scanner = lox::syntax::Scanner(source, kernels);
+        while (true) {
+            const auto token = scanner.get_next_token();
+            if (!token.has_value()) {
+                std::println("Lexing error: {}", token.error());
+                return std::nullopt;
+            }
+            ++result.tokens;
+            if (token->kind == lox::syntax::TokenKind::end_of_file) {
+                break;
+            }
+        }
+
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        result.allocations = allocation_count - allocations_before;
+        result.best = std::min<std::chrono::duration<double>>(result.best, elapsed);
+    }
+
+    return result;
+}
+
+auto main() -> int {
+    spdlog::set_level(spdlog::level::warn);
+
+    constexpr std::size_t corpus_bytes = 8 * 1024 * 1024;
+    constexpr int iterations = 5;
+
+    const std::pair<const char *, std::string> corpora[] = {
+        {"code", make_corpus(corpus_bytes)},
+        {"long-runs", make_long_run_corpus(corpus_bytes)},
+    };
+
+    for (const auto &[corpus_name, source] : corpora) {
+        const auto megabytes = static_cast<double>(source.size()) / (1024.0 * 1024.0);
+
+        for (const auto *kernels : {&lox::syntax::scalar_scan_kernels(), &lox::syntax::best_scan_kernels()}) {
+            const auto result = lex_corpus(source, *kernels, iterations);
+            if (!result) {
+                return EXIT_FAILURE;
+            }
+
+            std::println("lex[{}/{}]: {:.2f} MiB, {} tokens, {} allocations ({:.4f}/token)", corpus_name,
+                         kernels->name, megabytes, result->tokens, result->allocations,
+                         static_cast<double>(result->allocations) / static_cast<double>(result->tokens));
+            std::println("lex[{}/{}]: best of {}: {:.3f} ms, {:.1f} MiB/s", corpus_name, kernels->name, iterations,
+                         result->best.count() * 1000.0, megabytes / result->best.count());
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
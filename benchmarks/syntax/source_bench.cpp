@@ -0,0 +1,106 @@
+#include "lox/syntax/line_index.hpp"
+#include "lox/syntax/scan_kernels.hpp"
+#include "lox/syntax/source.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <print>
+#include <string>
+
+/**
+ * @brief The loader the interpreter used before SourceManager: copies the file one character at a time.
+ */
+static auto read_to_string(const std::filesystem::path &path) -> std::string {
+    std::ifstream file{path, std::ios::binary};
+    return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+}
+
+/**
+ * @brief Touches one byte per page so that mapped files are charged for faulting their pages in.
+ */
+static auto checksum(const std::string_view text) -> std::size_t {
+    std::size_t sum = 0;
+    for (std::size_t i = 0; i < text.size(); i += 4096) {
+        sum += static_cast<unsigned char>(text[i]);
+    }
+    return sum;
+}
+
+auto main() -> int {
+    spdlog::set_level(spdlog::level::warn);
+
+    constexpr std::size_t script_bytes = 64 * 1024 * 1024;
+    constexpr int iterations = 5;
+
+    const auto path = std::filesystem::temp_directory_path() / "lox_source_bench.lox";
+    {
+        std::ofstream out{path, std::ios::binary};
+        for (std::size_t i = 0, written = 0; written < script_bytes; ++i) {
+            const auto line = std::format("var generated_value_{0} = {0} * 3 + other_value;\n", i);
+            out << line;
+            written += line.size();
+        }
+    }
+    const auto megabytes = static_cast<double>(std::filesystem::file_size(path)) / (1024.0 * 1024.0);
+
+    std::chrono::duration<double> best_copy{std::chrono::duration<double>::max()};
+    std::chrono::duration<double> best_load{std::chrono::duration<double>::max()};
+    std::size_t sums[2] = {};
+
+    for (int iteration = 0; iteration < iterations; ++iteration) {
+        const auto copy_start = std::chrono::steady_clock::now();
+        const auto copied = read_to_string(path);
+        sums[0] = checksum(copied);
+        best_copy = std::min<std::chrono::duration<double>>(best_copy, std::chrono::steady_clock::now() - copy_start);
+
+        const auto load_start = std::chrono::steady_clock::now();
+        lox::syntax::SourceManager sources;
+        const auto file = sources.load(path.string());
+        if (!file) {
+            std::println("Load error: {}", file.error());
+            return EXIT_FAILURE;
+        }
+        sums[1] = checksum(file.value()->text());
+        best_load = std::min<std::chrono::duration<double>>(best_load, std::chrono::steady_clock::now() - load_start);
+    }
+
+    lox::syntax::SourceManager sources;
+    const auto file = sources.load(path.string());
+    std::filesystem::remove(path);
+    if (!file) {
+        std::println("Load error: {}", file.error());
+        return EXIT_FAILURE;
+    }
+
+    if (sums[0] != sums[1]) {
+        std::println("Loaded contents differ from the copied file");
+        return EXIT_FAILURE;
+    }
+
+    std::println("source: {:.2f} MiB script", megabytes);
+    std::println("source: istreambuf_iterator copy: best of {}: {:.3f} ms", iterations, best_copy.count() * 1000.0);
+    std::println("source: SourceManager::load:      best of {}: {:.3f} ms", iterations, best_load.count() * 1000.0);
+
+    for (const auto *kernels : {&lox::syntax::scalar_scan_kernels(), &lox::syntax::best_scan_kernels()}) {
+        std::size_t line_count = 0;
+        std::chrono::duration<double> best{std::chrono::duration<double>::max()};
+        for (int iteration = 0; iteration < iterations; ++iteration) {
+            const auto start = std::chrono::steady_clock::now();
+            const lox::syntax::LineIndex lines{file.value()->text(), *kernels};
+            best = std::min<std::chrono::duration<double>>(best, std::chrono::steady_clock::now() - start);
+            line_count = lines.line_count();
+        }
+        std::println("source: line index[{}]: {} lines, best of {}: {:.3f} ms, {:.1f} MiB/s", kernels->name,
+                     line_count, iterations, best.count() * 1000.0, megabytes / best.count());
+    }
+
+    return EXIT_SUCCESS;
+}
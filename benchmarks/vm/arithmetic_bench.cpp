@@ -0,0 +1,59 @@
+#include "lox/vm/vm.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <format>
+#include <print>
+#include <string>
+#include <string_view>
+
+namespace {
+
+    constexpr std::size_t iterations = 5'000'000;
+
+    /// Wraps @p body in a function so the loop runs on locals, the case the operand stack matters most for.
+    auto make_loop(const std::string_view body) -> std::string {
+        return std::format("fun run() {{\n"
+                           "    var a = 0; var b = 1; var c = 0.5;\n"
+                           "    for (var i = 0; i < {}; i = i + 1) {{\n"
+                           "        {}\n"
+                           "    }}\n"
+                           "    return a + b + c;\n"
+                           "}}\n"
+                           "print run();\n",
+                           iterations, body);
+    }
+
+    auto run(const std::string_view label, const std::string &source) -> bool {
+        auto *const out = std::tmpfile();
+        lox::vm::VirtualMachine vm{out};
+
+        const auto start = std::chrono::steady_clock::now();
+        const auto result = vm.interpret(source);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::fclose(out);
+
+        if (result != lox::vm::InterpretResult::ok) {
+            std::println("arithmetic: {} failed: {}", label, lox::vm::interpret_result_to_string(result));
+            return false;
+        }
+        std::println("arithmetic: {:<22} {:8.2f} ms ({:.2f} ns per iteration)", label, elapsed.count() * 1000.0,
+                     elapsed.count() * 1e9 / static_cast<double>(iterations));
+        return true;
+    }
+
+} // namespace
+
+auto main() -> int {
+    spdlog::set_level(spdlog::level::warn);
+
+    const auto ok = run("sum", make_loop("a = a + i;")) &&
+                    run("mixed operators", make_loop("a = a + i * 2 - i / 4; b = -b;")) &&
+                    run("polynomial", make_loop("c = ((c * 0.5 + 3) * c - 2 * c + 1) / (c * c + 1);")) &&
+                    run("comparisons", make_loop("if (i < a == (b > c)) a = a + 1; else b = b - 1;"));
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,76 @@
+#include "lox/vm/compile.hpp"
+#include "lox/vm/globals.hpp"
+#include "lox/vm/object.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <format>
+#include <print>
+#include <string>
+
+/**
+ * @brief Builds a statement-heavy script of roughly @p target_bytes bytes at top level, so it all lands in one chunk.
+ */
+static auto make_program(const std::size_t target_bytes) -> std::string {
+    std::string source;
+    source.reserve(target_bytes + 256);
+
+    for (std::size_t i = 0; source.size() < target_bytes; ++i) {
+        source += std::format("var v{0} = {0} * 2 + 1;\n"
+                              "if (v{0} > 10 and v{0} < 100000) {{\n"
+                              "    var t = v{0} - 3;\n"
+                              "    print t / 2;\n"
+                              "}} else {{\n"
+                              "    v{0} = -v{0};\n"
+                              "}}\n"
+                              "for (var j = 0; j < 3; j = j + 1) print j + v{0};\n",
+                              i % 1000);
+    }
+    return source;
+}
+
+auto main() -> int {
+    spdlog::set_level(spdlog::level::warn);
+
+    const auto source = make_program(std::size_t{4} * 1024 * 1024);
+
+    lox::vm::Heap heap;
+    lox::vm::Globals globals;
+    lox::vm::Compiler compiler{heap, globals};
+    const auto start = std::chrono::steady_clock::now();
+    const auto function = compiler.compile(source);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (!function) {
+        std::println("Compile error: {}", function.error());
+        return EXIT_FAILURE;
+    }
+
+    const auto &chunk = function.value()->chunk;
+    const auto code_bytes = chunk.code().size();
+    const auto per_byte_table = code_bytes * sizeof(std::size_t);
+    const auto encoded_table = chunk.source_map().memory_bytes();
+
+    // Touch every entry so a broken encoding shows up as a crash or a nonsense checksum rather than silently.
+    std::size_t checksum = 0;
+    const auto lookup_start = std::chrono::steady_clock::now();
+    for (std::size_t offset = 0; offset < code_bytes; offset += 997) {
+        checksum += chunk.source_map().source_offset(offset);
+    }
+    const std::chrono::duration<double> lookup_elapsed = std::chrono::steady_clock::now() - lookup_start;
+
+    const auto megabytes = static_cast<double>(source.size()) / (1024.0 * 1024.0);
+    std::println("chunk: {:.2f} MiB script compiled in {:.3f} ms", megabytes, elapsed.count() * 1000.0);
+    std::println("chunk: code {} bytes, {} constants", code_bytes, chunk.constants().size());
+    std::println("chunk: line table, one size_t per code byte: {} bytes ({:.2f} bytes per code byte)", per_byte_table,
+                 static_cast<double>(per_byte_table) / static_cast<double>(code_bytes));
+    std::println("chunk: line table, run-length source map:    {} bytes ({:.2f} bytes per code byte)", encoded_table,
+                 static_cast<double>(encoded_table) / static_cast<double>(code_bytes));
+    std::println("chunk: frozen chunk: {} bytes in one allocation", chunk.memory_bytes());
+    std::println("chunk: {} sampled lookups in {:.3f} ms (checksum {})", code_bytes / 997 + 1,
+                 lookup_elapsed.count() * 1000.0, checksum);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,58 @@
+#include "lox/vm/vm.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <print>
+#include <string_view>
+
+namespace {
+
+    /// Call-heavy: about 1.6M calls, each a compare, a branch and two subtractions.
+    constexpr std::string_view fib = "fun fib(n) { if (n < 2) return n; return fib(n - 1) + fib(n - 2); }\n"
+                                     "print fib(30);\n";
+
+    /// Nothing but the loop itself: a compare-and-jump, an increment and a backward jump per iteration.
+    constexpr std::string_view empty_loop = "fun run() { for (var i = 0; i < 10000000; i = i + 1) {} return 0; }\n"
+                                            "print run();\n";
+
+    /// Two nested loops over locals with a little arithmetic and a branch in the body.
+    constexpr std::string_view nested_loops = "fun run() {\n"
+                                              "    var hits = 0;\n"
+                                              "    for (var i = 0; i < 2000; i = i + 1) {\n"
+                                              "        for (var j = 0; j < 2000; j = j + 1) {\n"
+                                              "            if (i - j < 7) hits = hits + 1;\n"
+                                              "        }\n"
+                                              "    }\n"
+                                              "    return hits;\n"
+                                              "}\n"
+                                              "print run();\n";
+
+    auto run(const std::string_view label, const std::string_view source) -> bool {
+        auto *const out = std::tmpfile();
+        lox::vm::VirtualMachine vm{out};
+
+        const auto start = std::chrono::steady_clock::now();
+        const auto result = vm.interpret(source);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::fclose(out);
+
+        if (result != lox::vm::InterpretResult::ok) {
+            std::println("dispatch: {} failed: {}", label, lox::vm::interpret_result_to_string(result));
+            return false;
+        }
+        std::println("dispatch: {:<14} {:8.2f} ms", label, elapsed.count() * 1000.0);
+        return true;
+    }
+
+} // namespace
+
+auto main() -> int {
+    spdlog::set_level(spdlog::level::warn);
+
+    std::println("dispatch: {}", lox::vm::threaded_dispatch() ? "computed goto" : "switch");
+    const auto ok = run("fib(30)", fib) && run("empty loop", empty_loop) && run("nested loops", nested_loops);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,55 @@
+#include "lox/vm/object.hpp"
+#include "lox/vm/vm.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <print>
+#include <string_view>
+
+namespace {
+
+    /// Each iteration allocates a closure and the upvalue it captures, and drops both.
+    constexpr std::string_view closures = "for (var i = 0; i < 1000000; i = i + 1) {\n"
+                                          "    var x = i; fun f() { return x; } f();\n"
+                                          "}\n";
+
+    /// Builds a chain of 200k closures, each capturing the one before, so everything allocated stays reachable and
+    /// every collection has to mark a longer chain.
+    constexpr std::string_view chain = "var head = nil;\n"
+                                       "for (var i = 0; i < 200000; i = i + 1) {\n"
+                                       "    var previous = head; fun link() { return previous; } head = link;\n"
+                                       "}\n";
+
+    auto run(const std::string_view label, const std::string_view source, const lox::vm::GcSettings gc) -> bool {
+        auto *const out = std::tmpfile();
+        lox::vm::VirtualMachine vm{out, stderr, gc};
+
+        const auto start = std::chrono::steady_clock::now();
+        const auto result = vm.interpret(source);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::fclose(out);
+
+        if (result != lox::vm::InterpretResult::ok) {
+            std::println("gc: {} failed: {}", label, lox::vm::interpret_result_to_string(result));
+            return false;
+        }
+        const auto &stats = vm.heap_stats();
+        std::println("gc: {:<28} {:8.2f} ms ({} collections, peak {} KiB)", label, elapsed.count() * 1000.0,
+                     stats.collections, stats.peak_bytes / 1024);
+        return true;
+    }
+
+} // namespace
+
+auto main() -> int {
+    spdlog::set_level(spdlog::level::warn);
+
+    const lox::vm::GcSettings defaults{};
+    const lox::vm::GcSettings eager{.growth_factor = 1.5, .min_threshold = 64 * 1024};
+    const auto ok = run("closures", closures, defaults) && run("closures, eager", closures, eager) &&
+                    run("live chain", chain, defaults) && run("live chain, eager", chain, eager);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
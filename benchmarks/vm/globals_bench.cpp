@@ -0,0 +1,64 @@
+#include "lox/vm/vm.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <format>
+#include <print>
+#include <string>
+#include <string_view>
+
+namespace {
+
+    constexpr std::size_t iterations = 5'000'000;
+
+    /// A top-level loop in which every read and write is of a global, including the loop counter.
+    auto make_counter_loop(const std::size_t extra_globals) -> std::string {
+        std::string source;
+        // Unrelated globals grow the table the loop's names are looked up in.
+        for (std::size_t i = 0; i < extra_globals; ++i) {
+            source += std::format("var unused{} = {};\n", i, i);
+        }
+        source += std::format("var count = 0;\n"
+                              "var total = 0;\n"
+                              "var i = 0;\n"
+                              "while (i < {}) {{\n"
+                              "    count = count + 1;\n"
+                              "    total = total + count;\n"
+                              "    i = i + 1;\n"
+                              "}}\n"
+                              "print total;\n",
+                              iterations);
+        return source;
+    }
+
+    auto run(const std::string_view label, const std::string &source) -> bool {
+        auto *const out = std::tmpfile();
+        lox::vm::VirtualMachine vm{out};
+
+        const auto start = std::chrono::steady_clock::now();
+        const auto result = vm.interpret(source);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::fclose(out);
+
+        if (result != lox::vm::InterpretResult::ok) {
+            std::println("globals: {} failed: {}", label, lox::vm::interpret_result_to_string(result));
+            return false;
+        }
+        std::println("globals: {:<28} {:8.2f} ms ({:.2f} ns per iteration)", label, elapsed.count() * 1000.0,
+                     elapsed.count() * 1e9 / static_cast<double>(iterations));
+        return true;
+    }
+
+} // namespace
+
+auto main() -> int {
+    spdlog::set_level(spdlog::level::warn);
+
+    const auto ok = run("counter loop", make_counter_loop(0)) &&
+                    run("counter loop, 1000 globals", make_counter_loop(1000));
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
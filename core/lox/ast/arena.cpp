@@ -0,0 +1,51 @@
+#include "lox/ast/arena.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace lox::ast {
+
+    Arena::Arena(Arena &&other) noexcept
+        : m_blocks{std::move(other.m_blocks)}, m_cursor{std::exchange(other.m_cursor, nullptr)},
+          m_end{std::exchange(other.m_end, nullptr)}, m_bytes_used{std::exchange(other.m_bytes_used, 0)},
+          m_bytes_reserved{std::exchange(other.m_bytes_reserved, 0)} {}
+
+    auto Arena::operator=(Arena &&other) noexcept -> Arena & {
+        if (this != &other) {
+            m_blocks = std::move(other.m_blocks);
+            m_cursor = std::exchange(other.m_cursor, nullptr);
+            m_end = std::exchange(other.m_end, nullptr);
+            m_bytes_used = std::exchange(other.m_bytes_used, 0);
+            m_bytes_reserved = std::exchange(other.m_bytes_reserved, 0);
+        }
+        return *this;
+    }
+
+    auto Arena::allocate(const std::size_t size, const std::size_t alignment) -> void * {
+        // Oversized requests get a block of their own so they do not abandon the rest of the current block.
+        if (size > block_size / 2) {
+            auto &block = m_blocks.emplace_back(std::make_unique_for_overwrite<std::byte[]>(size + alignment));
+            m_bytes_reserved += size + alignment;
+            m_bytes_used += size;
+            const auto address = reinterpret_cast<std::uintptr_t>(block.get());
+            return block.get() + static_cast<std::size_t>(-address & (alignment - 1));
+        }
+
+        auto padding = static_cast<std::size_t>(-reinterpret_cast<std::uintptr_t>(m_cursor) & (alignment - 1));
+        if (m_cursor == nullptr || size + padding > static_cast<std::size_t>(m_end - m_cursor)) {
+            m_blocks.push_back(std::make_unique_for_overwrite<std::byte[]>(block_size));
+            m_cursor = m_blocks.back().get();
+            m_end = m_cursor + block_size;
+            m_bytes_reserved += block_size;
+            padding = static_cast<std::size_t>(-reinterpret_cast<std::uintptr_t>(m_cursor) & (alignment - 1));
+        }
+
+        auto *result = m_cursor + padding;
+        m_cursor = result + size;
+        m_bytes_used += size + padding;
+        return result;
+    }
+
+} // namespace lox::ast
@@ -0,0 +1,66 @@
+#ifndef LOX_AST_ARENA_HPP
+#define LOX_AST_ARENA_HPP
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace lox::ast {
+
+    /**
+     * @brief A bump allocator that owns AST nodes and releases them all at once.
+     *
+     * Objects are carved out of large blocks and are never destroyed individually, so only trivially destructible
+     * types may be allocated here. Moving an arena keeps every pointer into it valid.
+     */
+    class Arena final {
+    public:
+        Arena() = default;
+
+        Arena(const Arena &) = delete;
+        Arena(Arena &&other) noexcept;
+        auto operator=(const Arena &) -> Arena & = delete;
+        auto operator=(Arena &&other) noexcept -> Arena &;
+
+        ~Arena() = default;
+
+        template <typename T, typename... Args> auto make(Args &&...args) -> T * {
+            static_assert(std::is_trivially_destructible_v<T>, "arena objects are never destroyed");
+            return ::new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        }
+
+        /// Copies @p items into the arena and returns a view of the copy.
+        template <typename T> auto copy(std::span<const T> items) -> std::span<T> {
+            static_assert(std::is_trivially_copyable_v<T>, "arena spans are copied bytewise");
+            if (items.empty()) {
+                return {};
+            }
+            auto *first = static_cast<T *>(allocate(items.size_bytes(), alignof(T)));
+            std::uninitialized_copy(items.begin(), items.end(), first);
+            return {first, items.size()};
+        }
+
+        auto allocate(std::size_t size, std::size_t alignment) -> void *;
+
+        /// Bytes handed out to callers, including alignment padding.
+        [[nodiscard]] auto bytes_used() const noexcept -> std::size_t { return m_bytes_used; }
+        /// Bytes reserved from the system across all blocks.
+        [[nodiscard]] auto bytes_reserved() const noexcept -> std::size_t { return m_bytes_reserved; }
+
+    private:
+        static constexpr std::size_t block_size = 64 * 1024;
+
+        std::vector<std::unique_ptr<std::byte[]>> m_blocks;
+        std::byte *m_cursor = nullptr;
+        std::byte *m_end = nullptr;
+        std::size_t m_bytes_used = 0;
+        std::size_t m_bytes_reserved = 0;
+    };
+
+} // namespace lox::ast
+
+#endif // LOX_AST_ARENA_HPP
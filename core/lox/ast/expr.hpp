@@ -1,136 +1,178 @@
 #ifndef LOX_AST_EXPR_HPP
 #define LOX_AST_EXPR_HPP
 
+#include "lox/support/trace.hpp"
 #include "lox/syntax/token.hpp"
 
-#include <spdlog/spdlog.h>
-
+#include <concepts>
+#include <cstdint>
 #include <format>
-#include <memory>
+#include <span>
 #include <string>
 #include <utility>
-#include <vector>
 
 namespace lox::ast {
 
+    /// Identifies the concrete type of an expression node. The set of nodes is closed.
+    enum class ExprKind : uint8_t { binary, unary, grouping, literal, variable, assignment, logical, call };
+
+    /**
+     * @brief Base of all expression nodes.
+     *
+     * Nodes live in an ast::Arena and are released with it, never through a base pointer, so the destructor is
+     * protected and trivial. There are no virtual functions: passes dispatch on @c kind through ast::visit.
+     */
     struct Expression {
-        Expression() = default;
-        Expression(const Expression &) = default;
+        const ExprKind kind;
+
+        Expression(const Expression &) = delete;
         Expression(Expression &&) = delete;
-        auto operator=(const Expression &) -> Expression & = default;
+        auto operator=(const Expression &) -> Expression & = delete;
         auto operator=(Expression &&) -> Expression & = delete;
-        virtual ~Expression() = default;
 
-        [[nodiscard]] virtual auto to_string() const noexcept -> std::string = 0;
+        [[nodiscard]] auto to_string() const noexcept -> std::string;
+
+    protected:
+        explicit Expression(const ExprKind k) noexcept : kind(k) {}
+        ~Expression() = default;
     };
 
-    using ExprPtr = std::unique_ptr<Expression>;
+    /// A non-owning pointer to an arena-allocated expression.
+    using ExprPtr = Expression *;
+
+    /// Where a variable reference reads or writes, as decided by ast::resolve before code generation.
+    struct Binding {
+        enum class Kind : uint8_t { global, local, upvalue };
+
+        Kind kind = Kind::global;
+        /// The stack slot of a local, counted from its function's frame, or the index of an upvalue.
+        uint8_t index = 0;
+    };
 
     struct BinaryExpression : Expression {
+        static constexpr auto node_kind = ExprKind::binary;
+
         ExprPtr left;
         ExprPtr right;
         syntax::Token operator_token;
 
         BinaryExpression(ExprPtr l, syntax::Token op, ExprPtr r) noexcept
-            : left(std::move(l)), right(std::move(r)), operator_token(op) {
-            spdlog::trace("AST: Created BinaryExpression with operator '{}'", op.lexeme);
+            : Expression(node_kind), left(l), right(r), operator_token(op) {
+            LOX_TRACE("AST: Created BinaryExpression with operator '{}'", op.lexeme);
         }
 
-        [[nodiscard]] auto to_string() const noexcept -> std::string override {
+        [[nodiscard]] auto to_string() const noexcept -> std::string {
             return std::format("binary-expr{{ left: {}, right: {}, op: {} }}", left->to_string(), right->to_string(),
                                operator_token.to_string());
         }
     };
 
     struct UnaryExpression : Expression {
+        static constexpr auto node_kind = ExprKind::unary;
+
         syntax::Token operator_token;
         ExprPtr operand;
 
-        UnaryExpression(syntax::Token op, ExprPtr expr) noexcept : operator_token(op), operand(std::move(expr)) {
-            spdlog::trace("AST: Created UnaryExpression with operator '{}'", op.lexeme);
+        UnaryExpression(syntax::Token op, ExprPtr expr) noexcept
+            : Expression(node_kind), operator_token(op), operand(expr) {
+            LOX_TRACE("AST: Created UnaryExpression with operator '{}'", op.lexeme);
         }
 
-        [[nodiscard]] auto to_string() const noexcept -> std::string override {
+        [[nodiscard]] auto to_string() const noexcept -> std::string {
             return std::format("unary-expr{{ op: {}, operand: {} }}", operator_token.to_string(), operand->to_string());
         }
     };
 
     struct GroupingExpression : Expression {
+        static constexpr auto node_kind = ExprKind::grouping;
+
         ExprPtr expression;
 
-        explicit GroupingExpression(ExprPtr expr) noexcept : expression(std::move(expr)) {
-            spdlog::trace("AST: Created GroupingExpression");
+        explicit GroupingExpression(ExprPtr expr) noexcept : Expression(node_kind), expression(expr) {
+            LOX_TRACE("AST: Created GroupingExpression");
         }
 
-        [[nodiscard]] auto to_string() const noexcept -> std::string override {
+        [[nodiscard]] auto to_string() const noexcept -> std::string {
             return std::format("grouping-expr{{ expr: {} }}", expression->to_string());
         }
     };
 
     struct LiteralExpression : Expression {
+        static constexpr auto node_kind = ExprKind::literal;
+
         syntax::Token value;
 
-        explicit LiteralExpression(syntax::Token val) noexcept : value(val) {
-            spdlog::trace("AST: Created LiteralExpression with value '{}'", val.lexeme);
+        explicit LiteralExpression(syntax::Token val) noexcept : Expression(node_kind), value(val) {
+            LOX_TRACE("AST: Created LiteralExpression with value '{}'", val.lexeme);
         }
 
-        [[nodiscard]] auto to_string() const noexcept -> std::string override {
+        [[nodiscard]] auto to_string() const noexcept -> std::string {
             return std::format("literal-expr{{ value: {} }}", value.to_string());
         }
     };
 
     struct VariableExpression : Expression {
+        static constexpr auto node_kind = ExprKind::variable;
+
         syntax::Token name;
+        Binding binding;
 
-        explicit VariableExpression(syntax::Token n) noexcept : name(n) {
-            spdlog::trace("AST: Created VariableExpression with name '{}'", n.lexeme);
+        explicit VariableExpression(syntax::Token n) noexcept : Expression(node_kind), name(n) {
+            LOX_TRACE("AST: Created VariableExpression with name '{}'", n.lexeme);
         }
 
-        [[nodiscard]] auto to_string() const noexcept -> std::string override {
+        [[nodiscard]] auto to_string() const noexcept -> std::string {
             return std::format("variable-expr{{ name: {} }}", name.to_string());
         }
     };
 
     struct AssignmentExpression : Expression {
+        static constexpr auto node_kind = ExprKind::assignment;
+
         syntax::Token name;
         ExprPtr value;
+        Binding binding;
 
-        AssignmentExpression(syntax::Token n, ExprPtr val) noexcept : name(n), value(std::move(val)) {
-            spdlog::trace("AST: Created AssignmentExpression to variable '{}'", n.lexeme);
+        AssignmentExpression(syntax::Token n, ExprPtr val) noexcept : Expression(node_kind), name(n), value(val) {
+            LOX_TRACE("AST: Created AssignmentExpression to variable '{}'", n.lexeme);
         }
 
-        [[nodiscard]] auto to_string() const noexcept -> std::string override {
+        [[nodiscard]] auto to_string() const noexcept -> std::string {
             return std::format("assignment-expr{{ name: {}, value: {} }}", name.to_string(), value->to_string());
         }
     };
 
     struct LogicalExpression : Expression {
+        static constexpr auto node_kind = ExprKind::logical;
+
         ExprPtr left;
         syntax::Token operator_token;
         ExprPtr right;
 
         LogicalExpression(ExprPtr l, syntax::Token op, ExprPtr r) noexcept
-            : left(std::move(l)), operator_token(op), right(std::move(r)) {
-            spdlog::trace("AST: Created LogicalExpression with operator '{}'", op.lexeme);
+            : Expression(node_kind), left(l), operator_token(op), right(r) {
+            LOX_TRACE("AST: Created LogicalExpression with operator '{}'", op.lexeme);
         }
 
-        [[nodiscard]] auto to_string() const noexcept -> std::string override {
+        [[nodiscard]] auto to_string() const noexcept -> std::string {
             return std::format("logical-expr{{ left: {}, op: {}, right: {} }}", left->to_string(),
                                operator_token.to_string(), right->to_string());
         }
     };
 
     struct CallExpression : Expression {
+        static constexpr auto node_kind = ExprKind::call;
+
         ExprPtr callee;
         syntax::Token paren;
-        std::vector<ExprPtr> arguments;
+        std::span<ExprPtr> arguments;
 
-        CallExpression(ExprPtr c, syntax::Token p, std::vector<ExprPtr> args) noexcept
-            : callee(std::move(c)), paren(std::move(p)), arguments(std::move(args)) {
-            spdlog::trace("AST: Created CallExpression with {} arguments", arguments.size());
+        CallExpression(ExprPtr c, syntax::Token p, std::span<ExprPtr> args) noexcept
+            : Expression(node_kind), callee(c), paren(p), arguments(args) {
+            LOX_TRACE("AST: Created CallExpression with {} arguments", arguments.size());
         }
 
-        [[nodiscard]] auto to_string() const noexcept -> std::string override {
+        [[nodiscard]] auto to_string() const noexcept -> std::string {
             std::string args_str;
             for (const auto &arg : arguments) {
                 if (!args_str.empty())
@@ -141,6 +183,75 @@ namespace lox::ast {
         }
     };
 
+    template <typename T>
+    concept ExpressionNode = std::derived_from<T, Expression> && requires {
+        { T::node_kind } -> std::convertible_to<ExprKind>;
+    };
+
+    /**
+     * @brief Calls @p visitor with @p expr downcast to its concrete node type.
+     *
+     * Every alternative is known here, so the call compiles to a switch over the node kind and each case can be
+     * inlined. All alternatives must return the same type.
+     */
+    template <typename Visitor> decltype(auto) visit(const Expression &expr, Visitor &&visitor) {
+        switch (expr.kind) {
+        case ExprKind::binary:
+            return std::forward<Visitor>(visitor)(static_cast<const BinaryExpression &>(expr));
+        case ExprKind::unary:
+            return std::forward<Visitor>(visitor)(static_cast<const UnaryExpression &>(expr));
+        case ExprKind::grouping:
+            return std::forward<Visitor>(visitor)(static_cast<const GroupingExpression &>(expr));
+        case ExprKind::literal:
+            return std::forward<Visitor>(visitor)(static_cast<const LiteralExpression &>(expr));
+        case ExprKind::variable:
+            return std::forward<Visitor>(visitor)(static_cast<const VariableExpression &>(expr));
+        case ExprKind::assignment:
+            return std::forward<Visitor>(visitor)(static_cast<const AssignmentExpression &>(expr));
+        case ExprKind::logical:
+            return std::forward<Visitor>(visitor)(static_cast<const LogicalExpression &>(expr));
+        case ExprKind::call:
+            return std::forward<Visitor>(visitor)(static_cast<const CallExpression &>(expr));
+        }
+        std::unreachable();
+    }
+
+    /// Calls @p visitor with a mutable reference to @p expr's concrete node, for passes that rewrite the tree.
+    template <typename Visitor> decltype(auto) visit(Expression &expr, Visitor &&visitor) {
+        switch (expr.kind) {
+        case ExprKind::binary:
+            return std::forward<Visitor>(visitor)(static_cast<BinaryExpression &>(expr));
+        case ExprKind::unary:
+            return std::forward<Visitor>(visitor)(static_cast<UnaryExpression &>(expr));
+        case ExprKind::grouping:
+            return std::forward<Visitor>(visitor)(static_cast<GroupingExpression &>(expr));
+        case ExprKind::literal:
+            return std::forward<Visitor>(visitor)(static_cast<LiteralExpression &>(expr));
+        case ExprKind::variable:
+            return std::forward<Visitor>(visitor)(static_cast<VariableExpression &>(expr));
+        case ExprKind::assignment:
+            return std::forward<Visitor>(visitor)(static_cast<AssignmentExpression &>(expr));
+        case ExprKind::logical:
+            return std::forward<Visitor>(visitor)(static_cast<LogicalExpression &>(expr));
+        case ExprKind::call:
+            return std::forward<Visitor>(visitor)(static_cast<CallExpression &>(expr));
+        }
+        std::unreachable();
+    }
+
+    /// Returns @p expr as a @p T, or nullptr if it is a different kind of node.
+    template <ExpressionNode T> auto as(Expression *expr) noexcept -> T * {
+        return expr != nullptr && expr->kind == T::node_kind ? static_cast<T *>(expr) : nullptr;
+    }
+
+    template <ExpressionNode T> auto as(const Expression *expr) noexcept -> const T * {
+        return expr != nullptr && expr->kind == T::node_kind ? static_cast<const T *>(expr) : nullptr;
+    }
+
+    inline auto Expression::to_string() const noexcept -> std::string {
+        return visit(*this, [](const auto &node) { return node.to_string(); });
+    }
+
 } // namespace lox::ast
 
 #endif
@@ -0,0 +1,364 @@
+#include "lox/ast/fold.hpp"
+
+#include "lox/ast/arena.hpp"
+#include "lox/ast/expr.hpp"
+#include "lox/ast/program.hpp"
+#include "lox/ast/stmt.hpp"
+#include "lox/syntax/token.hpp"
+
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <system_error>
+
+namespace lox::ast {
+
+    namespace {
+
+        using syntax::TokenKind;
+
+        /// The value of a literal, as the VM would see it.
+        struct Constant {
+            enum class Type : std::uint8_t { nil, boolean, number, string };
+
+            Type type = Type::nil;
+            bool boolean = false;
+            double number = 0.0;
+            std::string_view string{};
+
+            [[nodiscard]] static auto of(const bool value) noexcept -> Constant {
+                return {.type = Type::boolean, .boolean = value};
+            }
+            [[nodiscard]] static auto of(const double value) noexcept -> Constant {
+                return {.type = Type::number, .number = value};
+            }
+
+            [[nodiscard]] auto is_falsey() const noexcept -> bool {
+                return type == Type::nil || (type == Type::boolean && !boolean);
+            }
+
+            [[nodiscard]] auto operator==(const Constant &other) const noexcept -> bool {
+                if (type != other.type) {
+                    return false;
+                }
+                switch (type) {
+                case Type::nil:
+                    return true;
+                case Type::boolean:
+                    return boolean == other.boolean;
+                case Type::number:
+                    return number == other.number;
+                case Type::string:
+                    return string == other.string;
+                }
+                return false;
+            }
+        };
+
+        /// The constant @p expr evaluates to if it is a literal; malformed numbers are left for the compiler.
+        auto constant_of(const Expression *expr) noexcept -> std::optional<Constant> {
+            const auto *literal = as<LiteralExpression>(expr);
+            if (literal == nullptr) {
+                return std::nullopt;
+            }
+            const auto &token = literal->value;
+            switch (token.kind) {
+            case TokenKind::keyword_nil:
+                return Constant{};
+            case TokenKind::keyword_true:
+                return Constant::of(true);
+            case TokenKind::keyword_false:
+                return Constant::of(false);
+            case TokenKind::number_literal: {
+                double number = 0.0;
+                const auto *last = token.lexeme.data() + token.lexeme.size();
+                if (const auto [ptr, ec] = std::from_chars(token.lexeme.data(), last, number);
+                    ec != std::errc{} || ptr != last) {
+                    return std::nullopt;
+                }
+                return Constant::of(number);
+            }
+            case TokenKind::string_literal:
+                return Constant{.type = Constant::Type::string, .string = token.lexeme};
+            default:
+                return std::nullopt;
+            }
+        }
+
+        [[nodiscard]] auto covering(const syntax::Span first, const syntax::Span last) noexcept -> syntax::Span {
+            return {.start = first.start, .end = last.end, .file = first.file};
+        }
+
+        class ConstantFolder {
+        public:
+            ConstantFolder(Arena &arena, FoldStats &stats) noexcept : m_arena(arena), m_stats(stats) {}
+
+            /// Returns the node that should replace @p expr, which may be @p expr itself.
+            auto fold(const ExprPtr expr) -> ExprPtr {
+                if (expr == nullptr) {
+                    return nullptr;
+                }
+                return visit(*expr, [this](auto &node) -> ExprPtr { return fold_node(node); });
+            }
+
+            /// Returns the node that should replace @p stmt, which may be @p stmt itself.
+            auto fold(const StmtPtr stmt) -> StmtPtr {
+                if (stmt == nullptr) {
+                    return nullptr;
+                }
+                return visit(*stmt, [this](auto &node) -> StmtPtr { return fold_node(node); });
+            }
+
+            auto fold(const std::span<StmtPtr> stmts) -> void {
+                for (auto &stmt : stmts) {
+                    stmt = fold(stmt);
+                }
+            }
+
+        private:
+            // --- Expressions ---
+
+            auto fold_node(BinaryExpression &expr) -> ExprPtr {
+                expr.left = fold(expr.left);
+                expr.right = fold(expr.right);
+
+                const auto left = constant_of(expr.left);
+                const auto right = constant_of(expr.right);
+                if (!left || !right) {
+                    return &expr;
+                }
+                const auto result = evaluate(expr.operator_token.kind, *left, *right);
+                if (!result) {
+                    return &expr;
+                }
+                const auto &left_span = as<LiteralExpression>(expr.left)->value.span;
+                const auto &right_span = as<LiteralExpression>(expr.right)->value.span;
+                return folded(*result, covering(left_span, right_span));
+            }
+
+            auto fold_node(UnaryExpression &expr) -> ExprPtr {
+                expr.operand = fold(expr.operand);
+
+                const auto operand = constant_of(expr.operand);
+                if (!operand) {
+                    return &expr;
+                }
+                const auto span = covering(expr.operator_token.span, as<LiteralExpression>(expr.operand)->value.span);
+                switch (expr.operator_token.kind) {
+                case TokenKind::minus:
+                    if (operand->type != Constant::Type::number) {
+                        return &expr;
+                    }
+                    return folded(Constant::of(-operand->number), span);
+                case TokenKind::bang:
+                    return folded(Constant::of(operand->is_falsey()), span);
+                default:
+                    return &expr;
+                }
+            }
+
+            auto fold_node(GroupingExpression &expr) -> ExprPtr {
+                expr.expression = fold(expr.expression);
+                if (as<LiteralExpression>(expr.expression) == nullptr) {
+                    return &expr;
+                }
+                ++m_stats.folded_expressions;
+                return expr.expression;
+            }
+
+            auto fold_node(LogicalExpression &expr) -> ExprPtr {
+                expr.left = fold(expr.left);
+                expr.right = fold(expr.right);
+
+                const auto left = constant_of(expr.left);
+                if (!left) {
+                    return &expr;
+                }
+                // `and` yields a falsey left operand and `or` a truthy one; otherwise the result is the right operand.
+                ++m_stats.folded_expressions;
+                const auto short_circuits = expr.operator_token.kind == TokenKind::keyword_and ? left->is_falsey()
+                                                                                               : !left->is_falsey();
+                return short_circuits ? expr.left : expr.right;
+            }
+
+            auto fold_node(LiteralExpression &expr) -> ExprPtr { return &expr; }
+            auto fold_node(VariableExpression &expr) -> ExprPtr { return &expr; }
+
+            auto fold_node(AssignmentExpression &expr) -> ExprPtr {
+                expr.value = fold(expr.value);
+                return &expr;
+            }
+
+            auto fold_node(CallExpression &expr) -> ExprPtr {
+                expr.callee = fold(expr.callee);
+                for (auto &argument : expr.arguments) {
+                    argument = fold(argument);
+                }
+                return &expr;
+            }
+
+            /// The result of a binary operator on two constants, or nullopt if the VM would report an error.
+            [[nodiscard]] auto evaluate(const TokenKind op, const Constant &left, const Constant &right)
+                -> std::optional<Constant> {
+                if (op == TokenKind::equal_equal) {
+                    return Constant::of(left == right);
+                }
+                if (op == TokenKind::bang_equal) {
+                    return Constant::of(!(left == right));
+                }
+                if (op == TokenKind::plus && left.type == Constant::Type::string &&
+                    right.type == Constant::Type::string) {
+                    return Constant{.type = Constant::Type::string, .string = concatenate(left.string, right.string)};
+                }
+                if (left.type != Constant::Type::number || right.type != Constant::Type::number) {
+                    return std::nullopt;
+                }
+
+                const auto a = left.number;
+                const auto b = right.number;
+                switch (op) {
+                case TokenKind::plus:
+                    return Constant::of(a + b);
+                case TokenKind::minus:
+                    return Constant::of(a - b);
+                case TokenKind::star:
+                    return Constant::of(a * b);
+                case TokenKind::slash:
+                    return Constant::of(a / b);
+                case TokenKind::greater:
+                    return Constant::of(a > b);
+                case TokenKind::less:
+                    return Constant::of(a < b);
+                // The VM negates the opposite comparison, which differs from a >= b when either side is NaN.
+                case TokenKind::greater_equal:
+                    return Constant::of(!(a < b));
+                case TokenKind::less_equal:
+                    return Constant::of(!(a > b));
+                default:
+                    return std::nullopt;
+                }
+            }
+
+            auto concatenate(const std::string_view a, const std::string_view b) -> std::string_view {
+                auto *chars = static_cast<char *>(m_arena.allocate(a.size() + b.size(), alignof(char)));
+                std::memcpy(chars, a.data(), a.size());
+                std::memcpy(chars + a.size(), b.data(), b.size());
+                return {chars, a.size() + b.size()};
+            }
+
+            /// A literal node for @p value whose lexeme the compiler reads back as the same value.
+            auto folded(const Constant &value, const syntax::Span span) -> ExprPtr {
+                ++m_stats.folded_expressions;
+                switch (value.type) {
+                case Constant::Type::nil:
+                    return literal(TokenKind::keyword_nil, "nil", span);
+                case Constant::Type::boolean:
+                    return value.boolean ? literal(TokenKind::keyword_true, "true", span)
+                                         : literal(TokenKind::keyword_false, "false", span);
+                case Constant::Type::number: {
+                    // The shortest representation that round-trips, including "-0", "inf" and "nan".
+                    std::array<char, 32> buffer{};
+                    const auto [end, ec] = std::to_chars(buffer.data(), buffer.data() + buffer.size(), value.number);
+                    const auto length = static_cast<std::size_t>(end - buffer.data());
+                    const auto lexeme = m_arena.copy(std::span<const char>{buffer.data(), length});
+                    return literal(TokenKind::number_literal, {lexeme.data(), lexeme.size()}, span);
+                }
+                case Constant::Type::string:
+                    return literal(TokenKind::string_literal, value.string, span);
+                }
+                return nullptr;
+            }
+
+            auto literal(const TokenKind kind, const std::string_view lexeme, const syntax::Span span) -> ExprPtr {
+                return m_arena.make<LiteralExpression>(syntax::Token{.kind = kind, .lexeme = lexeme, .span = span});
+            }
+
+            // --- Statements ---
+
+            auto fold_node(ExpressionStatement &stmt) -> StmtPtr {
+                stmt.expression = fold(stmt.expression);
+                return &stmt;
+            }
+
+            auto fold_node(PrintStatement &stmt) -> StmtPtr {
+                stmt.expression = fold(stmt.expression);
+                return &stmt;
+            }
+
+            auto fold_node(VarStatement &stmt) -> StmtPtr {
+                stmt.initializer = fold(stmt.initializer);
+                return &stmt;
+            }
+
+            auto fold_node(BlockStatement &stmt) -> StmtPtr {
+                fold(stmt.statements);
+                return &stmt;
+            }
+
+            auto fold_node(IfStatement &stmt) -> StmtPtr {
+                stmt.condition = fold(stmt.condition);
+                stmt.then_branch = fold(stmt.then_branch);
+                stmt.else_branch = fold(stmt.else_branch);
+
+                const auto condition = constant_of(stmt.condition);
+                if (!condition) {
+                    return &stmt;
+                }
+                // A branch is a statement, not a declaration, so it can stand in for the if without leaking names.
+                ++m_stats.pruned_branches;
+                if (!condition->is_falsey()) {
+                    return stmt.then_branch;
+                }
+                return stmt.else_branch != nullptr ? stmt.else_branch : empty_block();
+            }
+
+            auto fold_node(WhileStatement &stmt) -> StmtPtr {
+                stmt.condition = fold(stmt.condition);
+                stmt.body = fold(stmt.body);
+
+                if (const auto condition = constant_of(stmt.condition); condition && condition->is_falsey()) {
+                    ++m_stats.pruned_branches;
+                    return empty_block();
+                }
+                return &stmt;
+            }
+
+            auto fold_node(ForStatement &stmt) -> StmtPtr {
+                stmt.initializer = fold(stmt.initializer);
+                stmt.condition = fold(stmt.condition);
+                stmt.increment = fold(stmt.increment);
+                stmt.body = fold(stmt.body);
+                return &stmt;
+            }
+
+            auto fold_node(ReturnStatement &stmt) -> StmtPtr {
+                stmt.value = fold(stmt.value);
+                return &stmt;
+            }
+
+            auto fold_node(FunctionDeclarationStatement &stmt) -> StmtPtr {
+                fold(stmt.body);
+                return &stmt;
+            }
+
+            auto empty_block() -> StmtPtr { return m_arena.make<BlockStatement>(std::span<StmtPtr>{}); }
+
+            Arena &m_arena;
+            FoldStats &m_stats;
+        };
+
+    } // namespace
+
+    auto fold_constants(Program &program) -> FoldStats {
+        FoldStats stats;
+        ConstantFolder folder{program.arena(), stats};
+        folder.fold(program.statements());
+        return stats;
+    }
+
+} // namespace lox::ast
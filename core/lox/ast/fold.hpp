@@ -0,0 +1,33 @@
+#ifndef LOX_AST_FOLD_HPP
+#define LOX_AST_FOLD_HPP
+
+#include "lox/ast/program.hpp"
+
+#include <cstddef>
+
+namespace lox::ast {
+
+    /// What constant folding changed, for tests and diagnostics.
+    struct FoldStats {
+        /// Expressions replaced by a literal or by one of their operands.
+        std::size_t folded_expressions = 0;
+        /// if and while statements whose constant condition let one branch be dropped.
+        std::size_t pruned_branches = 0;
+    };
+
+    /**
+     * @brief Evaluates literal-only subexpressions of @p program and drops branches that can never run.
+     *
+     * Unary, binary, grouping and logical expressions whose operands are literals are replaced by the literal they
+     * evaluate to, following the VM's rules exactly: an operation that would fail at run time, such as negating a
+     * string, is left in place so that it still fails there. An if with a constant condition is replaced by the
+     * branch it takes, and a while whose condition is constantly falsey by an empty block.
+     *
+     * Pruned code is never compiled, so run ast::resolve first for its scope errors to be reported. Lexemes of
+     * folded literals are allocated in the program's arena.
+     */
+    auto fold_constants(Program &program) -> FoldStats;
+
+} // namespace lox::ast
+
+#endif // LOX_AST_FOLD_HPP
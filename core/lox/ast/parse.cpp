@@ -1,84 +1,95 @@
 #include "lox/ast/parse.hpp"
 
+#include "lox/ast/arena.hpp"
 #include "lox/ast/expr.hpp"
+#include "lox/ast/program.hpp"
 #include "lox/ast/stmt.hpp"
-#include "lox/syntax/lex.hpp"
+#include "lox/support/trace.hpp"
+#include "lox/syntax/source.hpp"
+#include "lox/syntax/stream.hpp"
 #include "lox/syntax/token.hpp"
 
 #include <spdlog/spdlog.h>
 
 #include <algorithm>
+#include <array>
+#include <cstddef>
 #include <cstdint>
 #include <expected>
 #include <format>
 #include <initializer_list>
-#include <memory>
+#include <span>
 #include <string>
 #include <utility>
 #include <vector>
 
 namespace lox::ast {
 
-    Parser::Parser(std::string_view source) noexcept : m_current{0} {
-        auto scanner = lox::syntax::Scanner(source);
+    Parser::Parser(std::string_view source) noexcept : m_tokens{source} {}
 
-        std::vector<syntax::Token> tokens;
-        while (true) {
-            auto token_result = scanner.get_next_token();
-            if (!token_result.has_value()) {
-                break;
-            }
-            auto token = token_result.value();
-            if (token.kind == syntax::TokenKind::end_of_file) {
-                tokens.push_back(std::move(token));
-                break;
-            }
-            tokens.push_back(std::move(token));
-        }
+    Parser::Parser(const syntax::SourceFile &file) noexcept : m_tokens{file}, m_file{&file} {}
 
-        m_tokens = std::move(tokens);
+    auto Parser::located(const syntax::Span &span, std::string message) const -> std::string {
+        if (m_file == nullptr) {
+            return message;
+        }
+        return std::format("{}: {}", m_file->locate(span.start).to_string(), message);
+    }
 
-        spdlog::debug("Parser: Initializing with {} tokens", m_tokens.size());
-        initialize_parse_rules();
-        spdlog::debug("Parser: Parse rules initialized");
+    auto Parser::located(const syntax::Token &token, std::string message) const -> std::string {
+        return located(token.span, std::move(message));
     }
 
-    auto Parser::parse() noexcept -> std::expected<std::vector<StmtPtr>, std::string> {
-        spdlog::info("Parser: Beginning parse of {} tokens", m_tokens.size());
-        std::vector<StmtPtr> statements;
+    auto Parser::parse() noexcept -> std::expected<Program, std::string> {
+        spdlog::info("Parser: Beginning parse");
+        const auto mark = m_stmt_scratch.size();
 
         while (!is_at_end()) {
-            spdlog::debug("Parser: Parsing declaration at token {}: {}", m_current, current_token().to_string());
+            LOX_DEBUG("Parser: Parsing declaration at offset {}: {}", current_token().span.start,
+                      current_token().to_string());
             auto stmt_result = parse_declaration();
             if (!stmt_result) {
+                // A lex error ends the token stream early, so it is the root cause of whatever the parser saw.
+                if (const auto &lex_error = m_tokens.error()) {
+                    spdlog::error("Parser: Lex error: {}", *lex_error);
+                    return std::unexpected(located(m_tokens.error_span(), *lex_error));
+                }
                 spdlog::error("Parser: Declaration parse failed: {}", stmt_result.error());
                 synchronize();
                 return std::unexpected(stmt_result.error());
             }
-            statements.push_back(std::move(stmt_result.value()));
-            spdlog::debug("Parser: Successfully parsed statement, now have {} statements", statements.size());
+            m_stmt_scratch.push_back(stmt_result.value());
+            LOX_DEBUG("Parser: Successfully parsed statement, now have {} statements", m_stmt_scratch.size() - mark);
+        }
+
+        if (const auto &lex_error = m_tokens.error()) {
+            spdlog::error("Parser: Lex error: {}", *lex_error);
+            return std::unexpected(located(m_tokens.error_span(), *lex_error));
         }
 
-        spdlog::info("Parser: Successfully parsed {} statements", statements.size());
-        return statements;
+        const auto statements = flush_scratch(m_stmt_scratch, mark);
+        spdlog::info("Parser: Successfully parsed {} statements into {} arena bytes", statements.size(),
+                     m_arena.bytes_used());
+        return Program{std::move(m_arena), statements};
     }
 
-    auto Parser::current_token() const noexcept -> const syntax::Token & { return m_tokens[m_current]; }
+    template <typename T> auto Parser::flush_scratch(std::vector<T> &scratch, const std::size_t mark) -> std::span<T> {
+        const auto items = m_arena.copy(std::span<const T>{scratch}.subspan(mark));
+        scratch.resize(mark);
+        return items;
+    }
 
-    auto Parser::previous_token() const noexcept -> const syntax::Token & { return m_tokens[m_current - 1]; }
+    auto Parser::current_token() const noexcept -> const syntax::Token & { return m_tokens.current(); }
 
-    auto Parser::peek_token() const noexcept -> const syntax::Token & {
-        if (m_current + 1 >= m_tokens.size()) {
-            return m_tokens.back();
-        }
-        return m_tokens[m_current + 1];
-    }
+    auto Parser::previous_token() const noexcept -> const syntax::Token & { return m_tokens.previous(); }
+
+    auto Parser::peek_token() const noexcept -> const syntax::Token & { return m_tokens.peek(); }
 
     auto Parser::is_at_end() const noexcept -> bool { return current_token().kind == syntax::TokenKind::end_of_file; }
 
     auto Parser::advance() noexcept -> const syntax::Token & {
         if (!is_at_end()) {
-            m_current++;
+            m_tokens.advance();
         }
         return previous_token();
     }
@@ -90,11 +101,11 @@ namespace lox::ast {
     }
 
     auto Parser::match(const std::initializer_list<syntax::TokenKind> kinds) noexcept -> bool {
-        return std::ranges::all_of(kinds, [this](const auto kind) {
-            if (check(kind))
-                return true;
-            return false;
-        });
+        if (std::ranges::any_of(kinds, [this](const auto kind) { return check(kind); })) {
+            advance();
+            return true;
+        }
+        return false;
     }
 
     auto Parser::consume(const syntax::TokenKind kind, const std::string &message) noexcept
@@ -103,32 +114,28 @@ namespace lox::ast {
             return advance();
         }
 
-        return std::unexpected(std::format("Parse error: {} at token '{}'", message, current_token().to_string()));
+        return std::unexpected(located(current_token(), std::format("Parse error: {} at token '{}'", message,
+                                                                    current_token().to_string())));
     }
 
     auto Parser::parse_declaration() noexcept -> std::expected<StmtPtr, std::string> {
-        spdlog::trace("Parser: parse_declaration at token: {}", current_token().to_string());
-
-        if (check(syntax::TokenKind::keyword)) {
-            const auto &keyword = current_token();
-            if (keyword.lexeme == "var") {
-                spdlog::debug("Parser: Parsing variable declaration");
-                advance();
-                return parse_var_declaration();
-            }
-            if (keyword.lexeme == "fun") {
-                spdlog::debug("Parser: Parsing function declaration");
-                advance();
-                return parse_function_declaration();
-            }
+        LOX_TRACE("Parser: parse_declaration at token: {}", current_token().to_string());
+
+        if (match({syntax::TokenKind::keyword_var})) {
+            LOX_DEBUG("Parser: Parsing variable declaration");
+            return parse_var_declaration();
+        }
+        if (match({syntax::TokenKind::keyword_fun})) {
+            LOX_DEBUG("Parser: Parsing function declaration");
+            return parse_function_declaration();
         }
 
-        spdlog::trace("Parser: Not a declaration, parsing as statement");
+        LOX_TRACE("Parser: Not a declaration, parsing as statement");
         return parse_statement();
     }
 
     auto Parser::parse_var_declaration() noexcept -> std::expected<StmtPtr, std::string> {
-        spdlog::debug("Parser: parse_var_declaration");
+        LOX_DEBUG("Parser: parse_var_declaration");
 
         auto name_result = consume(syntax::TokenKind::identifier, "Expected variable name");
         if (!name_result) {
@@ -136,28 +143,27 @@ namespace lox::ast {
             return std::unexpected(name_result.error());
         }
 
-        spdlog::debug("Parser: Variable name: {}", name_result.value().lexeme);
+        LOX_DEBUG("Parser: Variable name: {}", name_result.value().lexeme);
 
         ExprPtr initializer = nullptr;
-        if (check(syntax::TokenKind::simple_operator) && current_token().lexeme == "=") {
-            spdlog::debug("Parser: Variable has initializer");
-            advance();
+        if (match({syntax::TokenKind::equal})) {
+            LOX_DEBUG("Parser: Variable has initializer");
             auto init_result = parse_expression();
             if (!init_result) {
                 spdlog::error("Parser: Variable initializer parse failed: {}", init_result.error());
                 return std::unexpected(init_result.error());
             }
-            initializer = std::move(init_result.value());
+            initializer = init_result.value();
         }
 
-        auto semicolon_result = consume(syntax::TokenKind::punctuation, "Expected ';' after variable declaration");
+        auto semicolon_result = consume(syntax::TokenKind::semicolon, "Expected ';' after variable declaration");
         if (!semicolon_result) {
             spdlog::error("Parser: Variable declaration missing semicolon: {}", semicolon_result.error());
             return std::unexpected(semicolon_result.error());
         }
 
-        spdlog::debug("Parser: Successfully parsed variable declaration: {}", name_result.value().lexeme);
-        return std::make_unique<VarStatement>(name_result.value(), std::move(initializer));
+        LOX_DEBUG("Parser: Successfully parsed variable declaration: {}", name_result.value().lexeme);
+        return m_arena.make<VarStatement>(name_result.value(), initializer);
     }
 
     auto Parser::parse_function_declaration() noexcept -> std::expected<StmtPtr, std::string> {
@@ -166,98 +172,87 @@ namespace lox::ast {
             return std::unexpected(name_result.error());
         }
 
-        auto lparen_result = consume(syntax::TokenKind::punctuation, "Expected '(' after function name");
-        if (!lparen_result || lparen_result.value().lexeme != "(") {
-            return std::unexpected("Expected '(' after function name");
+        auto lparen_result = consume(syntax::TokenKind::left_paren, "Expected '(' after function name");
+        if (!lparen_result) {
+            return std::unexpected(lparen_result.error());
         }
 
-        std::vector<syntax::Token> parameters;
-        if (!check(syntax::TokenKind::punctuation) || current_token().lexeme != ")") {
-            while (true) {
+        const auto parameters_mark = m_token_scratch.size();
+        if (!check(syntax::TokenKind::right_paren)) {
+            do {
                 auto param_result = consume(syntax::TokenKind::identifier, "Expected parameter name");
                 if (!param_result) {
                     return std::unexpected(param_result.error());
                 }
-                parameters.push_back(param_result.value());
-
-                if (!check(syntax::TokenKind::punctuation) || current_token().lexeme != ",") {
-                    break;
-                }
-                advance();
-            }
+                m_token_scratch.push_back(param_result.value());
+            } while (match({syntax::TokenKind::comma}));
         }
 
-        auto rparen_result = consume(syntax::TokenKind::punctuation, "Expected ')' after parameters");
-        if (!rparen_result || rparen_result.value().lexeme != ")") {
-            return std::unexpected("Expected ')' after parameters");
+        auto rparen_result = consume(syntax::TokenKind::right_paren, "Expected ')' after parameters");
+        if (!rparen_result) {
+            return std::unexpected(rparen_result.error());
         }
 
-        auto lbrace_result = consume(syntax::TokenKind::punctuation, "Expected '{' before function body");
-        if (!lbrace_result || lbrace_result.value().lexeme != "{") {
-            return std::unexpected("Expected '{' before function body");
+        auto lbrace_result = consume(syntax::TokenKind::left_brace, "Expected '{' before function body");
+        if (!lbrace_result) {
+            return std::unexpected(lbrace_result.error());
         }
 
-        std::vector<StmtPtr> body;
-        while (!check(syntax::TokenKind::punctuation) || current_token().lexeme != "}") {
+        const auto parameters = flush_scratch(m_token_scratch, parameters_mark);
+
+        const auto body_mark = m_stmt_scratch.size();
+        while (!check(syntax::TokenKind::right_brace)) {
             if (is_at_end()) {
-                return std::unexpected("Unterminated function body");
+                return std::unexpected(located(current_token(), "Unterminated function body"));
             }
 
             auto stmt_result = parse_declaration();
             if (!stmt_result) {
                 return std::unexpected(stmt_result.error());
             }
-            body.push_back(std::move(stmt_result.value()));
+            m_stmt_scratch.push_back(stmt_result.value());
         }
 
-        auto rbrace_result = consume(syntax::TokenKind::punctuation, "Expected '}' after function body");
+        auto rbrace_result = consume(syntax::TokenKind::right_brace, "Expected '}' after function body");
         if (!rbrace_result) {
             return std::unexpected(rbrace_result.error());
         }
 
-        return std::make_unique<FunctionDeclarationStatement>(name_result.value(), std::move(parameters),
-                                                              std::move(body));
+        return m_arena.make<FunctionDeclarationStatement>(name_result.value(), parameters,
+                                                          flush_scratch(m_stmt_scratch, body_mark));
     }
 
     auto Parser::parse_statement() noexcept -> std::expected<StmtPtr, std::string> {
-        spdlog::trace("Parser: parse_statement at token: {}", current_token().to_string());
-
-        if (check(syntax::TokenKind::keyword)) {
-            const auto &keyword = current_token();
-            if (keyword.lexeme == "print") {
-                spdlog::debug("Parser: Parsing print statement");
-                advance();
-                return parse_print_statement();
-            }
-            if (keyword.lexeme == "if") {
-                spdlog::debug("Parser: Parsing if statement");
-                advance();
-                return parse_if_statement();
-            }
-            if (keyword.lexeme == "while") {
-                spdlog::debug("Parser: Parsing while statement");
-                advance();
-                return parse_while_statement();
-            }
-            if (keyword.lexeme == "for") {
-                spdlog::debug("Parser: Parsing for statement");
-                advance();
-                return parse_for_statement();
-            }
-            if (keyword.lexeme == "return") {
-                spdlog::debug("Parser: Parsing return statement");
-                advance();
-                return parse_return_statement();
-            }
-        }
+        LOX_TRACE("Parser: parse_statement at token: {}", current_token().to_string());
 
-        if (check(syntax::TokenKind::punctuation) && current_token().lexeme == "{") {
-            spdlog::debug("Parser: Parsing block statement");
+        switch (current_token().kind) {
+        case syntax::TokenKind::keyword_print:
+            LOX_DEBUG("Parser: Parsing print statement");
+            advance();
+            return parse_print_statement();
+        case syntax::TokenKind::keyword_if:
+            LOX_DEBUG("Parser: Parsing if statement");
+            advance();
+            return parse_if_statement();
+        case syntax::TokenKind::keyword_while:
+            LOX_DEBUG("Parser: Parsing while statement");
+            advance();
+            return parse_while_statement();
+        case syntax::TokenKind::keyword_for:
+            LOX_DEBUG("Parser: Parsing for statement");
+            advance();
+            return parse_for_statement();
+        case syntax::TokenKind::keyword_return:
+            LOX_DEBUG("Parser: Parsing return statement");
+            advance();
+            return parse_return_statement();
+        case syntax::TokenKind::left_brace:
+            LOX_DEBUG("Parser: Parsing block statement");
             return parse_block_statement();
+        default:
+            LOX_TRACE("Parser: Parsing expression statement");
+            return parse_expression_statement();
         }
-
-        spdlog::trace("Parser: Parsing expression statement");
-        return parse_expression_statement();
     }
 
     auto Parser::parse_print_statement() noexcept -> std::expected<StmtPtr, std::string> {
@@ -266,45 +261,45 @@ namespace lox::ast {
             return std::unexpected(expr_result.error());
         }
 
-        auto semicolon_result = consume(syntax::TokenKind::punctuation, "Expected ';' after print statement");
+        auto semicolon_result = consume(syntax::TokenKind::semicolon, "Expected ';' after print statement");
         if (!semicolon_result) {
             return std::unexpected(semicolon_result.error());
         }
 
-        return std::make_unique<PrintStatement>(std::move(expr_result.value()));
+        return m_arena.make<PrintStatement>(expr_result.value());
     }
 
     auto Parser::parse_block_statement() noexcept -> std::expected<StmtPtr, std::string> {
-        auto lbrace_result = consume(syntax::TokenKind::punctuation, "Expected '{'");
-        if (!lbrace_result || lbrace_result.value().lexeme != "{") {
-            return std::unexpected("Expected '{'");
+        auto lbrace_result = consume(syntax::TokenKind::left_brace, "Expected '{'");
+        if (!lbrace_result) {
+            return std::unexpected(lbrace_result.error());
         }
 
-        std::vector<StmtPtr> statements;
-        while (!check(syntax::TokenKind::punctuation) || current_token().lexeme != "}") {
+        const auto mark = m_stmt_scratch.size();
+        while (!check(syntax::TokenKind::right_brace)) {
             if (is_at_end()) {
-                return std::unexpected("Unterminated block");
+                return std::unexpected(located(current_token(), "Unterminated block"));
             }
 
             auto stmt_result = parse_declaration();
             if (!stmt_result) {
                 return std::unexpected(stmt_result.error());
             }
-            statements.push_back(std::move(stmt_result.value()));
+            m_stmt_scratch.push_back(stmt_result.value());
         }
 
-        auto rbrace_result = consume(syntax::TokenKind::punctuation, "Expected '}' after block");
+        auto rbrace_result = consume(syntax::TokenKind::right_brace, "Expected '}' after block");
         if (!rbrace_result) {
             return std::unexpected(rbrace_result.error());
         }
 
-        return std::make_unique<BlockStatement>(std::move(statements));
+        return m_arena.make<BlockStatement>(flush_scratch(m_stmt_scratch, mark));
     }
 
     auto Parser::parse_if_statement() noexcept -> std::expected<StmtPtr, std::string> {
-        auto lparen_result = consume(syntax::TokenKind::punctuation, "Expected '(' after 'if'");
-        if (!lparen_result || lparen_result.value().lexeme != "(") {
-            return std::unexpected("Expected '(' after 'if'");
+        auto lparen_result = consume(syntax::TokenKind::left_paren, "Expected '(' after 'if'");
+        if (!lparen_result) {
+            return std::unexpected(lparen_result.error());
         }
 
         auto condition_result = parse_expression();
@@ -312,9 +307,9 @@ namespace lox::ast {
             return std::unexpected(condition_result.error());
         }
 
-        auto rparen_result = consume(syntax::TokenKind::punctuation, "Expected ')' after if condition");
-        if (!rparen_result || rparen_result.value().lexeme != ")") {
-            return std::unexpected("Expected ')' after if condition");
+        auto rparen_result = consume(syntax::TokenKind::right_paren, "Expected ')' after if condition");
+        if (!rparen_result) {
+            return std::unexpected(rparen_result.error());
         }
 
         auto then_result = parse_statement();
@@ -323,23 +318,21 @@ namespace lox::ast {
         }
 
         StmtPtr else_branch = nullptr;
-        if (check(syntax::TokenKind::keyword) && current_token().lexeme == "else") {
-            advance();
+        if (match({syntax::TokenKind::keyword_else})) {
             auto else_result = parse_statement();
             if (!else_result) {
                 return std::unexpected(else_result.error());
             }
-            else_branch = std::move(else_result.value());
+            else_branch = else_result.value();
         }
 
-        return std::make_unique<IfStatement>(std::move(condition_result.value()), std::move(then_result.value()),
-                                             std::move(else_branch));
+        return m_arena.make<IfStatement>(condition_result.value(), then_result.value(), else_branch);
     }
 
     auto Parser::parse_while_statement() noexcept -> std::expected<StmtPtr, std::string> {
-        auto lparen_result = consume(syntax::TokenKind::punctuation, "Expected '(' after 'while'");
-        if (!lparen_result || lparen_result.value().lexeme != "(") {
-            return std::unexpected("Expected '(' after 'while'");
+        auto lparen_result = consume(syntax::TokenKind::left_paren, "Expected '(' after 'while'");
+        if (!lparen_result) {
+            return std::unexpected(lparen_result.error());
         }
 
         auto condition_result = parse_expression();
@@ -347,9 +340,9 @@ namespace lox::ast {
             return std::unexpected(condition_result.error());
         }
 
-        auto rparen_result = consume(syntax::TokenKind::punctuation, "Expected ')' after while condition");
-        if (!rparen_result || rparen_result.value().lexeme != ")") {
-            return std::unexpected("Expected ')' after while condition");
+        auto rparen_result = consume(syntax::TokenKind::right_paren, "Expected ')' after while condition");
+        if (!rparen_result) {
+            return std::unexpected(rparen_result.error());
         }
 
         auto body_result = parse_statement();
@@ -357,60 +350,58 @@ namespace lox::ast {
             return std::unexpected(body_result.error());
         }
 
-        return std::make_unique<WhileStatement>(std::move(condition_result.value()), std::move(body_result.value()));
+        return m_arena.make<WhileStatement>(condition_result.value(), body_result.value());
     }
 
     auto Parser::parse_for_statement() noexcept -> std::expected<StmtPtr, std::string> {
-        auto lparen_result = consume(syntax::TokenKind::punctuation, "Expected '(' after 'for'");
-        if (!lparen_result || lparen_result.value().lexeme != "(") {
-            return std::unexpected("Expected '(' after 'for'");
+        auto lparen_result = consume(syntax::TokenKind::left_paren, "Expected '(' after 'for'");
+        if (!lparen_result) {
+            return std::unexpected(lparen_result.error());
         }
 
         StmtPtr initializer = nullptr;
-        if (check(syntax::TokenKind::punctuation) && current_token().lexeme == ";") {
-            advance();
+        if (match({syntax::TokenKind::semicolon})) {
             // No initializer
-        } else if (check(syntax::TokenKind::keyword) && current_token().lexeme == "var") {
-            advance();
+        } else if (match({syntax::TokenKind::keyword_var})) {
             auto init_result = parse_var_declaration();
             if (!init_result) {
                 return std::unexpected(init_result.error());
             }
-            initializer = std::move(init_result.value());
+            initializer = init_result.value();
         } else {
             auto init_result = parse_expression_statement();
             if (!init_result) {
                 return std::unexpected(init_result.error());
             }
-            initializer = std::move(init_result.value());
+            initializer = init_result.value();
         }
 
         ExprPtr condition = nullptr;
-        if (!check(syntax::TokenKind::punctuation) || current_token().lexeme != ";") {
+        if (!check(syntax::TokenKind::semicolon)) {
             auto cond_result = parse_expression();
             if (!cond_result) {
                 return std::unexpected(cond_result.error());
             }
-            condition = std::move(cond_result.value());
+            condition = cond_result.value();
         }
 
-        auto semicolon_result = consume(syntax::TokenKind::punctuation, "Expected ';' after for loop condition");
-        if (!semicolon_result || semicolon_result.value().lexeme != ";") {
-            return std::unexpected("Expected ';' after for loop condition");
+        auto semicolon_result = consume(syntax::TokenKind::semicolon, "Expected ';' after for loop condition");
+        if (!semicolon_result) {
+            return std::unexpected(semicolon_result.error());
         }
 
         ExprPtr increment = nullptr;
-        if (!check(syntax::TokenKind::punctuation) || current_token().lexeme != ")") {
+        if (!check(syntax::TokenKind::right_paren)) {
             auto inc_result = parse_expression();
             if (!inc_result) {
                 return std::unexpected(inc_result.error());
             }
-            increment = std::move(inc_result.value());
+            increment = inc_result.value();
         }
 
-        auto rparen_result = consume(syntax::TokenKind::punctuation, "Expected ')' after for clauses");
-        if (!rparen_result || rparen_result.value().lexeme != ")") {
-            return std::unexpected("Expected ')' after for clauses");
+        auto rparen_result = consume(syntax::TokenKind::right_paren, "Expected ')' after for clauses");
+        if (!rparen_result) {
+            return std::unexpected(rparen_result.error());
         }
 
         auto body_result = parse_statement();
@@ -418,28 +409,27 @@ namespace lox::ast {
             return std::unexpected(body_result.error());
         }
 
-        return std::make_unique<ForStatement>(std::move(initializer), std::move(condition), std::move(increment),
-                                              std::move(body_result.value()));
+        return m_arena.make<ForStatement>(initializer, condition, increment, body_result.value());
     }
 
     auto Parser::parse_return_statement() noexcept -> std::expected<StmtPtr, std::string> {
-        const auto &keyword = previous_token();
+        const auto keyword = previous_token();
 
         ExprPtr value = nullptr;
-        if (!check(syntax::TokenKind::punctuation) || current_token().lexeme != ";") {
+        if (!check(syntax::TokenKind::semicolon)) {
             auto val_result = parse_expression();
             if (!val_result) {
                 return std::unexpected(val_result.error());
             }
-            value = std::move(val_result.value());
+            value = val_result.value();
         }
 
-        auto semicolon_result = consume(syntax::TokenKind::punctuation, "Expected ';' after return value");
+        auto semicolon_result = consume(syntax::TokenKind::semicolon, "Expected ';' after return value");
         if (!semicolon_result) {
             return std::unexpected(semicolon_result.error());
         }
 
-        return std::make_unique<ReturnStatement>(keyword, std::move(value));
+        return m_arena.make<ReturnStatement>(keyword, value);
     }
 
     auto Parser::parse_expression_statement() noexcept -> std::expected<StmtPtr, std::string> {
@@ -448,19 +438,19 @@ namespace lox::ast {
             return std::unexpected(expr_result.error());
         }
 
-        auto semicolon_result = consume(syntax::TokenKind::punctuation, "Expected ';' after expression");
+        auto semicolon_result = consume(syntax::TokenKind::semicolon, "Expected ';' after expression");
         if (!semicolon_result) {
             return std::unexpected(semicolon_result.error());
         }
 
-        return std::make_unique<ExpressionStatement>(std::move(expr_result.value()));
+        return m_arena.make<ExpressionStatement>(expr_result.value());
     }
 
     auto Parser::parse_expression() noexcept -> std::expected<ExprPtr, std::string> {
-        spdlog::trace("Parser: parse_expression starting at token: {}", current_token().to_string());
+        LOX_TRACE("Parser: parse_expression starting at token: {}", current_token().to_string());
         auto result = parse_expression_with_precedence(Precedence::assignment);
         if (result) {
-            spdlog::trace("Parser: parse_expression succeeded");
+            LOX_TRACE("Parser: parse_expression succeeded");
         } else {
             spdlog::warn("Parser: parse_expression failed: {}", result.error());
         }
@@ -470,47 +460,47 @@ namespace lox::ast {
     auto Parser::parse_expression_with_precedence(Precedence precedence) noexcept
         -> std::expected<ExprPtr, std::string> {
 
-        const auto &current = current_token();
+        const auto current = current_token();
         const auto &rule = get_rule(current.kind);
 
-        spdlog::trace("Parser: parse_expression_with_precedence({}) at token: {}", static_cast<int>(precedence),
-                      current.to_string());
+        LOX_TRACE("Parser: parse_expression_with_precedence({}) at token: {}", static_cast<int>(precedence),
+                  current.to_string());
 
         if (!rule.prefix) {
             spdlog::error("Parser: No prefix rule for token: {}", current.to_string());
-            return std::unexpected(std::format("Unexpected token '{}' in expression", current.to_string()));
+            return std::unexpected(
+                located(current, std::format("Unexpected token '{}' in expression", current.to_string())));
         }
 
         advance();
-        spdlog::trace("Parser: Calling prefix parser for token kind: {}", static_cast<int>(current.kind));
-        auto left_result = rule.prefix();
+        LOX_TRACE("Parser: Calling prefix parser for token kind: {}", static_cast<int>(current.kind));
+        auto left_result = (this->*rule.prefix)();
         if (!left_result) {
             spdlog::error("Parser: Prefix parse failed: {}", left_result.error());
             return std::unexpected(left_result.error());
         }
 
-        ExprPtr left = std::move(left_result.value());
+        ExprPtr left = left_result.value();
 
         while (static_cast<uint8_t>(precedence) <= static_cast<uint8_t>(get_precedence(current_token().kind))) {
             const auto &infix_rule = get_rule(current_token().kind);
             if (!infix_rule.infix) {
-                spdlog::trace("Parser: No infix rule for token: {}, stopping "
-                              "precedence climb",
-                              current_token().to_string());
+                LOX_TRACE("Parser: No infix rule for token: {}, stopping precedence climb",
+                          current_token().to_string());
                 break;
             }
 
-            spdlog::trace("Parser: Continuing precedence climb with infix token: {}", current_token().to_string());
+            LOX_TRACE("Parser: Continuing precedence climb with infix token: {}", current_token().to_string());
             advance();
-            auto right_result = infix_rule.infix(std::move(left));
+            auto right_result = (this->*infix_rule.infix)(left);
             if (!right_result) {
                 spdlog::error("Parser: Infix parse failed: {}", right_result.error());
                 return std::unexpected(right_result.error());
             }
-            left = std::move(right_result.value());
+            left = right_result.value();
         }
 
-        spdlog::trace("Parser: parse_expression_with_precedence completed");
+        LOX_TRACE("Parser: parse_expression_with_precedence completed");
         return left;
     }
 
@@ -520,12 +510,12 @@ namespace lox::ast {
             return std::unexpected(expr_result.error());
         }
 
-        auto rparen_result = consume(syntax::TokenKind::punctuation, "Expected ')' after expression");
-        if (!rparen_result || rparen_result.value().lexeme != ")") {
-            return std::unexpected("Expected ')' after expression");
+        auto rparen_result = consume(syntax::TokenKind::right_paren, "Expected ')' after expression");
+        if (!rparen_result) {
+            return std::unexpected(rparen_result.error());
         }
 
-        return std::make_unique<GroupingExpression>(std::move(expr_result.value()));
+        return m_arena.make<GroupingExpression>(expr_result.value());
     }
 
     auto Parser::parse_unary() noexcept -> std::expected<ExprPtr, std::string> {
@@ -536,23 +526,14 @@ namespace lox::ast {
             return std::unexpected(operand_result.error());
         }
 
-        return std::make_unique<UnaryExpression>(operator_token, std::move(operand_result.value()));
+        return m_arena.make<UnaryExpression>(operator_token, operand_result.value());
     }
 
     auto Parser::parse_binary(ExprPtr left) noexcept -> std::expected<ExprPtr, std::string> {
-        const auto &operator_token = previous_token();
-        spdlog::trace("Parser: parse_binary with operator: {}", operator_token.lexeme);
-
-        // Determine precedence based on operator
-        auto precedence = Precedence::term;
-        const auto &lexeme = operator_token.lexeme;
-        if (lexeme == "*" || lexeme == "/") {
-            precedence = Precedence::factor;
-        } else if (lexeme == "+" || lexeme == "-") {
-            precedence = Precedence::term;
-        }
-
-        spdlog::trace("Parser: Binary operator '{}' has precedence {}", lexeme, static_cast<int>(precedence));
+        const auto operator_token = previous_token();
+        const auto precedence = get_precedence(operator_token.kind);
+        LOX_TRACE("Parser: Binary operator '{}' has precedence {}", operator_token.lexeme,
+                  static_cast<int>(precedence));
 
         auto right_result =
             parse_expression_with_precedence(static_cast<Precedence>(static_cast<uint8_t>(precedence) + 1));
@@ -561,18 +542,13 @@ namespace lox::ast {
             return std::unexpected(right_result.error());
         }
 
-        spdlog::debug("Parser: Created binary expression with operator: {}", lexeme);
-        return std::make_unique<BinaryExpression>(std::move(left), operator_token, std::move(right_result.value()));
+        LOX_DEBUG("Parser: Created binary expression with operator: {}", operator_token.lexeme);
+        return m_arena.make<BinaryExpression>(left, operator_token, right_result.value());
     }
 
     auto Parser::parse_logical(ExprPtr left) noexcept -> std::expected<ExprPtr, std::string> {
-        const auto &operator_token = previous_token();
-
-        // Determine precedence based on logical operator
-        auto precedence = Precedence::logical_and;
-        if (operator_token.lexeme == "or") {
-            precedence = Precedence::logical_or;
-        }
+        const auto operator_token = previous_token();
+        const auto precedence = get_precedence(operator_token.kind);
 
         auto right_result =
             parse_expression_with_precedence(static_cast<Precedence>(static_cast<uint8_t>(precedence) + 1));
@@ -580,96 +556,105 @@ namespace lox::ast {
             return std::unexpected(right_result.error());
         }
 
-        return std::make_unique<LogicalExpression>(std::move(left), operator_token, std::move(right_result.value()));
+        return m_arena.make<LogicalExpression>(left, operator_token, right_result.value());
     }
 
     auto Parser::parse_assignment(ExprPtr left) noexcept -> std::expected<ExprPtr, std::string> {
-        const auto &equals = previous_token();
-
+        const auto equals = previous_token();
         auto value_result = parse_expression_with_precedence(Precedence::assignment);
         if (!value_result) {
             return std::unexpected(value_result.error());
         }
 
-        if (const auto var_expr = dynamic_cast<VariableExpression *>(left.get())) {
-            const auto &name = var_expr->name;
-            auto _ = left.release();
-            return std::make_unique<AssignmentExpression>(name, std::move(value_result.value()));
+        if (const auto *var_expr = as<VariableExpression>(left)) {
+            return m_arena.make<AssignmentExpression>(var_expr->name, value_result.value());
         }
 
-        return std::unexpected("Invalid assignment target");
+        return std::unexpected(located(equals, "Invalid assignment target"));
     }
 
     auto Parser::parse_call(ExprPtr left) noexcept -> std::expected<ExprPtr, std::string> {
-        return finish_call(std::move(left));
+        return finish_call(left);
     }
 
     auto Parser::finish_call(ExprPtr callee) noexcept -> std::expected<ExprPtr, std::string> {
-        std::vector<ExprPtr> arguments;
-
-        if (!check(syntax::TokenKind::punctuation) || current_token().lexeme != ")") {
-            auto arg_result = parse_expression();
-            if (!arg_result) {
-                return std::unexpected(arg_result.error());
-            }
-            arguments.push_back(std::move(arg_result.value()));
+        const auto mark = m_expr_scratch.size();
 
-            while (check(syntax::TokenKind::punctuation) && current_token().lexeme == ",") {
-                advance();
+        if (!check(syntax::TokenKind::right_paren)) {
+            do {
                 auto arg_result = parse_expression();
                 if (!arg_result) {
                     return std::unexpected(arg_result.error());
                 }
-                arguments.push_back(std::move(arg_result.value()));
-            }
+                m_expr_scratch.push_back(arg_result.value());
+            } while (match({syntax::TokenKind::comma}));
         }
 
-        auto paren_result = consume(syntax::TokenKind::punctuation, "Expected ')' after arguments");
-        if (!paren_result || paren_result.value().lexeme != ")") {
-            return std::unexpected("Expected ')' after arguments");
+        auto paren_result = consume(syntax::TokenKind::right_paren, "Expected ')' after arguments");
+        if (!paren_result) {
+            return std::unexpected(paren_result.error());
         }
 
-        return std::make_unique<CallExpression>(std::move(callee), paren_result.value(), std::move(arguments));
+        return m_arena.make<CallExpression>(callee, paren_result.value(), flush_scratch(m_expr_scratch, mark));
     }
 
-    auto Parser::parse_literal() const noexcept -> std::expected<ExprPtr, std::string> {
+    auto Parser::parse_literal() noexcept -> std::expected<ExprPtr, std::string> {
         const auto &token = previous_token();
-        spdlog::trace("Parser: parse_literal with token: {} ({})", token.lexeme, static_cast<int>(token.kind));
-        return std::make_unique<LiteralExpression>(token);
+        LOX_TRACE("Parser: parse_literal with token: {} ({})", token.lexeme, static_cast<int>(token.kind));
+        return m_arena.make<LiteralExpression>(token);
     }
 
-    auto Parser::parse_variable() const noexcept -> std::expected<ExprPtr, std::string> {
+    auto Parser::parse_variable() noexcept -> std::expected<ExprPtr, std::string> {
         const auto &token = previous_token();
-        spdlog::trace("Parser: parse_variable with name: {}", token.lexeme);
-        return std::make_unique<VariableExpression>(token);
+        LOX_TRACE("Parser: parse_variable with name: {}", token.lexeme);
+        return m_arena.make<VariableExpression>(token);
     }
 
-    auto Parser::get_rule(const syntax::TokenKind kind) const noexcept -> const ParseRule & {
-        static const ParseRule empty_rule{.prefix = nullptr, .infix = nullptr, .precedence = Precedence::none};
+    auto Parser::get_rule(const syntax::TokenKind kind) noexcept -> const ParseRule & {
+        static constexpr auto rules = [] {
+            std::array<ParseRule, syntax::token_kind_count> table{};
+            const auto rule = [&table](const syntax::TokenKind k) -> ParseRule & {
+                return table[static_cast<size_t>(k)];
+            };
 
-        if (const auto it = m_rules.find(kind); it != m_rules.end()) {
-            return it->second;
-        }
+            using enum syntax::TokenKind;
+
+            rule(left_paren) = {
+                .prefix = &Parser::parse_grouping, .infix = &Parser::parse_call, .precedence = Precedence::call};
+
+            rule(minus) = {
+                .prefix = &Parser::parse_unary, .infix = &Parser::parse_binary, .precedence = Precedence::term};
+            rule(plus) = {.infix = &Parser::parse_binary, .precedence = Precedence::term};
+            rule(star) = {.infix = &Parser::parse_binary, .precedence = Precedence::factor};
+            rule(slash) = {.infix = &Parser::parse_binary, .precedence = Precedence::factor};
+            rule(bang) = {.prefix = &Parser::parse_unary};
+
+            rule(bang_equal) = {.infix = &Parser::parse_binary, .precedence = Precedence::equality};
+            rule(equal_equal) = {.infix = &Parser::parse_binary, .precedence = Precedence::equality};
+            rule(less) = {.infix = &Parser::parse_binary, .precedence = Precedence::comparison};
+            rule(less_equal) = {.infix = &Parser::parse_binary, .precedence = Precedence::comparison};
+            rule(greater) = {.infix = &Parser::parse_binary, .precedence = Precedence::comparison};
+            rule(greater_equal) = {.infix = &Parser::parse_binary, .precedence = Precedence::comparison};
+
+            rule(equal) = {.infix = &Parser::parse_assignment, .precedence = Precedence::assignment};
 
-        return empty_rule;
+            rule(identifier) = {.prefix = &Parser::parse_variable};
+            rule(number_literal) = {.prefix = &Parser::parse_literal};
+            rule(string_literal) = {.prefix = &Parser::parse_literal};
+            rule(keyword_true) = {.prefix = &Parser::parse_literal};
+            rule(keyword_false) = {.prefix = &Parser::parse_literal};
+            rule(keyword_nil) = {.prefix = &Parser::parse_literal};
+
+            rule(keyword_and) = {.infix = &Parser::parse_logical, .precedence = Precedence::logical_and};
+            rule(keyword_or) = {.infix = &Parser::parse_logical, .precedence = Precedence::logical_or};
+
+            return table;
+        }();
+
+        return rules[static_cast<size_t>(kind)];
     }
 
-    auto Parser::get_precedence(const syntax::TokenKind kind) const noexcept -> Precedence {
-        if (kind == syntax::TokenKind::simple_operator) {
-            const auto &token = current_token();
-            if (token.lexeme == "*" || token.lexeme == "/") {
-                return Precedence::factor;
-            }
-            if (token.lexeme == "+" || token.lexeme == "-") {
-                return Precedence::term;
-            }
-            if (token.lexeme == "<" || token.lexeme == ">" || token.lexeme == "!") {
-                return Precedence::comparison;
-            }
-            if (token.lexeme == "=") {
-                return Precedence::assignment;
-            }
-        }
+    auto Parser::get_precedence(const syntax::TokenKind kind) noexcept -> Precedence {
         return get_rule(kind).precedence;
     }
 
@@ -678,18 +663,24 @@ namespace lox::ast {
         advance();
 
         while (!is_at_end()) {
-            if (previous_token().lexeme == ";") {
-                spdlog::debug("Parser: Synchronized at semicolon");
+            if (previous_token().kind == syntax::TokenKind::semicolon) {
+                LOX_DEBUG("Parser: Synchronized at semicolon");
                 return;
             }
 
-            if (current_token().kind == syntax::TokenKind::keyword) {
-                if (const auto &lexeme = current_token().lexeme;
-                    lexeme == "class" || lexeme == "fun" || lexeme == "var" || lexeme == "for" || lexeme == "if" ||
-                    lexeme == "while" || lexeme == "print" || lexeme == "return") {
-                    spdlog::debug("Parser: Synchronized at keyword: {}", lexeme);
-                    return;
-                }
+            switch (current_token().kind) {
+            case syntax::TokenKind::keyword_class:
+            case syntax::TokenKind::keyword_fun:
+            case syntax::TokenKind::keyword_var:
+            case syntax::TokenKind::keyword_for:
+            case syntax::TokenKind::keyword_if:
+            case syntax::TokenKind::keyword_while:
+            case syntax::TokenKind::keyword_print:
+            case syntax::TokenKind::keyword_return:
+                LOX_DEBUG("Parser: Synchronized at keyword: {}", current_token().lexeme);
+                return;
+            default:
+                break;
             }
 
             advance();
@@ -698,90 +689,4 @@ namespace lox::ast {
         spdlog::warn("Parser: Reached end of file while synchronizing");
     }
 
-    void Parser::initialize_parse_rules() noexcept {
-        spdlog::trace("Parser: Initializing parse rules");
-        m_rules[syntax::TokenKind::punctuation] =
-            ParseRule{.prefix = [this]() -> std::expected<ExprPtr, std::string> {
-                          if (const auto &token = previous_token(); token.lexeme == "(") {
-                              return parse_grouping();
-                          }
-                          return std::unexpected("Unexpected punctuation in expression");
-                      },
-                      .infix = nullptr,
-                      .precedence = Precedence::none};
-
-        // TODO: Add specific rules for different operator precedences.
-        // auto add_operator_rule = [this](const std::string &op, Precedence
-        // prec) {
-        //   // This will be handled by the general simple_operator rule above.
-        // };
-
-        m_rules[syntax::TokenKind::simple_operator] =
-            ParseRule{.prefix = [this]() -> std::expected<ExprPtr, std::string> {
-                          if (const auto &token = previous_token(); token.lexeme == "-" || token.lexeme == "!") {
-                              return parse_unary();
-                          }
-                          return std::unexpected("Unexpected operator in prefix position");
-                      },
-                      .infix = [this](ExprPtr left) -> std::expected<ExprPtr, std::string> {
-                          const auto &token = previous_token();
-                          if (token.lexeme == "=") {
-                              return parse_assignment(std::move(left));
-                          }
-                          if (token.lexeme == "+" || token.lexeme == "-") {
-                              return parse_binary(std::move(left));
-                          }
-                          if (token.lexeme == "*" || token.lexeme == "/") {
-                              return parse_binary(std::move(left));
-                          }
-                          if (token.lexeme == "<" || token.lexeme == ">" || token.lexeme == "!") {
-                              return parse_binary(std::move(left));
-                          }
-                          return std::unexpected("Unexpected operator in infix position");
-                      },
-                      .precedence = Precedence::term};
-
-        m_rules[syntax::TokenKind::compound_operator] =
-            ParseRule{.prefix = nullptr,
-                      .infix = [this](ExprPtr left) -> std::expected<ExprPtr, std::string> {
-                          return parse_binary(std::move(left));
-                      },
-                      .precedence = Precedence::equality};
-
-        m_rules[syntax::TokenKind::identifier] =
-            ParseRule{.prefix = [this]() -> std::expected<ExprPtr, std::string> { return parse_variable(); },
-                      .infix = nullptr,
-                      .precedence = Precedence::none};
-
-        m_rules[syntax::TokenKind::number_literal] =
-            ParseRule{.prefix = [this]() -> std::expected<ExprPtr, std::string> { return parse_literal(); },
-                      .infix = nullptr,
-                      .precedence = Precedence::none};
-
-        m_rules[syntax::TokenKind::string_literal] =
-            ParseRule{.prefix = [this]() -> std::expected<ExprPtr, std::string> { return parse_literal(); },
-                      .infix = nullptr,
-                      .precedence = Precedence::none};
-
-        m_rules[syntax::TokenKind::keyword] =
-            ParseRule{.prefix = [this]() -> std::expected<ExprPtr, std::string> {
-                          if (const auto &token = previous_token();
-                              token.lexeme == "true" || token.lexeme == "false" || token.lexeme == "nil") {
-                              return parse_literal();
-                          }
-                          return std::unexpected("Unexpected keyword in expression");
-                      },
-                      .infix = [this](ExprPtr left) -> std::expected<ExprPtr, std::string> {
-                          const auto &token = previous_token();
-                          if (token.lexeme == "and") {
-                              return parse_logical(std::move(left));
-                          }
-                          if (token.lexeme == "or") {
-                              return parse_logical(std::move(left));
-                          }
-                          return std::unexpected("Unexpected keyword in infix position");
-                      },
-                      .precedence = Precedence::logical_or};
-    }
-
 } // namespace lox::ast
@@ -1,16 +1,21 @@
 #ifndef LOX_AST_PARSE_HPP
 #define LOX_AST_PARSE_HPP
 
+#include "lox/ast/arena.hpp"
 #include "lox/ast/expr.hpp"
+#include "lox/ast/program.hpp"
 #include "lox/ast/stmt.hpp"
+#include "lox/syntax/location.hpp"
+#include "lox/syntax/source.hpp"
+#include "lox/syntax/stream.hpp"
 #include "lox/syntax/token.hpp"
 
+#include <cstddef>
 #include <cstdint>
 #include <expected>
-#include <functional>
 #include <initializer_list>
+#include <span>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
 namespace lox::ast {
@@ -32,6 +37,7 @@ namespace lox::ast {
     class Parser final {
     public:
         explicit Parser(std::string_view source) noexcept;
+        explicit Parser(const syntax::SourceFile &file) noexcept;
 
         Parser(const Parser &) = delete;
         Parser(Parser &&) = delete;
@@ -40,15 +46,16 @@ namespace lox::ast {
 
         ~Parser() = default;
 
-        auto parse() noexcept -> std::expected<std::vector<StmtPtr>, std::string>;
+        /// Parses the whole source. The parser hands its arena to the returned program, so it parses only once.
+        auto parse() noexcept -> std::expected<Program, std::string>;
 
     private:
-        using PrefixParseFn = std::function<std::expected<ExprPtr, std::string>()>;
-        using InfixParseFn = std::function<std::expected<ExprPtr, std::string>(ExprPtr)>;
+        using PrefixParseFn = auto (Parser::*)() noexcept -> std::expected<ExprPtr, std::string>;
+        using InfixParseFn = auto (Parser::*)(ExprPtr) noexcept -> std::expected<ExprPtr, std::string>;
 
         struct ParseRule {
-            PrefixParseFn prefix;
-            InfixParseFn infix;
+            PrefixParseFn prefix = nullptr;
+            InfixParseFn infix = nullptr;
             Precedence precedence{0};
         };
 
@@ -83,21 +90,33 @@ namespace lox::ast {
         auto parse_logical(ExprPtr left) noexcept -> std::expected<ExprPtr, std::string>;
         auto parse_assignment(ExprPtr left) noexcept -> std::expected<ExprPtr, std::string>;
         auto parse_call(ExprPtr left) noexcept -> std::expected<ExprPtr, std::string>;
-        [[nodiscard]] auto parse_literal() const noexcept -> std::expected<ExprPtr, std::string>;
-        [[nodiscard]] auto parse_variable() const noexcept -> std::expected<ExprPtr, std::string>;
+        auto parse_literal() noexcept -> std::expected<ExprPtr, std::string>;
+        auto parse_variable() noexcept -> std::expected<ExprPtr, std::string>;
 
         auto finish_call(ExprPtr callee) noexcept -> std::expected<ExprPtr, std::string>;
 
-        [[nodiscard]] auto get_rule(syntax::TokenKind kind) const noexcept -> const ParseRule &;
-        [[nodiscard]] auto get_precedence(syntax::TokenKind kind) const noexcept -> Precedence;
+        /// Looks up the Pratt rule for @p kind in a constexpr table indexed by token kind.
+        [[nodiscard]] static auto get_rule(syntax::TokenKind kind) noexcept -> const ParseRule &;
+        [[nodiscard]] static auto get_precedence(syntax::TokenKind kind) noexcept -> Precedence;
 
         auto synchronize() noexcept -> void;
 
-        std::vector<syntax::Token> m_tokens;
-        size_t m_current;
-        std::unordered_map<syntax::TokenKind, ParseRule> m_rules;
+        /// Moves the items pushed onto @p scratch since @p mark into the arena and pops them.
+        template <typename T> auto flush_scratch(std::vector<T> &scratch, std::size_t mark) -> std::span<T>;
 
-        void initialize_parse_rules() noexcept;
+        /// Prefixes @p message with the file, line and column of @p span when parsing a SourceFile.
+        [[nodiscard]] auto located(const syntax::Span &span, std::string message) const -> std::string;
+        [[nodiscard]] auto located(const syntax::Token &token, std::string message) const -> std::string;
+
+        syntax::TokenStream m_tokens;
+        const syntax::SourceFile *m_file = nullptr;
+        Arena m_arena;
+
+        // Lists are collected on these stacks while they are parsed, then copied into the arena with their final size.
+        // Nested lists push above their parent's items, so one stack per element type serves the whole parse.
+        std::vector<StmtPtr> m_stmt_scratch;
+        std::vector<ExprPtr> m_expr_scratch;
+        std::vector<syntax::Token> m_token_scratch;
     };
 
 } // namespace lox::ast
@@ -0,0 +1,44 @@
+#ifndef LOX_AST_PROGRAM_HPP
+#define LOX_AST_PROGRAM_HPP
+
+#include "lox/ast/arena.hpp"
+#include "lox/ast/stmt.hpp"
+
+#include <span>
+#include <utility>
+
+namespace lox::ast {
+
+    /**
+     * @brief A parsed script: its top-level statements together with the arena that owns every node.
+     *
+     * Nodes borrow their lexemes from the source text, which must outlive the program. Lexemes made up by passes
+     * that rewrite the tree, such as ast::fold_constants, live in the arena instead.
+     */
+    class Program final {
+    public:
+        Program(Arena arena, const std::span<StmtPtr> statements) noexcept
+            : m_arena{std::move(arena)}, m_statements{statements} {}
+
+        Program(const Program &) = delete;
+        Program(Program &&) noexcept = default;
+        auto operator=(const Program &) -> Program & = delete;
+        auto operator=(Program &&) noexcept -> Program & = default;
+
+        ~Program() = default;
+
+        [[nodiscard]] auto statements() const noexcept -> std::span<const StmtPtr> { return m_statements; }
+        [[nodiscard]] auto statements() noexcept -> std::span<StmtPtr> { return m_statements; }
+        [[nodiscard]] auto size() const noexcept -> size_t { return m_statements.size(); }
+
+        [[nodiscard]] auto arena() noexcept -> Arena & { return m_arena; }
+        [[nodiscard]] auto arena() const noexcept -> const Arena & { return m_arena; }
+
+    private:
+        Arena m_arena;
+        std::span<StmtPtr> m_statements;
+    };
+
+} // namespace lox::ast
+
+#endif // LOX_AST_PROGRAM_HPP
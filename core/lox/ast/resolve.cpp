@@ -0,0 +1,308 @@
+#include "lox/ast/resolve.hpp"
+
+#include "lox/ast/arena.hpp"
+#include "lox/ast/expr.hpp"
+#include "lox/ast/program.hpp"
+#include "lox/ast/stmt.hpp"
+#include "lox/syntax/source.hpp"
+#include "lox/syntax/token.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <format>
+#include <limits>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace lox::ast {
+
+    namespace {
+
+        /// One more than the largest one-byte operand, the limit on locals and upvalues per function.
+        constexpr std::size_t max_slots = std::numeric_limits<std::uint8_t>::max() + 1;
+
+        class Resolver {
+        public:
+            Resolver(Arena &arena, const syntax::SourceFile *file) noexcept : m_arena(arena), m_file(file) {}
+
+            auto resolve(const std::span<StmtPtr> stmts) -> std::expected<void, std::string> {
+                FunctionScope script{.enclosing = nullptr, .is_script = true};
+                begin_function(script);
+                statements(stmts);
+                m_function = nullptr;
+
+                if (m_error) {
+                    return std::unexpected(std::move(*m_error));
+                }
+                return {};
+            }
+
+        private:
+            struct Local {
+                std::string_view name;
+                /// The scope depth the local was declared at, or -1 while its initializer is being resolved.
+                int depth;
+                /// The declaration's captured flag; null for the callee slot and parameters, which the frame's
+                /// return closes anyway.
+                bool *captured;
+            };
+
+            struct FunctionScope {
+                FunctionScope *enclosing;
+                bool is_script;
+                std::vector<Local> locals{};
+                std::vector<Capture> upvalues{};
+                int scope_depth = 0;
+            };
+
+            // --- Statements ---
+
+            auto statements(const std::span<StmtPtr> stmts) -> void {
+                for (auto *stmt : stmts) {
+                    statement(stmt);
+                }
+            }
+
+            auto statement(Statement *stmt) -> void {
+                if (stmt != nullptr && !m_error) {
+                    visit(*stmt, [this](auto &node) { resolve_node(node); });
+                }
+            }
+
+            auto resolve_node(ExpressionStatement &stmt) -> void { expression(stmt.expression); }
+            auto resolve_node(PrintStatement &stmt) -> void { expression(stmt.expression); }
+
+            auto resolve_node(VarStatement &stmt) -> void {
+                declare(stmt.name, &stmt.captured);
+                expression(stmt.initializer);
+                define();
+            }
+
+            auto resolve_node(BlockStatement &stmt) -> void {
+                ++m_function->scope_depth;
+                statements(stmt.statements);
+                end_scope();
+            }
+
+            auto resolve_node(IfStatement &stmt) -> void {
+                expression(stmt.condition);
+                statement(stmt.then_branch);
+                statement(stmt.else_branch);
+            }
+
+            auto resolve_node(WhileStatement &stmt) -> void {
+                expression(stmt.condition);
+                statement(stmt.body);
+            }
+
+            auto resolve_node(ForStatement &stmt) -> void {
+                ++m_function->scope_depth;
+                statement(stmt.initializer);
+                expression(stmt.condition);
+                expression(stmt.increment);
+                statement(stmt.body);
+                end_scope();
+            }
+
+            auto resolve_node(ReturnStatement &stmt) -> void {
+                if (m_function->is_script) {
+                    error(stmt.keyword, "Can't return from top-level code.");
+                    return;
+                }
+                expression(stmt.value);
+            }
+
+            auto resolve_node(FunctionDeclarationStatement &stmt) -> void {
+                declare(stmt.name, &stmt.captured);
+                // A function may refer to itself, so its name is usable before the body is resolved.
+                define();
+
+                FunctionScope scope{.enclosing = m_function, .is_script = false};
+                begin_function(scope);
+                ++scope.scope_depth;
+
+                if (stmt.parameters.size() >= max_slots) {
+                    error(stmt.name, "Can't have more than 255 parameters.");
+                } else {
+                    for (const auto &parameter : stmt.parameters) {
+                        declare(parameter, nullptr);
+                        define();
+                    }
+                    statements(stmt.body);
+                }
+
+                stmt.upvalues = m_arena.copy(std::span<const Capture>{scope.upvalues});
+                m_function = scope.enclosing;
+            }
+
+            // --- Expressions ---
+
+            auto expression(Expression *expr) -> void {
+                if (expr != nullptr && !m_error) {
+                    visit(*expr, [this](auto &node) { resolve_node(node); });
+                }
+            }
+
+            auto resolve_node(BinaryExpression &expr) -> void {
+                expression(expr.left);
+                expression(expr.right);
+            }
+
+            auto resolve_node(UnaryExpression &expr) -> void { expression(expr.operand); }
+            auto resolve_node(GroupingExpression &expr) -> void { expression(expr.expression); }
+            auto resolve_node(LiteralExpression & /*expr*/) -> void {}
+            auto resolve_node(VariableExpression &expr) -> void { expr.binding = bind(*m_function, expr.name); }
+
+            auto resolve_node(AssignmentExpression &expr) -> void {
+                expression(expr.value);
+                expr.binding = bind(*m_function, expr.name);
+            }
+
+            auto resolve_node(LogicalExpression &expr) -> void {
+                expression(expr.left);
+                expression(expr.right);
+            }
+
+            auto resolve_node(CallExpression &expr) -> void {
+                expression(expr.callee);
+                for (auto *argument : expr.arguments) {
+                    expression(argument);
+                }
+            }
+
+            // --- Scopes ---
+
+            auto begin_function(FunctionScope &scope) -> void {
+                scope.locals.reserve(max_slots);
+                // Slot zero holds the callee itself and has no name.
+                scope.locals.push_back(Local{.name = {}, .depth = 0, .captured = nullptr});
+                m_function = &scope;
+            }
+
+            auto end_scope() -> void {
+                --m_function->scope_depth;
+                auto &locals = m_function->locals;
+                while (!locals.empty() && locals.back().depth > m_function->scope_depth) {
+                    locals.pop_back();
+                }
+            }
+
+            /// Adds a local for @p name to the innermost scope; at depth zero the name is a global and nothing happens.
+            auto declare(const syntax::Token &name, bool *captured) -> void {
+                auto &function = *m_function;
+                if (function.scope_depth == 0) {
+                    return;
+                }
+
+                for (auto it = function.locals.rbegin(); it != function.locals.rend(); ++it) {
+                    if (it->depth != -1 && it->depth < function.scope_depth) {
+                        break;
+                    }
+                    if (it->name == name.lexeme) {
+                        error(name, "Already a variable with this name in this scope.");
+                        return;
+                    }
+                }
+
+                if (function.locals.size() == max_slots) {
+                    error(name, "Too many local variables in function.");
+                    return;
+                }
+                function.locals.push_back(Local{.name = name.lexeme, .depth = -1, .captured = captured});
+            }
+
+            /// Makes the local declared last readable.
+            auto define() noexcept -> void {
+                auto &function = *m_function;
+                if (function.scope_depth > 0 && !function.locals.empty()) {
+                    function.locals.back().depth = function.scope_depth;
+                }
+            }
+
+            auto bind(FunctionScope &function, const syntax::Token &name) -> Binding {
+                if (const auto slot = resolve_local(function, name)) {
+                    return {.kind = Binding::Kind::local, .index = *slot};
+                }
+                if (const auto upvalue = resolve_upvalue(function, name)) {
+                    return {.kind = Binding::Kind::upvalue, .index = *upvalue};
+                }
+                return {.kind = Binding::Kind::global};
+            }
+
+            auto resolve_local(const FunctionScope &function, const syntax::Token &name) -> std::optional<uint8_t> {
+                for (auto i = function.locals.size(); i-- > 0;) {
+                    const auto &local = function.locals[i];
+                    if (local.name == name.lexeme) {
+                        if (local.depth == -1) {
+                            error(name, "Can't read local variable in its own initializer.");
+                        }
+                        return static_cast<uint8_t>(i);
+                    }
+                }
+                return std::nullopt;
+            }
+
+            /// Finds @p name in the functions enclosing @p function, threading it through each one as an upvalue.
+            auto resolve_upvalue(FunctionScope &function, const syntax::Token &name) -> std::optional<uint8_t> {
+                if (function.enclosing == nullptr) {
+                    return std::nullopt;
+                }
+                if (const auto slot = resolve_local(*function.enclosing, name)) {
+                    if (auto *captured = function.enclosing->locals[*slot].captured; captured != nullptr) {
+                        *captured = true;
+                    }
+                    return add_upvalue(function, name, Capture{.index = *slot, .is_local = true});
+                }
+                if (const auto upvalue = resolve_upvalue(*function.enclosing, name)) {
+                    return add_upvalue(function, name, Capture{.index = *upvalue, .is_local = false});
+                }
+                return std::nullopt;
+            }
+
+            auto add_upvalue(FunctionScope &function, const syntax::Token &name, const Capture capture) -> uint8_t {
+                auto &upvalues = function.upvalues;
+                for (std::size_t i = 0; i < upvalues.size(); ++i) {
+                    if (upvalues[i].index == capture.index && upvalues[i].is_local == capture.is_local) {
+                        return static_cast<uint8_t>(i);
+                    }
+                }
+                if (upvalues.size() == max_slots) {
+                    error(name, "Too many closure variables in function.");
+                    return 0;
+                }
+                upvalues.push_back(capture);
+                return static_cast<uint8_t>(upvalues.size() - 1);
+            }
+
+            /// Records @p message as the error, located at @p token; only the first error is kept.
+            auto error(const syntax::Token &token, const std::string_view message) -> void {
+                if (m_error) {
+                    return;
+                }
+                if (m_file == nullptr) {
+                    m_error = std::format("Compile error at '{}': {}", token.lexeme, message);
+                    return;
+                }
+                m_error = std::format("{}: Compile error at '{}': {}", m_file->locate(token.span.start).to_string(),
+                                      token.lexeme, message);
+            }
+
+            Arena &m_arena;
+            const syntax::SourceFile *m_file;
+            FunctionScope *m_function = nullptr;
+            std::optional<std::string> m_error;
+        };
+
+    } // namespace
+
+    auto resolve(Program &program, const syntax::SourceFile *file) -> std::expected<void, std::string> {
+        Resolver resolver{program.arena(), file};
+        return resolver.resolve(program.statements());
+    }
+
+} // namespace lox::ast
@@ -0,0 +1,29 @@
+#ifndef LOX_AST_RESOLVE_HPP
+#define LOX_AST_RESOLVE_HPP
+
+#include "lox/ast/program.hpp"
+#include "lox/syntax/source.hpp"
+
+#include <expected>
+#include <string>
+
+namespace lox::ast {
+
+    /**
+     * @brief Binds every variable reference in @p program to a local slot, an upvalue or a global.
+     *
+     * Scopes are opened by blocks, function declarations and for loops, mirroring the compiler: slot zero of each
+     * function holds the callee, parameters follow, then locals in declaration order. A name found in an enclosing
+     * function becomes an upvalue of every function in between, and the local it refers to is marked captured.
+     * Names not declared in any enclosing scope are globals.
+     *
+     * Misuse that scoping makes detectable is reported here, before any code is generated: reading a local in its
+     * own initializer, redeclaring a local in the same scope, returning from top-level code, and exceeding the
+     * per-function limits on parameters, locals and upvalues. Only the first error is returned, located in @p file
+     * when one is given.
+     */
+    auto resolve(Program &program, const syntax::SourceFile *file = nullptr) -> std::expected<void, std::string>;
+
+} // namespace lox::ast
+
+#endif // LOX_AST_RESOLVE_HPP
@@ -2,78 +2,106 @@
 #define LOX_AST_STMT_HPP
 
 #include "lox/ast/expr.hpp"
+#include "lox/support/trace.hpp"
 #include "lox/syntax/token.hpp"
 
-#include <spdlog/spdlog.h>
-
+#include <concepts>
+#include <cstdint>
 #include <format>
-#include <memory>
+#include <span>
 #include <string>
 #include <utility>
-#include <vector>
 
 namespace lox::ast {
 
+    /// Identifies the concrete type of a statement node. The set of nodes is closed.
+    enum class StmtKind : uint8_t { expression, print, var, block, if_, while_, for_, return_, function };
+
+    /**
+     * @brief Base of all statement nodes. Like expressions, statements are arena-allocated, never destroyed
+     * individually, and dispatched on @c kind through ast::visit.
+     */
     struct Statement {
-        Statement() = default;
+        const StmtKind kind;
+
         Statement(const Statement &) = delete;
         auto operator=(const Statement &) -> Statement & = delete;
         Statement(Statement &&) = delete;
         auto operator=(Statement &&) -> Statement & = delete;
-        virtual ~Statement() = default;
 
-        [[nodiscard]] virtual auto to_string() const noexcept -> std::string = 0;
+        [[nodiscard]] auto to_string() const noexcept -> std::string;
+
+    protected:
+        explicit Statement(const StmtKind k) noexcept : kind(k) {}
+        ~Statement() = default;
     };
 
-    using StmtPtr = std::unique_ptr<Statement>;
+    /// A non-owning pointer to an arena-allocated statement.
+    using StmtPtr = Statement *;
+
+    /// A variable a function closes over: a local slot of the enclosing function, or one of its upvalues.
+    struct Capture {
+        uint8_t index;
+        bool is_local;
+    };
 
     struct ExpressionStatement : Statement {
+        static constexpr auto node_kind = StmtKind::expression;
+
         ExprPtr expression;
 
-        explicit ExpressionStatement(ExprPtr expr) noexcept : expression(std::move(expr)) {
-            spdlog::trace("AST: Created ExpressionStatement");
+        explicit ExpressionStatement(ExprPtr expr) noexcept : Statement(node_kind), expression(expr) {
+            LOX_TRACE("AST: Created ExpressionStatement");
         }
 
-        [[nodiscard]] auto to_string() const noexcept -> std::string override {
+        [[nodiscard]] auto to_string() const noexcept -> std::string {
             return std::format("expr-stmt{{ expr: {} }}", expression->to_string());
         }
     };
 
     struct PrintStatement : Statement {
+        static constexpr auto node_kind = StmtKind::print;
+
         ExprPtr expression;
 
-        explicit PrintStatement(ExprPtr expr) noexcept : expression(std::move(expr)) {
-            spdlog::trace("AST: Created PrintStatement");
+        explicit PrintStatement(ExprPtr expr) noexcept : Statement(node_kind), expression(expr) {
+            LOX_TRACE("AST: Created PrintStatement");
         }
 
-        [[nodiscard]] auto to_string() const noexcept -> std::string override {
+        [[nodiscard]] auto to_string() const noexcept -> std::string {
             return std::format("print-stmt{{ expr: {} }}", expression->to_string());
         }
     };
 
     struct VarStatement : Statement {
+        static constexpr auto node_kind = StmtKind::var;
+
         syntax::Token name;
         ExprPtr initializer;
+        /// Whether a closure captures this local, so leaving its scope must move it off the stack.
+        bool captured = false;
 
         explicit VarStatement(syntax::Token n, ExprPtr init = nullptr) noexcept
-            : name(n), initializer(std::move(init)) {
-            spdlog::debug("AST: Created VarStatement for variable '{}'", n.lexeme);
+            : Statement(node_kind), name(n), initializer(init) {
+            LOX_DEBUG("AST: Created VarStatement for variable '{}'", n.lexeme);
         }
 
-        [[nodiscard]] auto to_string() const noexcept -> std::string override {
+        [[nodiscard]] auto to_string() const noexcept -> std::string {
             return std::format("var-stmt{{ name: {}, initializer: {} }}", name.to_string(),
                                initializer ? initializer->to_string() : "null");
         }
     };
 
     struct BlockStatement : Statement {
-        std::vector<StmtPtr> statements;
+        static constexpr auto node_kind = StmtKind::block;
 
-        explicit BlockStatement(std::vector<StmtPtr> stmts) noexcept : statements(std::move(stmts)) {
-            spdlog::debug("AST: Created BlockStatement with {} statements", statements.size());
+        std::span<StmtPtr> statements;
+
+        explicit BlockStatement(std::span<StmtPtr> stmts) noexcept : Statement(node_kind), statements(stmts) {
+            LOX_DEBUG("AST: Created BlockStatement with {} statements", statements.size());
         }
 
-        [[nodiscard]] auto to_string() const noexcept -> std::string override {
+        [[nodiscard]] auto to_string() const noexcept -> std::string {
             std::string stmts_str;
             for (const auto &stmt : statements) {
                 if (!stmts_str.empty())
@@ -85,47 +113,52 @@ namespace lox::ast {
     };
 
     struct IfStatement : Statement {
+        static constexpr auto node_kind = StmtKind::if_;
+
         ExprPtr condition;
         StmtPtr then_branch;
         StmtPtr else_branch;
 
         IfStatement(ExprPtr cond, StmtPtr then_stmt, StmtPtr else_stmt = nullptr) noexcept
-            : condition(std::move(cond)), then_branch(std::move(then_stmt)), else_branch(std::move(else_stmt)) {
-            spdlog::debug("AST: Created IfStatement {}else branch", else_branch ? "with " : "without ");
+            : Statement(node_kind), condition(cond), then_branch(then_stmt), else_branch(else_stmt) {
+            LOX_DEBUG("AST: Created IfStatement {}else branch", else_branch ? "with " : "without ");
         }
 
-        [[nodiscard]] auto to_string() const noexcept -> std::string override {
+        [[nodiscard]] auto to_string() const noexcept -> std::string {
             return std::format("if-stmt{{ condition: {}, then: {}, else: {} }}", condition->to_string(),
                                then_branch->to_string(), else_branch ? else_branch->to_string() : "null");
         }
     };
 
     struct WhileStatement : Statement {
+        static constexpr auto node_kind = StmtKind::while_;
+
         ExprPtr condition;
         StmtPtr body;
 
-        WhileStatement(ExprPtr cond, StmtPtr stmt) noexcept : condition(std::move(cond)), body(std::move(stmt)) {
-            spdlog::debug("AST: Created WhileStatement");
+        WhileStatement(ExprPtr cond, StmtPtr stmt) noexcept : Statement(node_kind), condition(cond), body(stmt) {
+            LOX_DEBUG("AST: Created WhileStatement");
         }
 
-        [[nodiscard]] auto to_string() const noexcept -> std::string override {
+        [[nodiscard]] auto to_string() const noexcept -> std::string {
             return std::format("while-stmt{{ condition: {}, body: {} }}", condition->to_string(), body->to_string());
         }
     };
 
     struct ForStatement : Statement {
+        static constexpr auto node_kind = StmtKind::for_;
+
         StmtPtr initializer;
         ExprPtr condition;
         ExprPtr increment;
         StmtPtr body;
 
         ForStatement(StmtPtr init, ExprPtr cond, ExprPtr inc, StmtPtr stmt) noexcept
-            : initializer(std::move(init)), condition(std::move(cond)), increment(std::move(inc)),
-              body(std::move(stmt)) {
-            spdlog::debug("AST: Created ForStatement");
+            : Statement(node_kind), initializer(init), condition(cond), increment(inc), body(stmt) {
+            LOX_DEBUG("AST: Created ForStatement");
         }
 
-        [[nodiscard]] auto to_string() const noexcept -> std::string override {
+        [[nodiscard]] auto to_string() const noexcept -> std::string {
             return std::format("for-stmt{{ init: {}, condition: {}, increment: {}, body: {} }}",
                                initializer ? initializer->to_string() : "null",
                                condition ? condition->to_string() : "null", increment ? increment->to_string() : "null",
@@ -134,33 +167,40 @@ namespace lox::ast {
     };
 
     struct ReturnStatement : Statement {
+        static constexpr auto node_kind = StmtKind::return_;
+
         syntax::Token keyword;
         ExprPtr value;
 
         explicit ReturnStatement(syntax::Token kw, ExprPtr val = nullptr) noexcept
-            : keyword(std::move(kw)), value(std::move(val)) {
-            spdlog::debug("AST: Created ReturnStatement {}return value", value ? "with " : "without ");
+            : Statement(node_kind), keyword(kw), value(val) {
+            LOX_DEBUG("AST: Created ReturnStatement {}return value", value ? "with " : "without ");
         }
 
-        [[nodiscard]] auto to_string() const noexcept -> std::string override {
+        [[nodiscard]] auto to_string() const noexcept -> std::string {
             return std::format("return-stmt{{ value: {} }}", value ? value->to_string() : "null");
         }
     };
 
     struct FunctionDeclarationStatement : Statement {
-        syntax::Token name;
-        std::vector<syntax::Token> parameters;
-        std::vector<StmtPtr> body;
+        static constexpr auto node_kind = StmtKind::function;
 
-        FunctionDeclarationStatement(syntax::Token n, std::vector<syntax::Token> params,
-                                     std::vector<StmtPtr> stmts) noexcept
-            : name(n), parameters(std::move(params)), body(std::move(stmts)) {
-            spdlog::info("AST: Created FunctionDeclarationStatement '{}' with {} "
-                         "parameters and {} statements",
-                         n.lexeme, parameters.size(), body.size());
+        syntax::Token name;
+        std::span<syntax::Token> parameters;
+        std::span<StmtPtr> body;
+        /// Whether a closure captures the function's own name; see VarStatement::captured.
+        bool captured = false;
+        /// The variables the function closes over, in upvalue index order. Filled in by ast::resolve.
+        std::span<Capture> upvalues;
+
+        FunctionDeclarationStatement(syntax::Token n, std::span<syntax::Token> params,
+                                     std::span<StmtPtr> stmts) noexcept
+            : Statement(node_kind), name(n), parameters(params), body(stmts) {
+            LOX_DEBUG("AST: Created FunctionDeclarationStatement '{}' with {} parameters and {} statements", n.lexeme,
+                      parameters.size(), body.size());
         }
 
-        [[nodiscard]] auto to_string() const noexcept -> std::string override {
+        [[nodiscard]] auto to_string() const noexcept -> std::string {
             std::string params_str;
             for (const auto &param : parameters) {
                 if (!params_str.empty())
@@ -180,6 +220,74 @@ namespace lox::ast {
         }
     };
 
+    template <typename T>
+    concept StatementNode = std::derived_from<T, Statement> && requires {
+        { T::node_kind } -> std::convertible_to<StmtKind>;
+    };
+
+    /// Calls @p visitor with @p stmt downcast to its concrete node type; see the expression overload.
+    template <typename Visitor> decltype(auto) visit(const Statement &stmt, Visitor &&visitor) {
+        switch (stmt.kind) {
+        case StmtKind::expression:
+            return std::forward<Visitor>(visitor)(static_cast<const ExpressionStatement &>(stmt));
+        case StmtKind::print:
+            return std::forward<Visitor>(visitor)(static_cast<const PrintStatement &>(stmt));
+        case StmtKind::var:
+            return std::forward<Visitor>(visitor)(static_cast<const VarStatement &>(stmt));
+        case StmtKind::block:
+            return std::forward<Visitor>(visitor)(static_cast<const BlockStatement &>(stmt));
+        case StmtKind::if_:
+            return std::forward<Visitor>(visitor)(static_cast<const IfStatement &>(stmt));
+        case StmtKind::while_:
+            return std::forward<Visitor>(visitor)(static_cast<const WhileStatement &>(stmt));
+        case StmtKind::for_:
+            return std::forward<Visitor>(visitor)(static_cast<const ForStatement &>(stmt));
+        case StmtKind::return_:
+            return std::forward<Visitor>(visitor)(static_cast<const ReturnStatement &>(stmt));
+        case StmtKind::function:
+            return std::forward<Visitor>(visitor)(static_cast<const FunctionDeclarationStatement &>(stmt));
+        }
+        std::unreachable();
+    }
+
+    /// Calls @p visitor with a mutable reference to @p stmt's concrete node; see the expression overload.
+    template <typename Visitor> decltype(auto) visit(Statement &stmt, Visitor &&visitor) {
+        switch (stmt.kind) {
+        case StmtKind::expression:
+            return std::forward<Visitor>(visitor)(static_cast<ExpressionStatement &>(stmt));
+        case StmtKind::print:
+            return std::forward<Visitor>(visitor)(static_cast<PrintStatement &>(stmt));
+        case StmtKind::var:
+            return std::forward<Visitor>(visitor)(static_cast<VarStatement &>(stmt));
+        case StmtKind::block:
+            return std::forward<Visitor>(visitor)(static_cast<BlockStatement &>(stmt));
+        case StmtKind::if_:
+            return std::forward<Visitor>(visitor)(static_cast<IfStatement &>(stmt));
+        case StmtKind::while_:
+            return std::forward<Visitor>(visitor)(static_cast<WhileStatement &>(stmt));
+        case StmtKind::for_:
+            return std::forward<Visitor>(visitor)(static_cast<ForStatement &>(stmt));
+        case StmtKind::return_:
+            return std::forward<Visitor>(visitor)(static_cast<ReturnStatement &>(stmt));
+        case StmtKind::function:
+            return std::forward<Visitor>(visitor)(static_cast<FunctionDeclarationStatement &>(stmt));
+        }
+        std::unreachable();
+    }
+
+    /// Returns @p stmt as a @p T, or nullptr if it is a different kind of node.
+    template <StatementNode T> auto as(Statement *stmt) noexcept -> T * {
+        return stmt != nullptr && stmt->kind == T::node_kind ? static_cast<T *>(stmt) : nullptr;
+    }
+
+    template <StatementNode T> auto as(const Statement *stmt) noexcept -> const T * {
+        return stmt != nullptr && stmt->kind == T::node_kind ? static_cast<const T *>(stmt) : nullptr;
+    }
+
+    inline auto Statement::to_string() const noexcept -> std::string {
+        return visit(*this, [](const auto &node) { return node.to_string(); });
+    }
+
 } // namespace lox::ast
 
 #endif
@@ -0,0 +1,42 @@
+#ifndef LOX_SUPPORT_TRACE_HPP
+#define LOX_SUPPORT_TRACE_HPP
+
+#include <spdlog/spdlog.h>
+
+/**
+ * Trace points for hot paths in the lexer, parser and AST.
+ *
+ * Unlike a plain spdlog::trace call, LOX_TRACE and LOX_DEBUG check the default logger's level before their arguments
+ * are evaluated, so a disabled trace point never formats a token or builds a string. When LOX_ENABLE_TRACING is 0
+ * (the default for NDEBUG builds) the check is discarded at compile time and no code is emitted at all; the format
+ * string is still type-checked against its arguments.
+ *
+ * Define LOX_ENABLE_TRACING=1 to keep trace points in an optimized build.
+ */
+#ifndef LOX_ENABLE_TRACING
+#ifdef NDEBUG
+#define LOX_ENABLE_TRACING 0
+#else
+#define LOX_ENABLE_TRACING 1
+#endif
+#endif
+
+namespace lox::support {
+
+    inline constexpr bool tracing_enabled = LOX_ENABLE_TRACING != 0;
+
+} // namespace lox::support
+
+#define LOX_LOG_POINT(level, ...)                                                                                      \
+    do {                                                                                                               \
+        if constexpr (::lox::support::tracing_enabled) {                                                               \
+            if (::spdlog::default_logger_raw()->should_log(level)) {                                                   \
+                ::spdlog::default_logger_raw()->log(level, __VA_ARGS__);                                               \
+            }                                                                                                          \
+        }                                                                                                              \
+    } while (false)
+
+#define LOX_TRACE(...) LOX_LOG_POINT(::spdlog::level::trace, __VA_ARGS__)
+#define LOX_DEBUG(...) LOX_LOG_POINT(::spdlog::level::debug, __VA_ARGS__)
+
+#endif // LOX_SUPPORT_TRACE_HPP
@@ -1,11 +1,13 @@
 #include "lox/syntax/lex.hpp"
 
+#include "lox/support/trace.hpp"
 #include "lox/syntax/location.hpp"
+#include "lox/syntax/scan_kernels.hpp"
+#include "lox/syntax/source.hpp"
 #include "lox/syntax/token.hpp"
 
 #include <spdlog/spdlog.h>
 
-#include <cctype>
 #include <cstdint>
 #include <expected>
 #include <format>
@@ -14,14 +16,49 @@
 
 namespace lox::syntax {
 
-    Scanner::Scanner(const std::string_view source) noexcept : m_source{source}, m_cursor{.src = source, .pos = 0} {
-        spdlog::debug("Scanner: Initialized with source of length {}", m_source.length());
+    namespace {
+
+        /// Returns the kind of a single-character punctuator, or end_of_file if @p c is not one.
+        constexpr auto punctuation_kind(const char c) noexcept -> TokenKind {
+            switch (c) {
+            case '(':
+                return TokenKind::left_paren;
+            case ')':
+                return TokenKind::right_paren;
+            case '{':
+                return TokenKind::left_brace;
+            case '}':
+                return TokenKind::right_brace;
+            case ';':
+                return TokenKind::semicolon;
+            case ',':
+                return TokenKind::comma;
+            default:
+                return TokenKind::end_of_file;
+            }
+        }
+
+    } // namespace
+
+    Scanner::Scanner(const std::string_view source, const ScanKernels &kernels) noexcept
+        : m_source{source}, m_cursor{.src = source, .pos = 0}, m_kernels{&kernels} {
+        LOX_DEBUG("Scanner: Initialized with source of length {} using {} kernels", m_source.length(), m_kernels->name);
     }
 
-    void Scanner::skip_whitespace() noexcept {
-        while (!is_at_end() && std::isspace(current_char())) {
-            advance();
-        }
+    Scanner::Scanner(const SourceFile &file, const ScanKernels &kernels) noexcept : Scanner(file.text(), kernels) {
+        m_file = file.id();
+    }
+
+    auto Scanner::span_from(const size_t start) const noexcept -> Span {
+        return Span{.start = start, .end = m_cursor.pos, .file = m_file};
+    }
+
+    void Scanner::skip_whitespace() noexcept { advance_run(m_kernels->skip_whitespace); }
+
+    void Scanner::advance_run(const ScanKernels::RunFn kernel) noexcept {
+        const auto *const first = m_source.data();
+        const auto *const last = first + m_source.length();
+        m_cursor.pos = static_cast<size_t>(kernel(first + m_cursor.pos, last) - first);
     }
 
     void Scanner::advance() noexcept {
@@ -50,48 +87,40 @@ namespace lox::syntax {
     auto Scanner::scan_identifier() noexcept -> std::expected<Token, std::string> {
         const auto start = m_cursor.pos;
 
-        while (!is_at_end() && (std::isalnum(current_char()) || current_char() == '_')) {
-            advance();
-        }
+        advance_run(m_kernels->skip_identifier);
 
         const auto lexeme = m_source.substr(start, m_cursor.pos - start);
-        const auto span = Span{.start = start, .end = m_cursor.pos};
+        const auto span = span_from(start);
 
-        if (const auto it = keywords.find(lexeme); it != keywords.end()) {
-            spdlog::trace("Scanner: Scanned keyword '{}' at span [{}, {})", lexeme, span.start, span.end);
-            return Token::make(it->second, lexeme, span);
+        if (const auto kind = keyword_kind(lexeme); kind != TokenKind::identifier) {
+            LOX_TRACE("Scanner: Scanned keyword '{}' at span [{}, {})", lexeme, span.start, span.end);
+            return Token::make(kind, lexeme, span);
         }
 
-        spdlog::trace("Scanner: Scanned identifier '{}' at span [{}, {})", lexeme, span.start, span.end);
+        LOX_TRACE("Scanner: Scanned identifier '{}' at span [{}, {})", lexeme, span.start, span.end);
         return Token::make(TokenKind::identifier, lexeme, span);
     }
 
     auto Scanner::scan_number() noexcept -> std::expected<Token, std::string> {
         const auto start = m_cursor.pos;
 
-        while (!is_at_end() && std::isdigit(current_char())) {
-            advance();
-        }
+        advance_run(m_kernels->skip_digits);
 
-        if (current_char() == '.' && std::isdigit(peek_char(1))) {
+        if (current_char() == '.' && is_digit(peek_char(1))) {
             advance();
-            while (!is_at_end() && std::isdigit(current_char())) {
-                advance();
-            }
+            advance_run(m_kernels->skip_digits);
         }
 
         const auto lexeme = m_source.substr(start, m_cursor.pos - start);
-        const auto span = Span{.start = start, .end = m_cursor.pos};
+        const auto span = span_from(start);
 
-        spdlog::trace("Scanner: Scanned number '{}' at span [{}, {})", lexeme, span.start, span.end);
+        LOX_TRACE("Scanner: Scanned number '{}' at span [{}, {})", lexeme, span.start, span.end);
         return Token::make(TokenKind::number_literal, lexeme, span);
     }
 
     auto Scanner::scan_string() noexcept -> std::expected<Token, std::string> {
         const auto start = m_cursor.pos - 1;
-        while (!is_at_end() && current_char() != '"') {
-            advance();
-        }
+        advance_run(m_kernels->find_string_end);
 
         if (is_at_end()) {
             spdlog::error("Scanner: Unterminated string literal starting at position {}", start);
@@ -103,9 +132,9 @@ namespace lox::syntax {
         const auto lexeme = m_source.substr(content_start, content_length);
 
         advance();
-        const auto span = Span{.start = static_cast<uint8_t>(start), .end = m_cursor.pos};
+        const auto span = span_from(start);
 
-        spdlog::trace("Scanner: Scanned string '{}' at span [{}, {})", lexeme, span.start, span.end);
+        LOX_TRACE("Scanner: Scanned string '{}' at span [{}, {})", lexeme, span.start, span.end);
         return Token::make(TokenKind::string_literal, lexeme, span);
     }
 
@@ -114,58 +143,62 @@ namespace lox::syntax {
         const char first_char = current_char();
         advance();
 
-        auto kind = TokenKind::simple_operator;
-        uint8_t length = 1;
+        auto kind = TokenKind::end_of_file;
 
         switch (first_char) {
         case '=':
-            if (match_char('=')) {
-                kind = TokenKind::compound_operator;
-                length = 2;
-            }
+            kind = match_char('=') ? TokenKind::equal_equal : TokenKind::equal;
             break;
         case '!':
+            kind = match_char('=') ? TokenKind::bang_equal : TokenKind::bang;
+            break;
         case '<':
+            kind = match_char('=') ? TokenKind::less_equal : TokenKind::less;
+            break;
         case '>':
-            if (match_char('=')) {
-                kind = TokenKind::compound_operator;
-                length = 2;
-            }
+            kind = match_char('=') ? TokenKind::greater_equal : TokenKind::greater;
             break;
         case '+':
+            kind = TokenKind::plus;
+            break;
         case '-':
+            kind = TokenKind::minus;
+            break;
         case '*':
+            kind = TokenKind::star;
+            break;
         case '/':
+            kind = TokenKind::slash;
             break;
         default:
             spdlog::error("Scanner: Unknown operator '{}' at position {}", first_char, start);
             return std::unexpected(std::format("Unknown operator '{}' at position {}", first_char, start));
         }
 
-        const auto lexeme = m_source.substr(start, length);
-        const auto span = Span{.start = start, .end = m_cursor.pos};
+        const auto lexeme = m_source.substr(start, m_cursor.pos - start);
+        const auto span = span_from(start);
 
-        const auto kind_str = (kind == TokenKind::compound_operator) ? "compound operator" : "simple operator";
-        spdlog::trace("Scanner: Scanned {} '{}' at span [{}, {})", kind_str, lexeme, span.start, span.end);
+        LOX_TRACE("Scanner: Scanned operator '{}' at span [{}, {})", lexeme, span.start, span.end);
 
         return Token::make(kind, lexeme, span);
     }
 
     auto Scanner::get_next_token() noexcept -> std::expected<Token, std::string> {
         skip_whitespace();
+        m_token_start = m_cursor.pos;
 
         if (is_at_end()) {
-            spdlog::trace("Scanner: Reached end of file, returning EOF token");
-            return Token::make_eof({.start = m_cursor.pos, .end = m_cursor.pos});
+            LOX_TRACE("Scanner: Reached end of file, returning EOF token");
+            return Token::make_eof(span_from(m_cursor.pos));
         }
 
         const char current = current_char();
 
-        if (std::isalpha(current) || current == '_') {
+        if (is_identifier_start(current)) {
             return scan_identifier();
         }
 
-        if (std::isdigit(current)) {
+        if (is_digit(current)) {
             return scan_number();
         }
 
@@ -174,14 +207,14 @@ namespace lox::syntax {
             return scan_string();
         }
 
-        if (current == '(' || current == ')' || current == '{' || current == '}' || current == ';' || current == ',') {
+        if (const auto kind = punctuation_kind(current); kind != TokenKind::end_of_file) {
             const auto start = m_cursor.pos;
             advance();
             const auto lexeme = m_source.substr(start, 1);
-            const auto span = Span{.start = start, .end = m_cursor.pos};
+            const auto span = span_from(start);
 
-            spdlog::trace("Scanner: Scanned punctuation '{}' at span [{}, {})", lexeme, span.start, span.end);
-            return Token::make(TokenKind::punctuation, lexeme, span);
+            LOX_TRACE("Scanner: Scanned punctuation '{}' at span [{}, {})", lexeme, span.start, span.end);
+            return Token::make(kind, lexeme, span);
         }
 
         if (current == '+' || current == '-' || current == '*' || current == '/' || current == '=' || current == '!' ||
@@ -1,6 +1,9 @@
 #ifndef LOX_SYNTAX_LEX_HPP
 #define LOX_SYNTAX_LEX_HPP
 
+#include "lox/syntax/location.hpp"
+#include "lox/syntax/scan_kernels.hpp"
+#include "lox/syntax/source.hpp"
 #include "lox/syntax/token.hpp"
 
 #include <expected>
@@ -16,7 +19,9 @@ namespace lox::syntax {
 
     class Scanner final {
     public:
-        explicit Scanner(std::string_view source) noexcept;
+        explicit Scanner(std::string_view source, const ScanKernels &kernels = best_scan_kernels()) noexcept;
+        /// Scans @p file, tagging every span with its file ID. The file must outlive the scanner and its tokens.
+        explicit Scanner(const SourceFile &file, const ScanKernels &kernels = best_scan_kernels()) noexcept;
 
         Scanner(const Scanner &) = delete;
         Scanner(Scanner &&) = delete;
@@ -27,6 +32,9 @@ namespace lox::syntax {
 
         auto get_next_token() noexcept -> std::expected<Token, std::string>;
 
+        /// The span of the last token scanned, or of the text scanned so far if get_next_token failed.
+        [[nodiscard]] auto last_span() const noexcept -> Span { return span_from(m_token_start); }
+
     private:
         [[nodiscard]] auto is_at_end() const noexcept -> bool;
         [[nodiscard]] auto current_char() const noexcept -> char;
@@ -36,6 +44,12 @@ namespace lox::syntax {
         void skip_whitespace() noexcept;
         void advance() noexcept;
 
+        /// Moves the cursor to the end of the run found by @p kernel starting at the cursor.
+        void advance_run(ScanKernels::RunFn kernel) noexcept;
+
+        /// The span from @p start to the cursor in the file being scanned.
+        [[nodiscard]] auto span_from(size_t start) const noexcept -> Span;
+
         auto scan_identifier() noexcept -> std::expected<Token, std::string>;
         auto scan_number() noexcept -> std::expected<Token, std::string>;
         auto scan_string() noexcept -> std::expected<Token, std::string>;
@@ -43,6 +57,9 @@ namespace lox::syntax {
 
         std::string_view m_source;
         Cursor m_cursor;
+        size_t m_token_start{0};
+        const ScanKernels *m_kernels;
+        FileId m_file{FileId::none};
     };
 
 } // namespace lox::syntax
@@ -0,0 +1,33 @@
+#include "lox/syntax/line_index.hpp"
+
+#include "lox/syntax/location.hpp"
+#include "lox/syntax/scan_kernels.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <string_view>
+
+namespace lox::syntax {
+
+    LineIndex::LineIndex(const std::string_view text, const ScanKernels &kernels) {
+        // Assume lines of about 32 bytes so that typical scripts never regrow the vector.
+        m_line_starts.reserve(text.size() / 32 + 1);
+        m_line_starts.push_back(0);
+
+        const auto *const first = text.data();
+        const auto *const last = first + text.size();
+        for (const auto *newline = kernels.find_newline(first, last); newline != last;
+             newline = kernels.find_newline(newline + 1, last)) {
+            m_line_starts.push_back(static_cast<std::size_t>(newline + 1 - first));
+        }
+    }
+
+    auto LineIndex::locate(const std::size_t offset) const noexcept -> Location {
+        // The line is the last one starting at or before the offset; line 1 starts at 0, so there always is one.
+        const auto next_line = std::ranges::upper_bound(m_line_starts, offset);
+        const auto line = static_cast<std::size_t>(std::distance(m_line_starts.begin(), next_line));
+        return Location{.file_name = {}, .line = line, .column = offset - m_line_starts[line - 1] + 1};
+    }
+
+} // namespace lox::syntax
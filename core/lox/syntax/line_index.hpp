@@ -0,0 +1,40 @@
+#ifndef LOX_SYNTAX_LINE_INDEX_HPP
+#define LOX_SYNTAX_LINE_INDEX_HPP
+
+#include "lox/syntax/location.hpp"
+#include "lox/syntax/scan_kernels.hpp"
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace lox::syntax {
+
+    /**
+     * @brief The byte offset at which every line of a source text starts.
+     *
+     * Spans and chunks record byte offsets only; this index turns an offset into a line and column when a diagnostic
+     * or the disassembler asks for one. It is built in a single pass with the find_newline scan kernel.
+     */
+    class LineIndex final {
+    public:
+        explicit LineIndex(std::string_view text, const ScanKernels &kernels = best_scan_kernels());
+
+        /// The number of lines; text without a trailing newline still counts its last line.
+        [[nodiscard]] auto line_count() const noexcept -> std::size_t { return m_line_starts.size(); }
+
+        /// The offset of the first byte of 1-based @p line.
+        [[nodiscard]] auto line_start(std::size_t line) const noexcept -> std::size_t {
+            return m_line_starts[line - 1];
+        }
+
+        /// The 1-based line and column of byte @p offset. Offsets past the end map onto the last line.
+        [[nodiscard]] auto locate(std::size_t offset) const noexcept -> Location;
+
+    private:
+        std::vector<std::size_t> m_line_starts;
+    };
+
+} // namespace lox::syntax
+
+#endif // LOX_SYNTAX_LINE_INDEX_HPP
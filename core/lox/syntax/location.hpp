@@ -1,26 +1,39 @@
 #ifndef LOX_SYNTAX_LOCATION_HPP
 #define LOX_SYNTAX_LOCATION_HPP
 
-#include <optional>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <string>
 #include <string_view>
 
 namespace lox::syntax {
 
+    /// Identifies a file registered with a SourceManager. FileId::none marks text that did not come from one.
+    enum class FileId : std::uint32_t { none = 0 };
+
     struct Span {
         size_t start, end;
+        FileId file{FileId::none};
 
         [[nodiscard]] constexpr auto length() const noexcept -> size_t { return end - start; }
     };
 
+    /**
+     * @brief A human-readable position, computed on demand from a Span through a LineIndex.
+     *
+     * Lines and columns are 1-based; columns count bytes.
+     */
     struct Location {
-        Location(const Location &) = default;
-        Location(Location &&) = default;
-        auto operator=(const Location &) -> Location & = default;
-        auto operator=(Location &&) -> Location & = default;
-        ~Location() = default;
-
-        std::optional<std::string_view> source_file_name;
-        int column{}, line{};
+        std::string_view file_name;
+        size_t line{}, column{};
+
+        [[nodiscard]] auto to_string() const -> std::string {
+            if (file_name.empty()) {
+                return std::format("{}:{}", line, column);
+            }
+            return std::format("{}:{}:{}", file_name, line, column);
+        }
     };
 
 } // namespace lox::syntax
@@ -0,0 +1,219 @@
+#include "lox/syntax/scan_kernels.hpp"
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define LOX_SCAN_KERNELS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define LOX_TARGET_AVX2
+#else
+#define LOX_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define LOX_SCAN_KERNELS_X86 0
+#endif
+
+namespace lox::syntax {
+
+    namespace {
+
+        template <std::uint8_t Class>
+        auto scalar_skip_class(const char *first, const char *const last) noexcept -> const char * {
+            while (first != last && has_char_class(*first, Class)) {
+                ++first;
+            }
+            return first;
+        }
+
+        template <char Byte> auto scalar_find_byte(const char *first, const char *const last) noexcept -> const char * {
+            while (first != last && *first != Byte) {
+                ++first;
+            }
+            return first;
+        }
+
+        constexpr ScanKernels scalar_kernels{
+            .name = "scalar",
+            .skip_whitespace = scalar_skip_class<char_class_whitespace>,
+            .skip_identifier = scalar_skip_class<char_class_identifier>,
+            .skip_digits = scalar_skip_class<char_class_digit>,
+            .find_string_end = scalar_find_byte<'"'>,
+            .find_newline = scalar_find_byte<'\n'>,
+        };
+
+#if LOX_SCAN_KERNELS_X86
+
+        // Each classifier sets a lane to all-ones when its byte belongs to the class. Comparisons are signed, so
+        // bytes >= 0x80 never fall inside an ASCII range.
+
+        struct Sse2Whitespace {
+            static auto classify(const __m128i c) noexcept -> __m128i {
+                const auto space = _mm_cmpeq_epi8(c, _mm_set1_epi8(' '));
+                const auto control = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('\t' - 1)),
+                                                   _mm_cmplt_epi8(c, _mm_set1_epi8('\r' + 1)));
+                return _mm_or_si128(space, control);
+            }
+        };
+
+        struct Sse2Digit {
+            static auto classify(const __m128i c) noexcept -> __m128i {
+                return _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)),
+                                     _mm_cmplt_epi8(c, _mm_set1_epi8('9' + 1)));
+            }
+        };
+
+        struct Sse2Identifier {
+            static auto classify(const __m128i c) noexcept -> __m128i {
+                const auto lower = _mm_or_si128(c, _mm_set1_epi8(0x20));
+                const auto alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                                 _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+                const auto underscore = _mm_cmpeq_epi8(c, _mm_set1_epi8('_'));
+                return _mm_or_si128(_mm_or_si128(alpha, Sse2Digit::classify(c)), underscore);
+            }
+        };
+
+        template <char Byte> struct Sse2Byte {
+            static auto classify(const __m128i c) noexcept -> __m128i { return _mm_cmpeq_epi8(c, _mm_set1_epi8(Byte)); }
+        };
+
+        /**
+         * Advances 16 bytes at a time while every byte is inside (or, with StopOnMatch, outside) the class, then
+         * locates the exact stopping byte from the movemask. The final partial block is handled by @p Scalar.
+         */
+        template <typename Classifier, bool StopOnMatch, auto Scalar>
+        auto sse2_run(const char *first, const char *const last) noexcept -> const char * {
+            constexpr std::uint32_t lanes = 0xFFFFU;
+            while (last - first >= 16) {
+                const auto block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(first));
+                const auto matches = static_cast<std::uint32_t>(_mm_movemask_epi8(Classifier::classify(block)));
+                if (const auto stops = StopOnMatch ? matches : ~matches & lanes; stops != 0) {
+                    return first + std::countr_zero(stops);
+                }
+                first += 16;
+            }
+            return Scalar(first, last);
+        }
+
+        struct Avx2Whitespace {
+            LOX_TARGET_AVX2 static auto classify(const __m256i c) noexcept -> __m256i {
+                const auto space = _mm256_cmpeq_epi8(c, _mm256_set1_epi8(' '));
+                const auto control = _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('\t' - 1)),
+                                                      _mm256_cmpgt_epi8(_mm256_set1_epi8('\r' + 1), c));
+                return _mm256_or_si256(space, control);
+            }
+        };
+
+        struct Avx2Digit {
+            LOX_TARGET_AVX2 static auto classify(const __m256i c) noexcept -> __m256i {
+                return _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('0' - 1)),
+                                        _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), c));
+            }
+        };
+
+        struct Avx2Identifier {
+            LOX_TARGET_AVX2 static auto classify(const __m256i c) noexcept -> __m256i {
+                const auto lower = _mm256_or_si256(c, _mm256_set1_epi8(0x20));
+                const auto alpha = _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)),
+                                                    _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), lower));
+                const auto underscore = _mm256_cmpeq_epi8(c, _mm256_set1_epi8('_'));
+                return _mm256_or_si256(_mm256_or_si256(alpha, Avx2Digit::classify(c)), underscore);
+            }
+        };
+
+        template <char Byte> struct Avx2Byte {
+            LOX_TARGET_AVX2 static auto classify(const __m256i c) noexcept -> __m256i {
+                return _mm256_cmpeq_epi8(c, _mm256_set1_epi8(Byte));
+            }
+        };
+
+        /// The 32-byte counterpart of sse2_run; the tail is finished by the SSE2 kernel.
+        template <typename Classifier, bool StopOnMatch, auto Tail>
+        LOX_TARGET_AVX2 auto avx2_run(const char *first, const char *const last) noexcept -> const char * {
+            while (last - first >= 32) {
+                const auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(first));
+                const auto matches = static_cast<std::uint32_t>(_mm256_movemask_epi8(Classifier::classify(block)));
+                if (const auto stops = StopOnMatch ? matches : ~matches; stops != 0) {
+                    return first + std::countr_zero(stops);
+                }
+                first += 32;
+            }
+            return Tail(first, last);
+        }
+
+        /// Most runs between tokens are a single byte, so check the first byte before paying for a vector load.
+        template <std::uint8_t Class, auto Vector>
+        auto skip_class(const char *first, const char *const last) noexcept -> const char * {
+            if (first == last || !has_char_class(*first, Class)) {
+                return first;
+            }
+            return Vector(first + 1, last);
+        }
+
+        constexpr auto sse2_skip_whitespace = sse2_run<Sse2Whitespace, false, scalar_skip_class<char_class_whitespace>>;
+        constexpr auto sse2_skip_identifier = sse2_run<Sse2Identifier, false, scalar_skip_class<char_class_identifier>>;
+        constexpr auto sse2_skip_digits = sse2_run<Sse2Digit, false, scalar_skip_class<char_class_digit>>;
+        constexpr auto sse2_find_string_end = sse2_run<Sse2Byte<'"'>, true, scalar_find_byte<'"'>>;
+        constexpr auto sse2_find_newline = sse2_run<Sse2Byte<'\n'>, true, scalar_find_byte<'\n'>>;
+
+        constexpr ScanKernels sse2_kernels{
+            .name = "sse2",
+            .skip_whitespace = skip_class<char_class_whitespace, sse2_skip_whitespace>,
+            .skip_identifier = skip_class<char_class_identifier, sse2_skip_identifier>,
+            .skip_digits = skip_class<char_class_digit, sse2_skip_digits>,
+            .find_string_end = sse2_find_string_end,
+            .find_newline = sse2_find_newline,
+        };
+
+        constexpr ScanKernels avx2_kernels{
+            .name = "avx2",
+            .skip_whitespace =
+                skip_class<char_class_whitespace, avx2_run<Avx2Whitespace, false, sse2_skip_whitespace>>,
+            .skip_identifier =
+                skip_class<char_class_identifier, avx2_run<Avx2Identifier, false, sse2_skip_identifier>>,
+            .skip_digits = skip_class<char_class_digit, avx2_run<Avx2Digit, false, sse2_skip_digits>>,
+            .find_string_end = avx2_run<Avx2Byte<'"'>, true, sse2_find_string_end>,
+            .find_newline = avx2_run<Avx2Byte<'\n'>, true, sse2_find_newline>,
+        };
+
+        auto cpu_supports_avx2() noexcept -> bool {
+#if defined(_MSC_VER) && !defined(__clang__)
+            std::array<int, 4> info{};
+            __cpuid(info.data(), 1);
+            const bool os_saves_ymm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6U) == 0x6U;
+            __cpuidex(info.data(), 7, 0);
+            return os_saves_ymm && (info[1] & (1 << 5)) != 0;
+#else
+            return __builtin_cpu_supports("avx2") != 0;
+#endif
+        }
+
+#endif // LOX_SCAN_KERNELS_X86
+
+    } // namespace
+
+    auto scalar_scan_kernels() noexcept -> const ScanKernels & { return scalar_kernels; }
+
+    auto supported_scan_kernels() noexcept -> std::span<const ScanKernels *const> {
+#if LOX_SCAN_KERNELS_X86
+        // Every x86-64 CPU has SSE2; AVX2 needs checking.
+        static constexpr std::array<const ScanKernels *, 3> kernels{&scalar_kernels, &sse2_kernels, &avx2_kernels};
+        static const std::size_t count = cpu_supports_avx2() ? 3 : 2;
+        return std::span{kernels}.first(count);
+#else
+        static constexpr std::array<const ScanKernels *, 1> kernels{&scalar_kernels};
+        return kernels;
+#endif
+    }
+
+    auto best_scan_kernels() noexcept -> const ScanKernels & {
+        static const ScanKernels &selected = *supported_scan_kernels().back();
+        return selected;
+    }
+
+} // namespace lox::syntax
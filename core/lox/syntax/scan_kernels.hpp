@@ -0,0 +1,83 @@
+#ifndef LOX_SYNTAX_SCAN_KERNELS_HPP
+#define LOX_SYNTAX_SCAN_KERNELS_HPP
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+namespace lox::syntax {
+
+    /**
+     * @brief Locale-independent ASCII character classes used by the scanner.
+     *
+     * Bytes outside the ASCII range belong to no class, which matches what the C locale reports for them.
+     */
+    enum CharClass : std::uint8_t {
+        char_class_whitespace = 1U << 0U,
+        char_class_digit = 1U << 1U,
+        char_class_identifier_start = 1U << 2U,
+        char_class_identifier = 1U << 3U,
+    };
+
+    inline constexpr std::array<std::uint8_t, 256> char_classes = [] {
+        std::array<std::uint8_t, 256> table{};
+        for (const unsigned char c : {' ', '\t', '\n', '\v', '\f', '\r'}) {
+            table[c] |= char_class_whitespace;
+        }
+        for (unsigned char c = '0'; c <= '9'; ++c) {
+            table[c] |= char_class_digit | char_class_identifier;
+        }
+        for (unsigned char c = 'a'; c <= 'z'; ++c) {
+            table[c] |= char_class_identifier_start | char_class_identifier;
+            table[c - 'a' + 'A'] |= char_class_identifier_start | char_class_identifier;
+        }
+        table['_'] |= char_class_identifier_start | char_class_identifier;
+        return table;
+    }();
+
+    [[nodiscard]] constexpr auto has_char_class(const char c, const std::uint8_t cls) noexcept -> bool {
+        return (char_classes[static_cast<unsigned char>(c)] & cls) != 0;
+    }
+
+    [[nodiscard]] constexpr auto is_whitespace(const char c) noexcept -> bool {
+        return has_char_class(c, char_class_whitespace);
+    }
+    [[nodiscard]] constexpr auto is_digit(const char c) noexcept -> bool { return has_char_class(c, char_class_digit); }
+    [[nodiscard]] constexpr auto is_identifier_start(const char c) noexcept -> bool {
+        return has_char_class(c, char_class_identifier_start);
+    }
+    [[nodiscard]] constexpr auto is_identifier(const char c) noexcept -> bool {
+        return has_char_class(c, char_class_identifier);
+    }
+
+    /**
+     * @brief A set of run-finding kernels used by the scanner.
+     *
+     * Every kernel takes the half-open byte range [first, last) and returns a pointer to the first byte that ends the
+     * run, or @p last if the run extends to the end of the input.
+     */
+    struct ScanKernels {
+        using RunFn = auto (*)(const char *first, const char *last) noexcept -> const char *;
+
+        std::string_view name;
+        RunFn skip_whitespace;
+        RunFn skip_identifier;
+        RunFn skip_digits;
+        RunFn find_string_end;
+        /// Stops at the next '\n'; used to build line indexes, not by the scanner.
+        RunFn find_newline;
+    };
+
+    /// Portable byte-at-a-time kernels.
+    [[nodiscard]] auto scalar_scan_kernels() noexcept -> const ScanKernels &;
+
+    /// Every kernel set the running CPU supports, from scalar up to the widest, detected once on first use.
+    [[nodiscard]] auto supported_scan_kernels() noexcept -> std::span<const ScanKernels *const>;
+
+    /// The widest kernels supported by the running CPU (AVX2, then SSE2, then scalar).
+    [[nodiscard]] auto best_scan_kernels() noexcept -> const ScanKernels &;
+
+} // namespace lox::syntax
+
+#endif // LOX_SYNTAX_SCAN_KERNELS_HPP
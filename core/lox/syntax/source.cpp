@@ -0,0 +1,187 @@
+#include "lox/syntax/source.hpp"
+
+#include "lox/syntax/line_index.hpp"
+#include "lox/syntax/location.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <expected>
+#include <format>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define LOX_SOURCE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define LOX_SOURCE_MMAP 0
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#endif
+
+namespace lox::syntax {
+
+    namespace {
+
+#if LOX_SOURCE_MMAP
+        /// Closes a file descriptor when it goes out of scope.
+        struct FileDescriptor {
+            int fd;
+
+            explicit FileDescriptor(const int descriptor) noexcept : fd{descriptor} {}
+
+            FileDescriptor(const FileDescriptor &) = delete;
+            auto operator=(const FileDescriptor &) -> FileDescriptor & = delete;
+
+            ~FileDescriptor() {
+                if (fd >= 0 && fd != STDIN_FILENO) {
+                    ::close(fd);
+                }
+            }
+        };
+
+        auto read_all(const int fd, std::string &buffer) noexcept -> std::expected<void, std::string> {
+            constexpr std::size_t chunk_size = 64 * 1024;
+            while (true) {
+                const auto used = buffer.size();
+                buffer.resize(used + chunk_size);
+                const auto count = ::read(fd, buffer.data() + used, chunk_size);
+                if (count < 0) {
+                    if (errno == EINTR) {
+                        buffer.resize(used);
+                        continue;
+                    }
+                    return std::unexpected(std::string{std::strerror(errno)});
+                }
+                buffer.resize(used + static_cast<std::size_t>(count));
+                if (count == 0) {
+                    return {};
+                }
+            }
+        }
+#endif
+
+    } // namespace
+
+    SourceFile::SourceFile(const FileId id, std::string name) noexcept : m_id{id}, m_name{std::move(name)} {}
+
+    SourceFile::SourceFile(const FileId id, std::string name, std::string contents) noexcept
+        : m_id{id}, m_name{std::move(name)}, m_buffer{std::move(contents)} {
+        m_text = m_buffer;
+    }
+
+    SourceFile::~SourceFile() {
+#if LOX_SOURCE_MMAP
+        if (m_mapping != nullptr) {
+            ::munmap(m_mapping, m_mapping_size);
+        }
+#endif
+    }
+
+    auto SourceFile::open(const FileId id, std::string path) noexcept
+        -> std::expected<std::unique_ptr<SourceFile>, std::string> {
+        auto file = std::unique_ptr<SourceFile>(new SourceFile(id, path));
+
+#if LOX_SOURCE_MMAP
+        const bool is_stdin = path == "-";
+        const FileDescriptor descriptor{is_stdin ? STDIN_FILENO : ::open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+        if (descriptor.fd < 0) {
+            return std::unexpected(std::format("Failed to open file {}: {}", path, std::strerror(errno)));
+        }
+
+        struct stat info{};
+        if (::fstat(descriptor.fd, &info) != 0) {
+            return std::unexpected(std::format("Failed to stat file {}: {}", path, std::strerror(errno)));
+        }
+
+        // Empty files cannot be mapped, and an empty buffer is just as cheap.
+        if (S_ISREG(info.st_mode) && info.st_size > 0) {
+            const auto size = static_cast<std::size_t>(info.st_size);
+            void *const mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor.fd, 0);
+            if (mapping != MAP_FAILED) {
+                ::madvise(mapping, size, MADV_SEQUENTIAL);
+                file->m_mapping = mapping;
+                file->m_mapping_size = size;
+                file->m_text = std::string_view{static_cast<const char *>(mapping), size};
+                spdlog::debug("SourceFile: Mapped {} ({} bytes)", path, size);
+                return file;
+            }
+            spdlog::warn("SourceFile: mmap of {} failed ({}), reading it instead", path, std::strerror(errno));
+            file->m_buffer.reserve(size);
+        }
+
+        if (auto read = read_all(descriptor.fd, file->m_buffer); !read) {
+            return std::unexpected(std::format("Failed to read file {}: {}", path, read.error()));
+        }
+#else
+        if (path == "-") {
+            std::ostringstream contents;
+            contents << std::cin.rdbuf();
+            file->m_buffer = std::move(contents).str();
+        } else {
+            std::ifstream stream{path, std::ios::binary | std::ios::ate};
+            if (!stream.is_open()) {
+                return std::unexpected(std::format("Failed to open file {}", path));
+            }
+            file->m_buffer.resize(static_cast<std::size_t>(stream.tellg()));
+            stream.seekg(0);
+            stream.read(file->m_buffer.data(), static_cast<std::streamsize>(file->m_buffer.size()));
+            if (!stream) {
+                return std::unexpected(std::format("Failed to read file {}", path));
+            }
+        }
+#endif
+
+        file->m_text = file->m_buffer;
+        spdlog::debug("SourceFile: Read {} ({} bytes)", path, file->m_buffer.size());
+        return file;
+    }
+
+    auto SourceFile::lines() const -> const LineIndex & {
+        if (!m_lines) {
+            m_lines.emplace(m_text);
+            spdlog::debug("SourceFile: Indexed {} lines of {}", m_lines->line_count(), m_name);
+        }
+        return *m_lines;
+    }
+
+    auto SourceFile::locate(const std::size_t offset) const -> Location {
+        auto location = lines().locate(offset);
+        location.file_name = m_name;
+        return location;
+    }
+
+    auto SourceManager::load(std::string path) noexcept -> std::expected<const SourceFile *, std::string> {
+        auto file = SourceFile::open(next_id(), std::move(path));
+        if (!file) {
+            return std::unexpected(std::move(file.error()));
+        }
+        return m_files.emplace_back(std::move(file.value())).get();
+    }
+
+    auto SourceManager::add(std::string name, std::string contents) -> const SourceFile & {
+        return *m_files.emplace_back(std::make_unique<SourceFile>(next_id(), std::move(name), std::move(contents)));
+    }
+
+    auto SourceManager::get(const FileId id) const noexcept -> const SourceFile * {
+        const auto index = static_cast<std::uint32_t>(id);
+        if (index == 0 || index > m_files.size()) {
+            return nullptr;
+        }
+        return m_files[index - 1].get();
+    }
+
+    auto SourceManager::next_id() const noexcept -> FileId { return static_cast<FileId>(m_files.size() + 1); }
+
+} // namespace lox::syntax
@@ -0,0 +1,105 @@
+#ifndef LOX_SYNTAX_SOURCE_HPP
+#define LOX_SYNTAX_SOURCE_HPP
+
+#include "lox/syntax/line_index.hpp"
+#include "lox/syntax/location.hpp"
+
+#include <cstddef>
+#include <expected>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace lox::syntax {
+
+    /**
+     * @brief The text of one script, either mapped read-only from disk or held in an owned buffer.
+     *
+     * Tokens, AST nodes and compiled code borrow string views into text(), so a SourceFile must outlive everything
+     * produced from it. It is neither copyable nor movable, which keeps those views valid while it lives.
+     */
+    class SourceFile final {
+    public:
+        /// Wraps text that is already in memory, such as a REPL line or a test snippet.
+        SourceFile(FileId id, std::string name, std::string contents) noexcept;
+
+        SourceFile(const SourceFile &) = delete;
+        SourceFile(SourceFile &&) = delete;
+        auto operator=(const SourceFile &) -> SourceFile & = delete;
+        auto operator=(SourceFile &&) -> SourceFile & = delete;
+
+        ~SourceFile();
+
+        /**
+         * @brief Loads @p path, mapping it into memory when it is a regular file.
+         *
+         * Pipes, character devices and platforms without mmap fall back to reading the whole stream into a buffer.
+         * The path "-" reads standard input.
+         */
+        [[nodiscard]] static auto open(FileId id, std::string path) noexcept
+            -> std::expected<std::unique_ptr<SourceFile>, std::string>;
+
+        [[nodiscard]] auto id() const noexcept -> FileId { return m_id; }
+        [[nodiscard]] auto name() const noexcept -> std::string_view { return m_name; }
+        [[nodiscard]] auto text() const noexcept -> std::string_view { return m_text; }
+        [[nodiscard]] auto is_mapped() const noexcept -> bool { return m_mapping != nullptr; }
+
+        /// The line index of text(), built on first use.
+        [[nodiscard]] auto lines() const -> const LineIndex &;
+
+        /// The file, line and column of byte @p offset.
+        [[nodiscard]] auto locate(std::size_t offset) const -> Location;
+
+    private:
+        SourceFile(FileId id, std::string name) noexcept;
+
+        FileId m_id;
+        std::string m_name;
+        std::string_view m_text;
+
+        // Exactly one of these backs m_text.
+        void *m_mapping = nullptr;
+        std::size_t m_mapping_size = 0;
+        std::string m_buffer;
+
+        mutable std::optional<LineIndex> m_lines;
+    };
+
+    /**
+     * @brief Owns every script loaded during a run and hands out the FileId stored in each Span.
+     *
+     * Files are never unloaded, so views into them stay valid for as long as the manager lives.
+     */
+    class SourceManager final {
+    public:
+        SourceManager() = default;
+
+        SourceManager(const SourceManager &) = delete;
+        SourceManager(SourceManager &&) = default;
+        auto operator=(const SourceManager &) -> SourceManager & = delete;
+        auto operator=(SourceManager &&) -> SourceManager & = default;
+
+        ~SourceManager() = default;
+
+        /// Loads the script at @p path; see SourceFile::open.
+        [[nodiscard]] auto load(std::string path) noexcept -> std::expected<const SourceFile *, std::string>;
+
+        /// Registers in-memory text under @p name.
+        auto add(std::string name, std::string contents) -> const SourceFile &;
+
+        /// Returns the file registered as @p id, or nullptr for FileId::none and unknown IDs.
+        [[nodiscard]] auto get(FileId id) const noexcept -> const SourceFile *;
+
+        [[nodiscard]] auto size() const noexcept -> std::size_t { return m_files.size(); }
+
+    private:
+        [[nodiscard]] auto next_id() const noexcept -> FileId;
+
+        std::vector<std::unique_ptr<SourceFile>> m_files;
+    };
+
+} // namespace lox::syntax
+
+#endif // LOX_SYNTAX_SOURCE_HPP
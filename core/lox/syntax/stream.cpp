@@ -0,0 +1,52 @@
+#include "lox/syntax/stream.hpp"
+
+#include "lox/support/trace.hpp"
+#include "lox/syntax/source.hpp"
+#include "lox/syntax/token.hpp"
+
+#include <string_view>
+#include <utility>
+
+namespace lox::syntax {
+
+    TokenStream::TokenStream(const std::string_view source) noexcept : m_scanner{source} {
+        m_window[m_head & window_mask] = pull();
+        m_window[(m_head + 1) & window_mask] = pull();
+    }
+
+    TokenStream::TokenStream(const SourceFile &file) noexcept : m_scanner{file} {
+        m_window[m_head & window_mask] = pull();
+        m_window[(m_head + 1) & window_mask] = pull();
+    }
+
+    auto TokenStream::advance() noexcept -> void {
+        ++m_head;
+        m_window[(m_head + 1) & window_mask] = pull();
+    }
+
+    auto TokenStream::pull() noexcept -> Token {
+        // Once the end has been reached (or lexing failed) keep handing out the same EOF token.
+        if (m_exhausted) {
+            return m_end_of_file;
+        }
+
+        auto token = m_scanner.get_next_token();
+        if (!token.has_value()) {
+            LOX_DEBUG("TokenStream: Lex error, ending stream: {}", token.error());
+            const auto &last = m_window[m_head & window_mask].span;
+            m_error = std::move(token.error());
+            m_error_span = m_scanner.last_span();
+            m_exhausted = true;
+            m_end_of_file = Token::make_eof({.start = last.end, .end = last.end, .file = last.file});
+            return m_end_of_file;
+        }
+
+        if (token->kind == TokenKind::end_of_file) {
+            m_exhausted = true;
+            m_end_of_file = token.value();
+        }
+
+        return token.value();
+    }
+
+} // namespace lox::syntax
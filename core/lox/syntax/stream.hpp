@@ -0,0 +1,66 @@
+#ifndef LOX_SYNTAX_STREAM_HPP
+#define LOX_SYNTAX_STREAM_HPP
+
+#include "lox/syntax/lex.hpp"
+#include "lox/syntax/location.hpp"
+#include "lox/syntax/source.hpp"
+#include "lox/syntax/token.hpp"
+
+#include <array>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace lox::syntax {
+
+    /**
+     * @brief A pull-based token source with a fixed lookahead window.
+     *
+     * Tokens are lexed on demand as the stream advances, so only the previous, current and next token are ever
+     * materialised regardless of the size of the input. The first lex error is recorded and the stream then
+     * behaves as if it had reached the end of the input at the offending position.
+     */
+    class TokenStream final {
+    public:
+        explicit TokenStream(std::string_view source) noexcept;
+        explicit TokenStream(const SourceFile &file) noexcept;
+
+        TokenStream(const TokenStream &) = delete;
+        TokenStream(TokenStream &&) = delete;
+        auto operator=(const TokenStream &) -> TokenStream & = delete;
+        auto operator=(TokenStream &&) -> TokenStream & = delete;
+
+        ~TokenStream() = default;
+
+        [[nodiscard]] auto previous() const noexcept -> const Token & { return m_window[(m_head - 1) & window_mask]; }
+        [[nodiscard]] auto current() const noexcept -> const Token & { return m_window[m_head & window_mask]; }
+        [[nodiscard]] auto peek() const noexcept -> const Token & { return m_window[(m_head + 1) & window_mask]; }
+
+        auto advance() noexcept -> void;
+
+        /// The first lex error encountered, if any.
+        [[nodiscard]] auto error() const noexcept -> const std::optional<std::string> & { return m_error; }
+
+        /// Where the first lex error occurred; only meaningful once error() holds a value.
+        [[nodiscard]] auto error_span() const noexcept -> const Span & { return m_error_span; }
+
+    private:
+        static constexpr size_t window_size = 4;
+        static constexpr size_t window_mask = window_size - 1;
+        static_assert((window_size & window_mask) == 0, "window size must be a power of two");
+
+        auto pull() noexcept -> Token;
+
+        Scanner m_scanner;
+        std::array<Token, window_size> m_window{};
+        size_t m_head{0};
+        bool m_exhausted{false};
+        Token m_end_of_file{};
+        std::optional<std::string> m_error;
+        Span m_error_span{};
+    };
+
+} // namespace lox::syntax
+
+#endif // LOX_SYNTAX_STREAM_HPP
@@ -9,7 +9,7 @@
 namespace lox::syntax {
 
     auto Token::make(const TokenKind k, const std::string_view l, const Span s) noexcept -> Token {
-        return Token{.kind = k, .lexeme = std::string(l), .span = s};
+        return Token{.kind = k, .lexeme = l, .span = s};
     }
 
     auto Token::make_eof(const Span s) noexcept -> Token {
@@ -3,10 +3,11 @@
 
 #include "lox/syntax/location.hpp"
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include <string_view>
-#include <unordered_map>
+#include <type_traits>
 #include <utility>
 
 namespace lox::syntax {
@@ -16,22 +17,123 @@ namespace lox::syntax {
         number_literal,
         identifier,
 
-        punctuation,
-        simple_operator,
-        compound_operator,
-        keyword,
+        // Punctuation.
+        left_paren,
+        right_paren,
+        left_brace,
+        right_brace,
+        comma,
+        semicolon,
+
+        // Operators.
+        plus,
+        minus,
+        star,
+        slash,
+        bang,
+        bang_equal,
+        equal,
+        equal_equal,
+        less,
+        less_equal,
+        greater,
+        greater_equal,
+
+        // Keywords.
+        keyword_and,
+        keyword_class,
+        keyword_else,
+        keyword_false,
+        keyword_for,
+        keyword_fun,
+        keyword_if,
+        keyword_nil,
+        keyword_or,
+        keyword_print,
+        keyword_return,
+        keyword_super,
+        keyword_this,
+        keyword_true,
+        keyword_var,
+        keyword_while,
 
         end_of_file,
     };
 
-    inline const std::unordered_map<std::string_view, TokenKind> keywords{
-        {"and", TokenKind::keyword},   {"class", TokenKind::keyword},  {"else", TokenKind::keyword},
-        {"false", TokenKind::keyword}, {"for", TokenKind::keyword},    {"fun", TokenKind::keyword},
-        {"if", TokenKind::keyword},    {"nil", TokenKind::keyword},    {"or", TokenKind::keyword},
-        {"print", TokenKind::keyword}, {"return", TokenKind::keyword}, {"super", TokenKind::keyword},
-        {"this", TokenKind::keyword},  {"true", TokenKind::keyword},   {"var", TokenKind::keyword},
-        {"while", TokenKind::keyword},
-    };
+    inline constexpr size_t token_kind_count = static_cast<size_t>(TokenKind::end_of_file) + 1;
+
+    [[nodiscard]] constexpr auto is_keyword(const TokenKind kind) noexcept -> bool {
+        return kind >= TokenKind::keyword_and && kind <= TokenKind::keyword_while;
+    }
+
+    /**
+     * @brief Classifies an identifier-shaped lexeme as a keyword or a plain identifier.
+     *
+     * Dispatches on the first character and then compares against the only candidates for that character, so
+     * recognising a keyword costs at most two short comparisons and never hashes.
+     */
+    [[nodiscard]] constexpr auto keyword_kind(const std::string_view text) noexcept -> TokenKind {
+        const auto keyword_if_equal = [text](const std::string_view keyword, const TokenKind kind) noexcept {
+            return text == keyword ? kind : TokenKind::identifier;
+        };
+
+        if (text.length() < 2 || text.length() > 6) {
+            return TokenKind::identifier;
+        }
+
+        switch (text[0]) {
+        case 'a':
+            return keyword_if_equal("and", TokenKind::keyword_and);
+        case 'c':
+            return keyword_if_equal("class", TokenKind::keyword_class);
+        case 'e':
+            return keyword_if_equal("else", TokenKind::keyword_else);
+        case 'f':
+            switch (text[1]) {
+            case 'a':
+                return keyword_if_equal("false", TokenKind::keyword_false);
+            case 'o':
+                return keyword_if_equal("for", TokenKind::keyword_for);
+            case 'u':
+                return keyword_if_equal("fun", TokenKind::keyword_fun);
+            default:
+                return TokenKind::identifier;
+            }
+        case 'i':
+            return keyword_if_equal("if", TokenKind::keyword_if);
+        case 'n':
+            return keyword_if_equal("nil", TokenKind::keyword_nil);
+        case 'o':
+            return keyword_if_equal("or", TokenKind::keyword_or);
+        case 'p':
+            return keyword_if_equal("print", TokenKind::keyword_print);
+        case 'r':
+            return keyword_if_equal("return", TokenKind::keyword_return);
+        case 's':
+            return keyword_if_equal("super", TokenKind::keyword_super);
+        case 't':
+            switch (text[1]) {
+            case 'h':
+                return keyword_if_equal("this", TokenKind::keyword_this);
+            case 'r':
+                return keyword_if_equal("true", TokenKind::keyword_true);
+            default:
+                return TokenKind::identifier;
+            }
+        case 'v':
+            return keyword_if_equal("var", TokenKind::keyword_var);
+        case 'w':
+            return keyword_if_equal("while", TokenKind::keyword_while);
+        default:
+            return TokenKind::identifier;
+        }
+    }
+
+    static_assert(keyword_kind("while") == TokenKind::keyword_while);
+    static_assert(keyword_kind("fun") == TokenKind::keyword_fun);
+    static_assert(keyword_kind("this") == TokenKind::keyword_this);
+    static_assert(keyword_kind("thus") == TokenKind::identifier);
+    static_assert(keyword_kind("variable") == TokenKind::identifier);
 
     static constexpr auto token_kind_to_string(const TokenKind &tk) noexcept -> std::string_view {
         switch (tk) {
@@ -41,14 +143,74 @@ namespace lox::syntax {
             return "number-literal";
         case TokenKind::identifier:
             return "identifier";
-        case TokenKind::punctuation:
-            return "punctuation";
-        case TokenKind::simple_operator:
-            return "simple-operator";
-        case TokenKind::compound_operator:
-            return "compound-operator";
-        case TokenKind::keyword:
-            return "keyword";
+        case TokenKind::left_paren:
+            return "left-paren";
+        case TokenKind::right_paren:
+            return "right-paren";
+        case TokenKind::left_brace:
+            return "left-brace";
+        case TokenKind::right_brace:
+            return "right-brace";
+        case TokenKind::comma:
+            return "comma";
+        case TokenKind::semicolon:
+            return "semicolon";
+        case TokenKind::plus:
+            return "plus";
+        case TokenKind::minus:
+            return "minus";
+        case TokenKind::star:
+            return "star";
+        case TokenKind::slash:
+            return "slash";
+        case TokenKind::bang:
+            return "bang";
+        case TokenKind::bang_equal:
+            return "bang-equal";
+        case TokenKind::equal:
+            return "equal";
+        case TokenKind::equal_equal:
+            return "equal-equal";
+        case TokenKind::less:
+            return "less";
+        case TokenKind::less_equal:
+            return "less-equal";
+        case TokenKind::greater:
+            return "greater";
+        case TokenKind::greater_equal:
+            return "greater-equal";
+        case TokenKind::keyword_and:
+            return "keyword-and";
+        case TokenKind::keyword_class:
+            return "keyword-class";
+        case TokenKind::keyword_else:
+            return "keyword-else";
+        case TokenKind::keyword_false:
+            return "keyword-false";
+        case TokenKind::keyword_for:
+            return "keyword-for";
+        case TokenKind::keyword_fun:
+            return "keyword-fun";
+        case TokenKind::keyword_if:
+            return "keyword-if";
+        case TokenKind::keyword_nil:
+            return "keyword-nil";
+        case TokenKind::keyword_or:
+            return "keyword-or";
+        case TokenKind::keyword_print:
+            return "keyword-print";
+        case TokenKind::keyword_return:
+            return "keyword-return";
+        case TokenKind::keyword_super:
+            return "keyword-super";
+        case TokenKind::keyword_this:
+            return "keyword-this";
+        case TokenKind::keyword_true:
+            return "keyword-true";
+        case TokenKind::keyword_var:
+            return "keyword-var";
+        case TokenKind::keyword_while:
+            return "keyword-while";
         case TokenKind::end_of_file:
             return "EOF";
         }
@@ -56,9 +218,16 @@ namespace lox::syntax {
         std::unreachable();
     }
 
+    /**
+     * @brief A lexical token.
+     *
+     * The lexeme borrows from the source buffer the token was scanned from, so tokens are trivially copyable and
+     * never allocate. The caller owns the source and must keep it alive for as long as any token (or AST node
+     * holding one) refers to it.
+     */
     struct Token {
         TokenKind kind = TokenKind::end_of_file;
-        std::string lexeme;
+        std::string_view lexeme;
         Span span{.start = 0, .end = 0};
 
         static auto make(TokenKind k, std::string_view l, Span s) noexcept -> Token;
@@ -67,6 +236,8 @@ namespace lox::syntax {
         [[nodiscard]] auto to_string() const noexcept -> std::string;
     };
 
+    static_assert(std::is_trivially_copyable_v<Token>);
+
 } // namespace lox::syntax
 
 #endif // LOX_SYNTAX_TOKEN_HPP
@@ -1,74 +1,237 @@
 #include "lox/vm/chunk.hpp"
 
+#include "lox/syntax/line_index.hpp"
 #include "lox/vm/common.hpp"
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <new>
 #include <print>
+#include <span>
+#include <string_view>
 
 namespace lox::vm {
 
-    Chunk::Chunk() : count(0), capacity(0), lines(0), code({}), constants({}) {}
+    namespace {
 
-    auto Chunk::write(uint8_t byte, size_t line) noexcept -> void {
-        code.push_back(byte);
-        lines.push_back(line);
-        count++;
+        constexpr auto align_up(const std::size_t offset, const std::size_t alignment) noexcept -> std::size_t {
+            return (offset + alignment - 1) / alignment * alignment;
+        }
+
+    } // namespace
+
+    auto ChunkBuilder::write(uint8_t byte, size_t source_offset) -> void {
+        m_code.push_back(byte);
+        m_source_map.append(source_offset);
     }
 
-    auto Chunk::add_constant(Value value) noexcept -> size_t {
-        constants.push_back(value);
-        return constants.size() - 1;
+    auto ChunkBuilder::add_constant(Value value) -> size_t {
+        const auto [slot, inserted] = m_constant_index.try_emplace(
+            ConstantKey{.type = value.type(), .bits = value.bits()}, m_constants.size());
+        if (inserted) {
+            m_constants.push_back(value);
+        }
+        return slot->second;
     }
 
-    auto Chunk::disassemble(std::string_view name) noexcept -> void {
-        std::println("== {} ==\n", name);
+    auto ChunkBuilder::finish() -> Chunk {
+        const auto source_map = m_source_map.finish();
+        const auto checkpoints = source_map.checkpoints();
+        const auto encoded = source_map.encoded();
+
+        // Layout: constants | code | checkpoints | encoded source map.
+        const auto code_start = m_constants.size() * sizeof(Value);
+        const auto checkpoints_start = align_up(code_start + m_code.size(), alignof(SourceMapCheckpoint));
+        const auto encoded_start = checkpoints_start + checkpoints.size_bytes();
+        const auto total = encoded_start + encoded.size();
+        static_assert(alignof(Value) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+        static_assert(alignof(SourceMapCheckpoint) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+
+        Chunk chunk;
+        chunk.m_storage = std::make_unique_for_overwrite<std::byte[]>(total);
+        chunk.m_storage_size = total;
+        auto *const base = chunk.m_storage.get();
+
+        auto *const constants = reinterpret_cast<Value *>(base);
+        std::ranges::uninitialized_copy(m_constants, std::span{constants, m_constants.size()});
+        auto *const code = reinterpret_cast<std::uint8_t *>(base + code_start);
+        std::ranges::copy(m_code, code);
+        auto *const frozen_checkpoints = reinterpret_cast<SourceMapCheckpoint *>(base + checkpoints_start);
+        std::ranges::uninitialized_copy(checkpoints, std::span{frozen_checkpoints, checkpoints.size()});
+        auto *const frozen_encoded = reinterpret_cast<std::uint8_t *>(base + encoded_start);
+        std::ranges::copy(encoded, frozen_encoded);
+
+        chunk.m_constants = {constants, m_constants.size()};
+        chunk.m_code = {code, m_code.size()};
+        chunk.m_source_map = SourceMap{std::span{frozen_encoded, encoded.size()},
+                                       std::span{frozen_checkpoints, checkpoints.size()}, source_map.size()};
+        chunk.m_max_stack = m_max_stack;
 
-        for (size_t offset = 0; offset < count;) {
-            offset = this->disassemble_instruction(offset);
+        *this = ChunkBuilder{};
+        return chunk;
+    }
+
+    auto Chunk::disassemble(std::string_view name, const syntax::LineIndex *lines) const noexcept -> void {
+        std::println("== {} (max stack {}) ==\n", name, m_max_stack);
+
+        for (size_t offset = 0; offset < m_code.size();) {
+            offset = this->disassemble_instruction(offset, lines);
         }
     }
 
-    auto Chunk::disassemble_instruction(size_t offset) noexcept -> size_t {
+    auto Chunk::disassemble_instruction(size_t offset, const syntax::LineIndex *lines) const noexcept -> size_t {
         std::print("{:04} ", offset);
 
-        if (offset > 0 && lines[offset] == lines[offset - 1]) {
+        if (lines == nullptr) {
+            std::print("@{:<4} ", m_source_map.source_offset(offset));
+        } else if (const auto line = lines->locate(m_source_map.source_offset(offset)).line;
+                   offset > 0 && line == lines->locate(m_source_map.source_offset(offset - 1)).line) {
             std::print("    | ");
         } else {
-            std::print("{:4} ", lines[offset]);
+            std::print("{:4} ", line);
         }
 
-        const auto instruction = static_cast<OpCode>(code[offset]);
+        const auto simple = [offset](const std::string_view name) {
+            std::println("{}", name);
+            return offset + 1;
+        };
+
+        const auto instruction = static_cast<OpCode>(m_code[offset]);
         switch (instruction) {
         case OpCode::OP_CONSTANT:
             return disassemble_constant_instruction("OP_CONSTANT", offset);
+        case OpCode::OP_CONSTANT_LONG:
+            return disassemble_constant_long_instruction("OP_CONSTANT_LONG", offset);
+        case OpCode::OP_NIL:
+            return simple("OP_NIL");
+        case OpCode::OP_TRUE:
+            return simple("OP_TRUE");
+        case OpCode::OP_FALSE:
+            return simple("OP_FALSE");
+        case OpCode::OP_POP:
+            return simple("OP_POP");
+        case OpCode::OP_GET_LOCAL:
+            return disassemble_byte_instruction("OP_GET_LOCAL", offset);
+        case OpCode::OP_SET_LOCAL:
+            return disassemble_byte_instruction("OP_SET_LOCAL", offset);
+        case OpCode::OP_GET_GLOBAL:
+            return disassemble_byte_instruction("OP_GET_GLOBAL", offset);
+        case OpCode::OP_GET_GLOBAL_LONG:
+            return disassemble_long_operand_instruction("OP_GET_GLOBAL_LONG", offset);
+        case OpCode::OP_DEFINE_GLOBAL:
+            return disassemble_byte_instruction("OP_DEFINE_GLOBAL", offset);
+        case OpCode::OP_DEFINE_GLOBAL_LONG:
+            return disassemble_long_operand_instruction("OP_DEFINE_GLOBAL_LONG", offset);
+        case OpCode::OP_SET_GLOBAL:
+            return disassemble_byte_instruction("OP_SET_GLOBAL", offset);
+        case OpCode::OP_SET_GLOBAL_LONG:
+            return disassemble_long_operand_instruction("OP_SET_GLOBAL_LONG", offset);
+        case OpCode::OP_GET_UPVALUE:
+            return disassemble_byte_instruction("OP_GET_UPVALUE", offset);
+        case OpCode::OP_SET_UPVALUE:
+            return disassemble_byte_instruction("OP_SET_UPVALUE", offset);
+        case OpCode::OP_EQUAL:
+            return simple("OP_EQUAL");
+        case OpCode::OP_GREATER:
+            return simple("OP_GREATER");
+        case OpCode::OP_LESS:
+            return simple("OP_LESS");
         case OpCode::OP_ADD:
-            std::println("OP_ADD");
-            return offset + 1;
+            return simple("OP_ADD");
         case OpCode::OP_SUBTRACT:
-            std::println("OP_SUBTRACT");
-            return offset + 1;
+            return simple("OP_SUBTRACT");
         case OpCode::OP_MULTIPLY:
-            std::println("OP_MULTIPLY");
-            return offset + 1;
+            return simple("OP_MULTIPLY");
         case OpCode::OP_DIVIDE:
-            std::println("OP_DIVIDE");
-            return offset + 1;
+            return simple("OP_DIVIDE");
+        case OpCode::OP_NOT:
+            return simple("OP_NOT");
         case OpCode::OP_NEGATE:
-            std::println("OP_NEGATE");
-            return offset + 1;
+            return simple("OP_NEGATE");
+        case OpCode::OP_PRINT:
+            return simple("OP_PRINT");
+        case OpCode::OP_JUMP:
+            return disassemble_jump_instruction("OP_JUMP", 1, offset);
+        case OpCode::OP_JUMP_IF_FALSE:
+            return disassemble_jump_instruction("OP_JUMP_IF_FALSE", 1, offset);
+        case OpCode::OP_LOOP:
+            return disassemble_jump_instruction("OP_LOOP", -1, offset);
+        case OpCode::OP_CALL:
+            return disassemble_byte_instruction("OP_CALL", offset);
+        case OpCode::OP_CLOSURE:
+            return disassemble_constant_instruction("OP_CLOSURE", offset);
+        case OpCode::OP_CLOSURE_LONG:
+            return disassemble_constant_long_instruction("OP_CLOSURE_LONG", offset);
+        case OpCode::OP_CLOSE_UPVALUE:
+            return simple("OP_CLOSE_UPVALUE");
         case OpCode::OP_RETURN:
-            std::println("OP_RETURN");
-            return offset + 1;
+            return simple("OP_RETURN");
+        case OpCode::OP_ADD_CONSTANT:
+            return disassemble_constant_instruction("OP_ADD_CONSTANT", offset);
+        case OpCode::OP_SUBTRACT_CONSTANT:
+            return disassemble_constant_instruction("OP_SUBTRACT_CONSTANT", offset);
+        case OpCode::OP_ADD_LOCALS:
+            return disassemble_two_byte_instruction("OP_ADD_LOCALS", offset);
+        case OpCode::OP_SUBTRACT_LOCALS:
+            return disassemble_two_byte_instruction("OP_SUBTRACT_LOCALS", offset);
+        case OpCode::OP_MULTIPLY_LOCALS:
+            return disassemble_two_byte_instruction("OP_MULTIPLY_LOCALS", offset);
+        case OpCode::OP_DIVIDE_LOCALS:
+            return disassemble_two_byte_instruction("OP_DIVIDE_LOCALS", offset);
+        case OpCode::OP_EQUAL_JUMP_IF_FALSE:
+            return disassemble_jump_instruction("OP_EQUAL_JUMP_IF_FALSE", 1, offset);
+        case OpCode::OP_GREATER_JUMP_IF_FALSE:
+            return disassemble_jump_instruction("OP_GREATER_JUMP_IF_FALSE", 1, offset);
+        case OpCode::OP_LESS_JUMP_IF_FALSE:
+            return disassemble_jump_instruction("OP_LESS_JUMP_IF_FALSE", 1, offset);
         default:
-            std::println("Unknown opcode {}", static_cast<int>(code[offset]));
+            std::println("Unknown opcode {}", static_cast<int>(m_code[offset]));
             return offset + 1;
         }
     }
 
-    auto Chunk::disassemble_constant_instruction(const std::string_view name, size_t offset) noexcept -> size_t {
-        const auto constant_index = code[offset + 1];
-        std::println("{} {:4} '{}'", name, constant_index, static_cast<double>(constants[constant_index]));
+    auto Chunk::disassemble_constant_instruction(const std::string_view name, size_t offset) const noexcept
+        -> size_t {
+        const auto constant_index = m_code[offset + 1];
+        std::println("{:<16} {:4} '{}'", name, constant_index, value_to_string(m_constants[constant_index]));
         return offset + 2;
     }
 
+    auto Chunk::disassemble_constant_long_instruction(const std::string_view name, size_t offset) const noexcept
+        -> size_t {
+        const auto constant_index = static_cast<std::uint32_t>(m_code[offset + 1]) << 16U |
+                                    static_cast<std::uint32_t>(m_code[offset + 2]) << 8U | m_code[offset + 3];
+        std::println("{:<16} {:4} '{}'", name, constant_index, value_to_string(m_constants[constant_index]));
+        return offset + 4;
+    }
+
+    auto Chunk::disassemble_long_operand_instruction(const std::string_view name, size_t offset) const noexcept
+        -> size_t {
+        const auto operand = static_cast<std::uint32_t>(m_code[offset + 1]) << 16U |
+                             static_cast<std::uint32_t>(m_code[offset + 2]) << 8U | m_code[offset + 3];
+        std::println("{:<16} {:4}", name, operand);
+        return offset + 4;
+    }
+
+    auto Chunk::disassemble_byte_instruction(const std::string_view name, size_t offset) const noexcept -> size_t {
+        std::println("{:<16} {:4}", name, m_code[offset + 1]);
+        return offset + 2;
+    }
+
+    auto Chunk::disassemble_two_byte_instruction(const std::string_view name, size_t offset) const noexcept
+        -> size_t {
+        std::println("{:<16} {:4} {:4}", name, m_code[offset + 1], m_code[offset + 2]);
+        return offset + 3;
+    }
+
+    auto Chunk::disassemble_jump_instruction(const std::string_view name, const int sign, size_t offset) const noexcept
+        -> size_t {
+        const auto jump = static_cast<std::uint16_t>(m_code[offset + 1] << 8U | m_code[offset + 2]);
+        const auto target = static_cast<std::ptrdiff_t>(offset) + 3 + sign * static_cast<std::ptrdiff_t>(jump);
+        std::println("{:<16} {:4} -> {}", name, offset, target);
+        return offset + 3;
+    }
+
 } // namespace lox::vm
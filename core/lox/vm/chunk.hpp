@@ -1,34 +1,120 @@
 #ifndef LOX_VM_CHUNK_HPP
 #define LOX_VM_CHUNK_HPP
 
+#include "lox/syntax/line_index.hpp"
+#include "lox/vm/source_map.hpp"
 #include "lox/vm/value.hpp"
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
 #include <string_view>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 namespace lox::vm {
 
-    struct Chunk {
-        std::vector<std::uint8_t> code;
-        std::vector<Value> constants;
-        std::vector<size_t> lines;
-        size_t capacity;
-        size_t count;
-
-        explicit Chunk();
-        Chunk(const Chunk &) = default;
-        Chunk(Chunk &&) = default;
-        auto operator=(const Chunk &) -> Chunk & = default;
-        auto operator=(Chunk &&) -> Chunk & = delete;
+    /**
+     * @brief A finished, immutable unit of bytecode.
+     *
+     * Constants, code and the source map share one allocation, laid out so that the constant pool and the code the
+     * dispatch loop reads sit next to each other and the debug information trails behind. Chunks are produced by
+     * ChunkBuilder::finish, are move-only, and never change afterwards, so any number of executions may read one
+     * concurrently.
+     */
+    class Chunk final {
+    public:
+        Chunk() noexcept = default;
+        Chunk(const Chunk &) = delete;
+        Chunk(Chunk &&) noexcept = default;
+        auto operator=(const Chunk &) -> Chunk & = delete;
+        auto operator=(Chunk &&) noexcept -> Chunk & = default;
         ~Chunk() = default;
 
-        auto write(uint8_t byte, size_t line) noexcept -> void;
-        auto add_constant(Value value) noexcept -> size_t;
+        [[nodiscard]] auto code() const noexcept -> std::span<const std::uint8_t> { return m_code; }
+        [[nodiscard]] auto constants() const noexcept -> std::span<const Value> { return m_constants; }
+        /// The source byte offset each code byte was compiled from; lines are resolved through a LineIndex on demand.
+        [[nodiscard]] auto source_map() const noexcept -> const SourceMap & { return m_source_map; }
 
-        auto disassemble(std::string_view name) noexcept -> void;
-        auto disassemble_instruction(size_t offset) noexcept -> size_t;
-        auto disassemble_constant_instruction(const std::string_view name, size_t offset) noexcept -> size_t;
+        /// The most values a frame running this chunk holds at once, counting the callee and arguments. The VM checks
+        /// for this much room once per call, so the body can push without bounds checks.
+        [[nodiscard]] auto max_stack() const noexcept -> std::size_t { return m_max_stack; }
+
+        /// The size of the chunk's single allocation.
+        [[nodiscard]] auto memory_bytes() const noexcept -> std::size_t { return m_storage_size; }
+
+        /// Prints the chunk, labelling instructions with source lines from @p lines or, without one, byte offsets.
+        auto disassemble(std::string_view name, const syntax::LineIndex *lines = nullptr) const noexcept -> void;
+        auto disassemble_instruction(size_t offset, const syntax::LineIndex *lines = nullptr) const noexcept
+            -> size_t;
+
+    private:
+        friend class ChunkBuilder;
+
+        auto disassemble_constant_instruction(std::string_view name, size_t offset) const noexcept -> size_t;
+        auto disassemble_constant_long_instruction(std::string_view name, size_t offset) const noexcept -> size_t;
+        auto disassemble_long_operand_instruction(std::string_view name, size_t offset) const noexcept -> size_t;
+        auto disassemble_byte_instruction(std::string_view name, size_t offset) const noexcept -> size_t;
+        auto disassemble_two_byte_instruction(std::string_view name, size_t offset) const noexcept -> size_t;
+        auto disassemble_jump_instruction(std::string_view name, int sign, size_t offset) const noexcept -> size_t;
+
+        std::unique_ptr<std::byte[]> m_storage;
+        std::size_t m_storage_size = 0;
+        std::span<const Value> m_constants;
+        std::span<const std::uint8_t> m_code;
+        SourceMap m_source_map;
+        std::size_t m_max_stack = 0;
+    };
+
+    static_assert(!std::is_copy_constructible_v<Chunk> && std::is_nothrow_move_assignable_v<Chunk>);
+
+    /// Identifies a constant by type and bit pattern, so the pool shares equal literals without merging 0 and -0.
+    struct ConstantKey {
+        ValueType type;
+        std::uint64_t bits;
+
+        friend auto operator==(const ConstantKey &, const ConstantKey &) noexcept -> bool = default;
+    };
+
+    struct ConstantKeyHash {
+        [[nodiscard]] auto operator()(const ConstantKey &key) const noexcept -> std::size_t {
+            return std::hash<std::uint64_t>{}(key.bits) ^ static_cast<std::size_t>(key.type);
+        }
+    };
+
+    /// Accumulates code, constants and source positions for one function during compilation.
+    class ChunkBuilder final {
+    public:
+        auto write(uint8_t byte, size_t source_offset) -> void;
+        /// Overwrites an already written byte; used to back-patch jump operands.
+        auto patch(size_t offset, uint8_t byte) noexcept -> void { m_code[offset] = byte; }
+
+        /// Returns the slot holding @p value, appending it to the pool only if no identical constant is there yet.
+        auto add_constant(Value value) -> size_t;
+
+        [[nodiscard]] auto constant(size_t index) const noexcept -> Value { return m_constants[index]; }
+        [[nodiscard]] auto constants() const noexcept -> std::span<const Value> { return m_constants; }
+
+        /// The number of code bytes written so far.
+        [[nodiscard]] auto size() const noexcept -> size_t { return m_code.size(); }
+
+        /// Records that the frame holds @p depth values at some point, raising the chunk's max_stack if needed.
+        auto note_stack_depth(const size_t depth) noexcept -> void { m_max_stack = std::max(m_max_stack, depth); }
+
+        /// Freezes everything written so far into a Chunk. The builder is left empty.
+        [[nodiscard]] auto finish() -> Chunk;
+
+    private:
+        std::vector<std::uint8_t> m_code;
+        std::vector<Value> m_constants;
+        /// Maps each distinct constant to its slot in @c m_constants.
+        std::unordered_map<ConstantKey, size_t, ConstantKeyHash> m_constant_index;
+        SourceMapBuilder m_source_map;
+        size_t m_max_stack = 0;
     };
 
 } // namespace lox::vm
@@ -1,6 +1,7 @@
 #ifndef LOX_VM_COMMON_HPP
 #define LOX_VM_COMMON_HPP
 
+#include <cstddef>
 #include <cstdint>
 
 namespace lox::vm {
@@ -8,17 +9,181 @@ namespace lox::vm {
     /**
      * @enum OpCode
      * @brief The operation codes for the bytecode instructions.
+     *
+     * Operands follow the opcode byte: one-byte constant indices, local, upvalue and global slots and argument
+     * counts, and two-byte big-endian jump distances. The @c _LONG forms take a three-byte big-endian index, for
+     * chunks with more than 256 constants or programs with more than 256 globals. OP_CLOSURE's constant is the
+     * function to close over; which variables it captures is recorded on the function rather than in the code, so
+     * every instruction has a fixed width.
+     *
+     * The opcodes after OP_RETURN are superinstructions. The compiler never emits them directly; the peephole pass
+     * in optimize.hpp fuses common sequences into them.
      */
     enum class OpCode : std::uint8_t {
         OP_CONSTANT,
+        OP_CONSTANT_LONG,
+        OP_NIL,
+        OP_TRUE,
+        OP_FALSE,
+        OP_POP,
+        OP_GET_LOCAL,
+        OP_SET_LOCAL,
+        OP_GET_GLOBAL,
+        OP_GET_GLOBAL_LONG,
+        OP_DEFINE_GLOBAL,
+        OP_DEFINE_GLOBAL_LONG,
+        OP_SET_GLOBAL,
+        OP_SET_GLOBAL_LONG,
+        OP_GET_UPVALUE,
+        OP_SET_UPVALUE,
+        OP_EQUAL,
+        OP_GREATER,
+        OP_LESS,
         OP_ADD,
         OP_SUBTRACT,
         OP_MULTIPLY,
         OP_DIVIDE,
+        OP_NOT,
         OP_NEGATE,
+        OP_PRINT,
+        OP_JUMP,
+        OP_JUMP_IF_FALSE,
+        OP_LOOP,
+        OP_CALL,
+        OP_CLOSURE,
+        OP_CLOSURE_LONG,
+        OP_CLOSE_UPVALUE,
         OP_RETURN,
+
+        // Superinstructions.
+        OP_ADD_CONSTANT,          ///< OP_CONSTANT k, OP_ADD
+        OP_SUBTRACT_CONSTANT,     ///< OP_CONSTANT k, OP_SUBTRACT
+        OP_ADD_LOCALS,            ///< OP_GET_LOCAL a, OP_GET_LOCAL b, OP_ADD
+        OP_SUBTRACT_LOCALS,       ///< OP_GET_LOCAL a, OP_GET_LOCAL b, OP_SUBTRACT
+        OP_MULTIPLY_LOCALS,       ///< OP_GET_LOCAL a, OP_GET_LOCAL b, OP_MULTIPLY
+        OP_DIVIDE_LOCALS,         ///< OP_GET_LOCAL a, OP_GET_LOCAL b, OP_DIVIDE
+        OP_EQUAL_JUMP_IF_FALSE,   ///< OP_EQUAL, OP_JUMP_IF_FALSE
+        OP_GREATER_JUMP_IF_FALSE, ///< OP_GREATER, OP_JUMP_IF_FALSE
+        OP_LESS_JUMP_IF_FALSE,    ///< OP_LESS, OP_JUMP_IF_FALSE
+    };
+
+    /// The number of opcodes; a code byte at or above it in opcode position is malformed.
+    constexpr std::size_t OPCODE_COUNT = static_cast<std::size_t>(OpCode::OP_LESS_JUMP_IF_FALSE) + 1;
+
+    /// The number of operand bytes following @p op.
+    [[nodiscard]] constexpr auto operand_bytes(const OpCode op) noexcept -> std::size_t {
+        switch (op) {
+        case OpCode::OP_CONSTANT:
+        case OpCode::OP_GET_LOCAL:
+        case OpCode::OP_SET_LOCAL:
+        case OpCode::OP_GET_GLOBAL:
+        case OpCode::OP_DEFINE_GLOBAL:
+        case OpCode::OP_SET_GLOBAL:
+        case OpCode::OP_GET_UPVALUE:
+        case OpCode::OP_SET_UPVALUE:
+        case OpCode::OP_CALL:
+        case OpCode::OP_CLOSURE:
+        case OpCode::OP_ADD_CONSTANT:
+        case OpCode::OP_SUBTRACT_CONSTANT:
+            return 1;
+        case OpCode::OP_JUMP:
+        case OpCode::OP_JUMP_IF_FALSE:
+        case OpCode::OP_LOOP:
+        case OpCode::OP_ADD_LOCALS:
+        case OpCode::OP_SUBTRACT_LOCALS:
+        case OpCode::OP_MULTIPLY_LOCALS:
+        case OpCode::OP_DIVIDE_LOCALS:
+        case OpCode::OP_EQUAL_JUMP_IF_FALSE:
+        case OpCode::OP_GREATER_JUMP_IF_FALSE:
+        case OpCode::OP_LESS_JUMP_IF_FALSE:
+            return 2;
+        case OpCode::OP_CONSTANT_LONG:
+        case OpCode::OP_GET_GLOBAL_LONG:
+        case OpCode::OP_DEFINE_GLOBAL_LONG:
+        case OpCode::OP_SET_GLOBAL_LONG:
+        case OpCode::OP_CLOSURE_LONG:
+            return 3;
+        default:
+            return 0;
+        }
+    }
+
+    /// How many values an instruction takes off the stack and how many it leaves in their place.
+    struct StackEffect {
+        std::size_t pops;
+        std::size_t pushes;
     };
 
+    /// The stack effect of @p op; @p first_operand is only consulted for OP_CALL, whose operand is the argument count.
+    [[nodiscard]] constexpr auto stack_effect(const OpCode op, const std::uint8_t first_operand) noexcept
+        -> StackEffect {
+        switch (op) {
+        case OpCode::OP_CONSTANT:
+        case OpCode::OP_CONSTANT_LONG:
+        case OpCode::OP_NIL:
+        case OpCode::OP_TRUE:
+        case OpCode::OP_FALSE:
+        case OpCode::OP_GET_LOCAL:
+        case OpCode::OP_GET_GLOBAL:
+        case OpCode::OP_GET_GLOBAL_LONG:
+        case OpCode::OP_GET_UPVALUE:
+        case OpCode::OP_CLOSURE:
+        case OpCode::OP_CLOSURE_LONG:
+        case OpCode::OP_ADD_LOCALS:
+        case OpCode::OP_SUBTRACT_LOCALS:
+        case OpCode::OP_MULTIPLY_LOCALS:
+        case OpCode::OP_DIVIDE_LOCALS:
+            return {.pops = 0, .pushes = 1};
+        case OpCode::OP_POP:
+        case OpCode::OP_DEFINE_GLOBAL:
+        case OpCode::OP_DEFINE_GLOBAL_LONG:
+        case OpCode::OP_PRINT:
+        case OpCode::OP_CLOSE_UPVALUE:
+        case OpCode::OP_RETURN:
+            return {.pops = 1, .pushes = 0};
+        case OpCode::OP_SET_LOCAL:
+        case OpCode::OP_SET_GLOBAL:
+        case OpCode::OP_SET_GLOBAL_LONG:
+        case OpCode::OP_SET_UPVALUE:
+        case OpCode::OP_NOT:
+        case OpCode::OP_NEGATE:
+        case OpCode::OP_JUMP_IF_FALSE:
+        case OpCode::OP_ADD_CONSTANT:
+        case OpCode::OP_SUBTRACT_CONSTANT:
+            return {.pops = 1, .pushes = 1};
+        case OpCode::OP_EQUAL:
+        case OpCode::OP_GREATER:
+        case OpCode::OP_LESS:
+        case OpCode::OP_ADD:
+        case OpCode::OP_SUBTRACT:
+        case OpCode::OP_MULTIPLY:
+        case OpCode::OP_DIVIDE:
+        case OpCode::OP_EQUAL_JUMP_IF_FALSE:
+        case OpCode::OP_GREATER_JUMP_IF_FALSE:
+        case OpCode::OP_LESS_JUMP_IF_FALSE:
+            return {.pops = 2, .pushes = 1};
+        case OpCode::OP_CALL:
+            // The callee and its arguments are replaced by the result.
+            return {.pops = std::size_t{first_operand} + 1, .pushes = 1};
+        case OpCode::OP_JUMP:
+        case OpCode::OP_LOOP:
+            return {.pops = 0, .pushes = 0};
+        }
+        return {.pops = 0, .pushes = 0};
+    }
+
+    /// Whether @p op's two operand bytes are a forward jump distance.
+    [[nodiscard]] constexpr auto is_forward_jump(const OpCode op) noexcept -> bool {
+        return op == OpCode::OP_JUMP || op == OpCode::OP_JUMP_IF_FALSE || op == OpCode::OP_EQUAL_JUMP_IF_FALSE ||
+               op == OpCode::OP_GREATER_JUMP_IF_FALSE || op == OpCode::OP_LESS_JUMP_IF_FALSE;
+    }
+
+    /// One more than the largest one-byte operand: the limit on constants, locals and arguments per function.
+    constexpr std::size_t UINT8_COUNT = UINT8_MAX + 1;
+
+    /// The largest constant index a @c _LONG instruction can encode.
+    constexpr std::size_t CONSTANT_LONG_MAX = (std::size_t{1} << 24U) - 1;
+
 } // namespace lox::vm
 
 #endif
@@ -1,26 +1,578 @@
 #include "lox/vm/compile.hpp"
 
+#include "lox/ast/expr.hpp"
+#include "lox/ast/fold.hpp"
 #include "lox/ast/parse.hpp"
+#include "lox/ast/resolve.hpp"
+#include "lox/ast/stmt.hpp"
+#include "lox/syntax/source.hpp"
+#include "lox/syntax/token.hpp"
+#include "lox/vm/common.hpp"
+#include "lox/vm/object.hpp"
+#include "lox/vm/optimize.hpp"
 
+#include <spdlog/spdlog.h>
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <limits>
 #include <string_view>
 
 namespace lox::vm {
 
-    auto Compiler::compile(std::string_view source, Chunk *chunk) noexcept -> bool {
+    using syntax::TokenKind;
+
+    auto Compiler::compile(std::string_view source) noexcept -> std::expected<ObjFunction *, std::string> {
+        m_file = nullptr;
         auto parser = lox::ast::Parser(source);
+        return compile(parser);
+    }
+
+    auto Compiler::compile(const syntax::SourceFile &file) noexcept -> std::expected<ObjFunction *, std::string> {
+        m_file = &file;
+        auto parser = lox::ast::Parser(file);
+        return compile(parser);
+    }
+
+    auto Compiler::compile(ast::Parser &parser) noexcept -> std::expected<ObjFunction *, std::string> {
         auto result = parser.parse();
         if (!result.has_value()) {
             spdlog::error("Parser error: {}", result.error());
-            return false;
+            return std::unexpected(std::move(result.error()));
+        }
+
+        // Resolve before folding, so that scope errors in branches folding prunes are still reported.
+        if (auto resolved = ast::resolve(result.value(), m_file); !resolved) {
+            spdlog::error("Compiler: {}", resolved.error());
+            return std::unexpected(std::move(resolved.error()));
+        }
+
+        m_fold_stats = ast::fold_constants(result.value());
+        spdlog::info("Compiler: Folded {} expressions and pruned {} branches", m_fold_stats.folded_expressions,
+                     m_fold_stats.pruned_branches);
+
+        m_error.reset();
+        m_offset = 0;
+
+        m_heap->add_roots(*this);
+        FunctionState script{};
+        begin_function(script);
+        for (const auto *stmt : result.value().statements()) {
+            statement(*stmt);
+        }
+        auto *function = end_function();
+        m_heap->remove_roots(this);
+
+        if (m_error) {
+            spdlog::error("Compiler: {}", *m_error);
+            return std::unexpected(std::move(*m_error));
+        }
+        return function;
+    }
+
+    // --- Statements ---
+
+    auto Compiler::statement(const ast::Statement &stmt) -> void {
+        if (m_error) {
+            return;
+        }
+        ast::visit(stmt, [this](const auto &node) { statement(node); });
+    }
+
+    auto Compiler::statement(const ast::ExpressionStatement &stmt) -> void {
+        expression(*stmt.expression);
+        emit_op(OpCode::OP_POP);
+    }
+
+    auto Compiler::statement(const ast::PrintStatement &stmt) -> void {
+        expression(*stmt.expression);
+        emit_op(OpCode::OP_PRINT);
+    }
+
+    auto Compiler::statement(const ast::VarStatement &stmt) -> void {
+        at(stmt.name);
+        declare_variable(stmt.captured);
+
+        if (stmt.initializer != nullptr) {
+            expression(*stmt.initializer);
+        } else {
+            emit_op(OpCode::OP_NIL);
+        }
+
+        at(stmt.name);
+        define_variable(stmt.name);
+    }
+
+    auto Compiler::statement(const ast::BlockStatement &stmt) -> void {
+        begin_scope();
+        for (const auto *inner : stmt.statements) {
+            statement(*inner);
+        }
+        end_scope();
+    }
+
+    auto Compiler::statement(const ast::IfStatement &stmt) -> void {
+        expression(*stmt.condition);
+
+        const auto then_jump = emit_jump(OpCode::OP_JUMP_IF_FALSE);
+        emit_op(OpCode::OP_POP);
+        statement(*stmt.then_branch);
+
+        const auto else_jump = emit_jump(OpCode::OP_JUMP);
+        patch_jump(then_jump);
+        // The code below is entered from the conditional jump, with the condition still on the stack.
+        ++m_state->stack_depth;
+        emit_op(OpCode::OP_POP);
+
+        if (stmt.else_branch != nullptr) {
+            statement(*stmt.else_branch);
+        }
+        patch_jump(else_jump);
+    }
+
+    auto Compiler::statement(const ast::WhileStatement &stmt) -> void {
+        const auto loop_start = current_chunk().size();
+        expression(*stmt.condition);
+
+        const auto exit_jump = emit_jump(OpCode::OP_JUMP_IF_FALSE);
+        emit_op(OpCode::OP_POP);
+        statement(*stmt.body);
+        emit_loop(loop_start);
+
+        patch_jump(exit_jump);
+        // Leaving the loop, the condition the jump tested is still on the stack.
+        ++m_state->stack_depth;
+        emit_op(OpCode::OP_POP);
+    }
+
+    auto Compiler::statement(const ast::ForStatement &stmt) -> void {
+        begin_scope();
+        if (stmt.initializer != nullptr) {
+            statement(*stmt.initializer);
+        }
+
+        auto loop_start = current_chunk().size();
+        std::optional<std::size_t> exit_jump;
+        if (stmt.condition != nullptr) {
+            expression(*stmt.condition);
+            exit_jump = emit_jump(OpCode::OP_JUMP_IF_FALSE);
+            emit_op(OpCode::OP_POP);
+        }
+
+        if (stmt.increment != nullptr) {
+            // The increment follows the condition in the bytecode but runs after the body: jump over it on the way
+            // in, and have the body loop back to it.
+            const auto body_jump = emit_jump(OpCode::OP_JUMP);
+            const auto increment_start = current_chunk().size();
+            expression(*stmt.increment);
+            emit_op(OpCode::OP_POP);
+            emit_loop(loop_start);
+            loop_start = increment_start;
+            patch_jump(body_jump);
+        }
+
+        statement(*stmt.body);
+        emit_loop(loop_start);
+
+        if (exit_jump) {
+            patch_jump(*exit_jump);
+            ++m_state->stack_depth;
+            emit_op(OpCode::OP_POP);
+        }
+        end_scope();
+    }
+
+    auto Compiler::statement(const ast::ReturnStatement &stmt) -> void {
+        at(stmt.keyword);
+        if (stmt.value == nullptr) {
+            emit_return();
+            return;
+        }
+        expression(*stmt.value);
+        emit_op(OpCode::OP_RETURN);
+    }
+
+    auto Compiler::statement(const ast::FunctionDeclarationStatement &stmt) -> void {
+        at(stmt.name);
+        declare_variable(stmt.captured);
+        function(stmt);
+        at(stmt.name);
+        define_variable(stmt.name);
+    }
+
+    // --- Expressions ---
+
+    auto Compiler::expression(const ast::Expression &expr) -> void {
+        if (m_error) {
+            return;
+        }
+        ast::visit(expr, [this](const auto &node) { expression(node); });
+    }
+
+    auto Compiler::expression(const ast::BinaryExpression &expr) -> void {
+        expression(*expr.left);
+        expression(*expr.right);
+
+        at(expr.operator_token);
+        switch (expr.operator_token.kind) {
+        case TokenKind::plus:
+            emit_op(OpCode::OP_ADD);
+            break;
+        case TokenKind::minus:
+            emit_op(OpCode::OP_SUBTRACT);
+            break;
+        case TokenKind::star:
+            emit_op(OpCode::OP_MULTIPLY);
+            break;
+        case TokenKind::slash:
+            emit_op(OpCode::OP_DIVIDE);
+            break;
+        case TokenKind::equal_equal:
+            emit_op(OpCode::OP_EQUAL);
+            break;
+        case TokenKind::bang_equal:
+            emit_op(OpCode::OP_EQUAL);
+            emit_op(OpCode::OP_NOT);
+            break;
+        case TokenKind::greater:
+            emit_op(OpCode::OP_GREATER);
+            break;
+        case TokenKind::greater_equal:
+            emit_op(OpCode::OP_LESS);
+            emit_op(OpCode::OP_NOT);
+            break;
+        case TokenKind::less:
+            emit_op(OpCode::OP_LESS);
+            break;
+        case TokenKind::less_equal:
+            emit_op(OpCode::OP_GREATER);
+            emit_op(OpCode::OP_NOT);
+            break;
+        default:
+            error(expr.operator_token, std::format("Unknown binary operator '{}'.", expr.operator_token.lexeme));
+            break;
+        }
+    }
+
+    auto Compiler::expression(const ast::UnaryExpression &expr) -> void {
+        expression(*expr.operand);
+
+        at(expr.operator_token);
+        switch (expr.operator_token.kind) {
+        case TokenKind::minus:
+            emit_op(OpCode::OP_NEGATE);
+            break;
+        case TokenKind::bang:
+            emit_op(OpCode::OP_NOT);
+            break;
+        default:
+            error(expr.operator_token, std::format("Unknown unary operator '{}'.", expr.operator_token.lexeme));
+            break;
+        }
+    }
+
+    auto Compiler::expression(const ast::GroupingExpression &expr) -> void { expression(*expr.expression); }
+
+    auto Compiler::expression(const ast::LiteralExpression &expr) -> void {
+        const auto &token = expr.value;
+        at(token);
+        switch (token.kind) {
+        case TokenKind::keyword_nil:
+            emit_op(OpCode::OP_NIL);
+            break;
+        case TokenKind::keyword_true:
+            emit_op(OpCode::OP_TRUE);
+            break;
+        case TokenKind::keyword_false:
+            emit_op(OpCode::OP_FALSE);
+            break;
+        case TokenKind::number_literal: {
+            double number = 0.0;
+            const auto *last = token.lexeme.data() + token.lexeme.size();
+            if (const auto [ptr, ec] = std::from_chars(token.lexeme.data(), last, number);
+                ec != std::errc{} || ptr != last) {
+                error(token, std::format("Invalid number literal '{}'.", token.lexeme));
+                return;
+            }
+            emit_constant(Value::number(number));
+        } break;
+        case TokenKind::string_literal:
+            emit_constant(Value::object(m_heap->intern(token.lexeme)));
+            break;
+        default:
+            error(token, std::format("Unexpected literal '{}'.", token.lexeme));
+            break;
+        }
+    }
+
+    auto Compiler::expression(const ast::VariableExpression &expr) -> void {
+        at(expr.name);
+        named_variable(expr.name, expr.binding, false);
+    }
+
+    auto Compiler::expression(const ast::AssignmentExpression &expr) -> void {
+        expression(*expr.value);
+        at(expr.name);
+        named_variable(expr.name, expr.binding, true);
+    }
+
+    auto Compiler::expression(const ast::LogicalExpression &expr) -> void {
+        expression(*expr.left);
+
+        at(expr.operator_token);
+        if (expr.operator_token.kind == TokenKind::keyword_and) {
+            // Leave a falsey left operand as the result; otherwise discard it and evaluate the right.
+            const auto end_jump = emit_jump(OpCode::OP_JUMP_IF_FALSE);
+            emit_op(OpCode::OP_POP);
+            expression(*expr.right);
+            patch_jump(end_jump);
+            return;
+        }
+
+        const auto else_jump = emit_jump(OpCode::OP_JUMP_IF_FALSE);
+        const auto end_jump = emit_jump(OpCode::OP_JUMP);
+        patch_jump(else_jump);
+        emit_op(OpCode::OP_POP);
+        expression(*expr.right);
+        patch_jump(end_jump);
+    }
+
+    auto Compiler::expression(const ast::CallExpression &expr) -> void {
+        expression(*expr.callee);
+        for (const auto *argument : expr.arguments) {
+            expression(*argument);
+        }
+
+        at(expr.paren);
+        if (expr.arguments.size() > std::numeric_limits<std::uint8_t>::max()) {
+            error(expr.paren, "Can't have more than 255 arguments.");
+            return;
+        }
+        emit_op(OpCode::OP_CALL, static_cast<std::uint8_t>(expr.arguments.size()));
+    }
+
+    // --- Functions and scopes ---
+
+    auto Compiler::function(const ast::FunctionDeclarationStatement &stmt) -> void {
+        FunctionState state{};
+        begin_function(state);
+        state.function->name = m_heap->intern(stmt.name.lexeme);
+        begin_scope();
+
+        // Arguments are already in the slots after the callee; the resolver numbered parameters the same way.
+        for (std::size_t i = 0; i < stmt.parameters.size(); ++i) {
+            declare_variable(false);
+        }
+        state.stack_depth += stmt.parameters.size();
+        state.chunk.note_stack_depth(state.stack_depth);
+        state.function->arity = static_cast<int>(stmt.parameters.size());
+        for (const auto &capture : stmt.upvalues) {
+            state.function->captures.push_back(UpvalueCapture{.index = capture.index, .is_local = capture.is_local});
+        }
+
+        for (const auto *body : stmt.body) {
+            statement(*body);
         }
 
-        const auto &program = result.value();
+        // No end_scope: returning closes the frame's upvalues and discards its slots wholesale.
+        auto *function = end_function();
+        at(stmt.name);
+        emit_indexed_op(OpCode::OP_CLOSURE, OpCode::OP_CLOSURE_LONG, make_constant(Value::object(function)));
+    }
+
+    auto Compiler::begin_function(FunctionState &state) -> void {
+        state.enclosing = m_state;
+        state.function = m_heap->new_function();
+        state.locals.reserve(UINT8_COUNT);
+        // Slot zero holds the callee itself.
+        state.locals.push_back(Local{.depth = 0, .captured = false});
+        m_state = &state;
+    }
+
+    auto Compiler::end_function() -> ObjFunction * {
+        emit_return();
+        auto *function = m_state->function;
+        function->chunk = peephole_optimize(m_state->chunk.finish());
 
-        for (const auto &stmt : program) {
-            fmt::println("Parsed statement: {}", stmt->to_string());
+#ifdef LOX_DEBUG_PRINT_CODE
+        if (!m_error) {
+            function->chunk.disassemble(function->name != nullptr ? function->name->chars : "<script>",
+                                        m_file != nullptr ? &m_file->lines() : nullptr);
         }
+#endif
 
-        return true;
+        m_state = m_state->enclosing;
+        return function;
+    }
+
+    auto Compiler::begin_scope() noexcept -> void { ++m_state->scope_depth; }
+
+    auto Compiler::end_scope() -> void {
+        --m_state->scope_depth;
+        auto &locals = m_state->locals;
+        while (!locals.empty() && locals.back().depth > m_state->scope_depth) {
+            emit_op(locals.back().captured ? OpCode::OP_CLOSE_UPVALUE : OpCode::OP_POP);
+            locals.pop_back();
+        }
+    }
+
+    auto Compiler::declare_variable(const bool captured) -> void {
+        if (m_state->scope_depth > 0) {
+            m_state->locals.push_back(Local{.depth = m_state->scope_depth, .captured = captured});
+        }
+    }
+
+    auto Compiler::define_variable(const syntax::Token &name) -> void {
+        if (m_state->scope_depth == 0) {
+            emit_indexed_op(OpCode::OP_DEFINE_GLOBAL, OpCode::OP_DEFINE_GLOBAL_LONG, global_slot(name));
+        }
+    }
+
+    auto Compiler::named_variable(const syntax::Token &name, const ast::Binding binding, const bool assign) -> void {
+        switch (binding.kind) {
+        case ast::Binding::Kind::local:
+            emit_op(assign ? OpCode::OP_SET_LOCAL : OpCode::OP_GET_LOCAL, binding.index);
+            return;
+        case ast::Binding::Kind::upvalue:
+            emit_op(assign ? OpCode::OP_SET_UPVALUE : OpCode::OP_GET_UPVALUE, binding.index);
+            return;
+        case ast::Binding::Kind::global:
+            break;
+        }
+
+        const auto index = global_slot(name);
+        if (assign) {
+            emit_indexed_op(OpCode::OP_SET_GLOBAL, OpCode::OP_SET_GLOBAL_LONG, index);
+        } else {
+            emit_indexed_op(OpCode::OP_GET_GLOBAL, OpCode::OP_GET_GLOBAL_LONG, index);
+        }
+    }
+
+    auto Compiler::global_slot(const syntax::Token &name) -> std::uint32_t {
+        const auto slot = m_globals->slot(m_heap->intern(name.lexeme));
+        if (slot > CONSTANT_LONG_MAX) {
+            error(name, "Too many global variables.");
+            return 0;
+        }
+        return slot;
+    }
+
+    // --- Emission ---
+
+    auto Compiler::emit_byte(const std::uint8_t byte) -> void { current_chunk().write(byte, m_offset); }
+
+    auto Compiler::emit_op(const OpCode op) -> void {
+        emit_byte(static_cast<std::uint8_t>(op));
+        track_stack(op);
+    }
+
+    auto Compiler::emit_op(const OpCode op, const std::uint8_t operand) -> void {
+        emit_byte(static_cast<std::uint8_t>(op));
+        emit_byte(operand);
+        track_stack(op, operand);
+    }
+
+    auto Compiler::track_stack(const OpCode op, const std::uint8_t operand) noexcept -> void {
+        const auto effect = stack_effect(op, operand);
+        auto &depth = m_state->stack_depth;
+        depth = depth - effect.pops + effect.pushes;
+        current_chunk().note_stack_depth(depth);
+    }
+
+    auto Compiler::emit_constant(const Value value) -> void {
+        emit_indexed_op(OpCode::OP_CONSTANT, OpCode::OP_CONSTANT_LONG, make_constant(value));
+    }
+
+    auto Compiler::emit_indexed_op(const OpCode op, const OpCode long_op, const std::uint32_t index) -> void {
+        if (index <= std::numeric_limits<std::uint8_t>::max()) {
+            emit_op(op, static_cast<std::uint8_t>(index));
+            return;
+        }
+        emit_op(long_op);
+        emit_byte(static_cast<std::uint8_t>((index >> 16U) & 0xffU));
+        emit_byte(static_cast<std::uint8_t>((index >> 8U) & 0xffU));
+        emit_byte(static_cast<std::uint8_t>(index & 0xffU));
+    }
+
+    auto Compiler::make_constant(const Value value) -> std::uint32_t {
+        const auto index = current_chunk().add_constant(value);
+        if (index > CONSTANT_LONG_MAX) {
+            error("Too many constants in one chunk.");
+            return 0;
+        }
+        return static_cast<std::uint32_t>(index);
+    }
+
+    auto Compiler::emit_jump(const OpCode op) -> std::size_t {
+        emit_op(op);
+        emit_byte(0xff);
+        emit_byte(0xff);
+        return current_chunk().size() - 2;
+    }
+
+    auto Compiler::patch_jump(const std::size_t offset) -> void {
+        // -2 to step over the jump's own operand.
+        const auto jump = current_chunk().size() - offset - 2;
+        if (jump > std::numeric_limits<std::uint16_t>::max()) {
+            error("Too much code to jump over.");
+            return;
+        }
+        current_chunk().patch(offset, static_cast<std::uint8_t>((jump >> 8U) & 0xffU));
+        current_chunk().patch(offset + 1, static_cast<std::uint8_t>(jump & 0xffU));
+    }
+
+    auto Compiler::emit_loop(const std::size_t loop_start) -> void {
+        emit_op(OpCode::OP_LOOP);
+
+        const auto offset = current_chunk().size() - loop_start + 2;
+        if (offset > std::numeric_limits<std::uint16_t>::max()) {
+            error("Loop body too large.");
+        }
+        emit_byte(static_cast<std::uint8_t>((offset >> 8U) & 0xffU));
+        emit_byte(static_cast<std::uint8_t>(offset & 0xffU));
+    }
+
+    auto Compiler::emit_return() -> void {
+        emit_op(OpCode::OP_NIL);
+        emit_op(OpCode::OP_RETURN);
+    }
+
+    // --- Errors ---
+
+    auto Compiler::error(const syntax::Token &token, const std::string_view message) -> void {
+        if (m_error) {
+            return;
+        }
+        if (m_file == nullptr) {
+            m_error = std::format("Compile error at '{}': {}", token.lexeme, message);
+            return;
+        }
+        m_error = std::format("{}: Compile error at '{}': {}", m_file->locate(token.span.start).to_string(),
+                              token.lexeme, message);
+    }
+
+    auto Compiler::error(const std::string_view message) -> void {
+        if (m_error) {
+            return;
+        }
+        if (m_file == nullptr) {
+            m_error = std::format("Compile error: {}", message);
+            return;
+        }
+        m_error = std::format("{}: Compile error: {}", m_file->locate(m_offset).to_string(), message);
+    }
+
+    auto Compiler::mark_roots(Heap &heap) const -> void {
+        for (const auto *state = m_state; state != nullptr; state = state->enclosing) {
+            heap.mark_object(state->function);
+            // Finished nested functions and interned literals are only in the builder until the chunk is frozen.
+            for (const auto constant : state->chunk.constants()) {
+                heap.mark_value(constant);
+            }
+        }
+        m_globals->mark(heap);
     }
 
 } // namespace lox::vm
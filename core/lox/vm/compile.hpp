@@ -1,20 +1,147 @@
 #ifndef LOX_VM_COMPILE_HPP
 #define LOX_VM_COMPILE_HPP
 
+#include "lox/ast/expr.hpp"
+#include "lox/ast/fold.hpp"
+#include "lox/ast/parse.hpp"
+#include "lox/ast/resolve.hpp"
+#include "lox/ast/stmt.hpp"
+#include "lox/syntax/source.hpp"
+#include "lox/syntax/token.hpp"
 #include "lox/vm/chunk.hpp"
+#include "lox/vm/common.hpp"
+#include "lox/vm/globals.hpp"
+#include "lox/vm/object.hpp"
 
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <optional>
+#include <string>
 #include <string_view>
+#include <vector>
 
 namespace lox::vm {
 
+    /**
+     * @brief Lowers a parsed program to bytecode in a single walk over the AST.
+     *
+     * The top-level script and every function declaration become an ObjFunction allocated on the heap the compiler
+     * was given. Before any code is emitted, ast::resolve binds each variable reference to a stack slot, an upvalue
+     * or a global, and ast::fold_constants folds constant expressions and dead branches away. Globals are numbered
+     * once here, so the VM addresses them by slot. Compilation stops at the first error.
+     *
+     * While compiling, the compiler is a root source for the heap: the functions still being built, the constants
+     * gathered for them and the global names are all kept alive. The finished script function is not, so the caller
+     * must root it before allocating again.
+     */
     class Compiler final {
     public:
-        explicit Compiler() = default;
+        /// Compiles into objects on @p heap, numbering global variables in @p globals.
+        Compiler(Heap &heap, Globals &globals) noexcept : m_heap(&heap), m_globals(&globals) {}
 
-        auto compile(std::string_view source, Chunk *chunk) noexcept -> bool;
+        Compiler(const Compiler &) = delete;
+        Compiler(Compiler &&) = delete;
+        auto operator=(const Compiler &) -> Compiler & = delete;
+        auto operator=(Compiler &&) -> Compiler & = delete;
+        ~Compiler() = default;
+
+        [[nodiscard]] auto compile(std::string_view source) noexcept -> std::expected<ObjFunction *, std::string>;
+        [[nodiscard]] auto compile(const syntax::SourceFile &file) noexcept
+            -> std::expected<ObjFunction *, std::string>;
+
+        /// What constant folding removed from the last program compiled.
+        [[nodiscard]] auto fold_stats() const noexcept -> const ast::FoldStats & { return m_fold_stats; }
 
     private:
-        std::string_view m_source;
+        friend class Heap;
+
+        /// A local occupying a stack slot; the resolver has already checked how it is used.
+        struct Local {
+            int depth;
+            /// Whether a closure captures it, so leaving its scope must close an upvalue instead of popping.
+            bool captured;
+        };
+
+        /// Per-function compilation state; nested function declarations push a new one.
+        struct FunctionState {
+            FunctionState *enclosing;
+            ObjFunction *function;
+            ChunkBuilder chunk;
+            std::vector<Local> locals;
+            int scope_depth = 0;
+            /// Values on the frame's stack after the code emitted so far, starting with the callee in slot zero.
+            std::size_t stack_depth = 1;
+        };
+
+        [[nodiscard]] auto compile(ast::Parser &parser) noexcept -> std::expected<ObjFunction *, std::string>;
+
+        auto statement(const ast::Statement &stmt) -> void;
+        auto statement(const ast::ExpressionStatement &stmt) -> void;
+        auto statement(const ast::PrintStatement &stmt) -> void;
+        auto statement(const ast::VarStatement &stmt) -> void;
+        auto statement(const ast::BlockStatement &stmt) -> void;
+        auto statement(const ast::IfStatement &stmt) -> void;
+        auto statement(const ast::WhileStatement &stmt) -> void;
+        auto statement(const ast::ForStatement &stmt) -> void;
+        auto statement(const ast::ReturnStatement &stmt) -> void;
+        auto statement(const ast::FunctionDeclarationStatement &stmt) -> void;
+
+        auto expression(const ast::Expression &expr) -> void;
+        auto expression(const ast::BinaryExpression &expr) -> void;
+        auto expression(const ast::UnaryExpression &expr) -> void;
+        auto expression(const ast::GroupingExpression &expr) -> void;
+        auto expression(const ast::LiteralExpression &expr) -> void;
+        auto expression(const ast::VariableExpression &expr) -> void;
+        auto expression(const ast::AssignmentExpression &expr) -> void;
+        auto expression(const ast::LogicalExpression &expr) -> void;
+        auto expression(const ast::CallExpression &expr) -> void;
+
+        auto function(const ast::FunctionDeclarationStatement &stmt) -> void;
+        /// Starts compiling a new function into @p state; it is reachable from the compiler's roots from here on.
+        auto begin_function(FunctionState &state) -> void;
+        auto end_function() -> ObjFunction *;
+
+        auto begin_scope() noexcept -> void;
+        auto end_scope() -> void;
+
+        /// Claims the next stack slot for a local; at the top level the variable is a global and needs none.
+        auto declare_variable(bool captured) -> void;
+        auto define_variable(const syntax::Token &name) -> void;
+        auto named_variable(const syntax::Token &name, ast::Binding binding, bool assign) -> void;
+        [[nodiscard]] auto global_slot(const syntax::Token &name) -> std::uint32_t;
+
+        [[nodiscard]] auto current_chunk() noexcept -> ChunkBuilder & { return m_state->chunk; }
+        auto at(const syntax::Token &token) noexcept -> void { m_offset = token.span.start; }
+
+        auto emit_byte(std::uint8_t byte) -> void;
+        auto emit_op(OpCode op) -> void;
+        auto emit_op(OpCode op, std::uint8_t operand) -> void;
+        /// Applies @p op's stack effect to the current function's depth and raises the chunk's max_stack to it.
+        auto track_stack(OpCode op, std::uint8_t operand = 0) noexcept -> void;
+        auto emit_constant(Value value) -> void;
+        /// Emits @p op with a one-byte @p index, or @p long_op with a three-byte one when the index does not fit.
+        auto emit_indexed_op(OpCode op, OpCode long_op, std::uint32_t index) -> void;
+        [[nodiscard]] auto make_constant(Value value) -> std::uint32_t;
+        [[nodiscard]] auto emit_jump(OpCode op) -> std::size_t;
+        auto patch_jump(std::size_t offset) -> void;
+        auto emit_loop(std::size_t loop_start) -> void;
+        auto emit_return() -> void;
+
+        /// Records @p message as the compile error, located at @p token; only the first error is kept.
+        auto error(const syntax::Token &token, std::string_view message) -> void;
+        auto error(std::string_view message) -> void;
+
+        auto mark_roots(Heap &heap) const -> void;
+
+        Heap *m_heap;
+        Globals *m_globals;
+        FunctionState *m_state = nullptr;
+        const syntax::SourceFile *m_file = nullptr;
+        /// Source offset of the node being compiled, recorded against each emitted byte.
+        std::size_t m_offset = 0;
+        std::optional<std::string> m_error;
+        ast::FoldStats m_fold_stats;
     };
 
 } // namespace lox::vm
@@ -0,0 +1,28 @@
+#include "lox/vm/globals.hpp"
+
+#include "lox/vm/object.hpp"
+#include "lox/vm/value.hpp"
+
+#include <cstdint>
+
+namespace lox::vm {
+
+    auto Globals::slot(ObjString *const name) -> std::uint32_t {
+        const auto [entry, inserted] = m_slots.try_emplace(name, static_cast<std::uint32_t>(m_values.size()));
+        if (inserted) {
+            m_names.push_back(name);
+            m_values.push_back(Value::undefined());
+        }
+        return entry->second;
+    }
+
+    auto Globals::mark(Heap &heap) const -> void {
+        for (auto *const name : m_names) {
+            heap.mark_object(name);
+        }
+        for (const auto value : m_values) {
+            heap.mark_value(value);
+        }
+    }
+
+} // namespace lox::vm
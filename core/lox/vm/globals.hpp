@@ -0,0 +1,43 @@
+#ifndef LOX_VM_GLOBALS_HPP
+#define LOX_VM_GLOBALS_HPP
+
+#include "lox/vm/object.hpp"
+#include "lox/vm/value.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace lox::vm {
+
+    /**
+     * @brief The global variables of one VM, stored densely and addressed by slot index.
+     *
+     * The compiler turns each global name into a slot once, so OP_GET_GLOBAL and OP_SET_GLOBAL index an array instead
+     * of hashing the name on every access. A slot exists from the first time any code mentions its name, which may
+     * be before the variable is defined or in code that never defines it; until then it holds Value::undefined(), and
+     * the VM reports accesses to it as undefined variables. Slots are never removed, so code compiled earlier stays
+     * valid for later scripts run on the same VM.
+     */
+    class Globals final {
+    public:
+        /// Returns the slot for @p name, adding an undefined one the first time the name is seen.
+        [[nodiscard]] auto slot(ObjString *name) -> std::uint32_t;
+
+        [[nodiscard]] auto operator[](const std::uint32_t slot) noexcept -> Value & { return m_values[slot]; }
+        [[nodiscard]] auto name(const std::uint32_t slot) const noexcept -> ObjString * { return m_names[slot]; }
+        [[nodiscard]] auto size() const noexcept -> std::size_t { return m_values.size(); }
+
+        /// Marks every global's name and value for @p heap's collector.
+        auto mark(Heap &heap) const -> void;
+
+    private:
+        std::unordered_map<ObjString *, std::uint32_t> m_slots;
+        std::vector<ObjString *> m_names;
+        std::vector<Value> m_values;
+    };
+
+} // namespace lox::vm
+
+#endif
@@ -0,0 +1,183 @@
+#include "lox/vm/object.hpp"
+
+#include "lox/support/trace.hpp"
+#include "lox/vm/value.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace lox::vm {
+
+    namespace {
+
+        /// What an object counts for in HeapStats; the same whenever it is asked, so freeing gives back exactly what
+        /// allocating took.
+        auto object_size(const Obj &object) noexcept -> std::size_t {
+            switch (object.type) {
+            case ObjType::string:
+                return sizeof(ObjString) + static_cast<const ObjString &>(object).chars.capacity();
+            case ObjType::function:
+                return sizeof(ObjFunction);
+            case ObjType::native:
+                return sizeof(ObjNative);
+            case ObjType::closure:
+                return sizeof(ObjClosure) + static_cast<const ObjClosure &>(object).upvalues.size() * sizeof(Obj *);
+            case ObjType::upvalue:
+                return sizeof(ObjUpvalue);
+            }
+            return sizeof(Obj);
+        }
+
+        auto free_object(Obj *const object) noexcept -> void {
+            switch (object->type) {
+            case ObjType::string:
+                delete static_cast<ObjString *>(object);
+                break;
+            case ObjType::function:
+                delete static_cast<ObjFunction *>(object);
+                break;
+            case ObjType::native:
+                delete static_cast<ObjNative *>(object);
+                break;
+            case ObjType::closure:
+                delete static_cast<ObjClosure *>(object);
+                break;
+            case ObjType::upvalue:
+                delete static_cast<ObjUpvalue *>(object);
+                break;
+            }
+        }
+
+    } // namespace
+
+    Heap::~Heap() {
+        for (auto *object = m_objects; object != nullptr;) {
+            auto *const next = object->next;
+            free_object(object);
+            object = next;
+        }
+    }
+
+    template <typename T, typename... Args> auto Heap::allocate(Args &&...args) -> T * {
+        if (m_settings.stress || m_stats.bytes_allocated > m_next_gc) {
+            collect();
+        }
+
+        auto *const object = new T(std::forward<Args>(args)...);
+        object->next = m_objects;
+        m_objects = object;
+        m_stats.bytes_allocated += object_size(*object);
+        m_stats.peak_bytes = std::max(m_stats.peak_bytes, m_stats.bytes_allocated);
+        return object;
+    }
+
+    auto Heap::intern(const std::string_view chars) -> ObjString * {
+        if (const auto existing = m_strings.find(chars); existing != m_strings.end()) {
+            return existing->second;
+        }
+        auto *const string = allocate<ObjString>(std::string{chars});
+        m_strings.emplace(string->chars, string);
+        return string;
+    }
+
+    auto Heap::intern(std::string &&chars) -> ObjString * {
+        if (const auto existing = m_strings.find(chars); existing != m_strings.end()) {
+            return existing->second;
+        }
+        auto *const string = allocate<ObjString>(std::move(chars));
+        m_strings.emplace(string->chars, string);
+        return string;
+    }
+
+    auto Heap::new_function() -> ObjFunction * { return allocate<ObjFunction>(); }
+
+    auto Heap::new_native(const NativeFn function, const int arity) -> ObjNative * {
+        return allocate<ObjNative>(function, arity);
+    }
+
+    auto Heap::new_closure(ObjFunction *const function) -> ObjClosure * { return allocate<ObjClosure>(function); }
+
+    auto Heap::new_upvalue(const std::size_t slot) -> ObjUpvalue * { return allocate<ObjUpvalue>(slot); }
+
+    auto Heap::remove_roots(const void *const owner) noexcept -> void {
+        std::erase_if(m_root_sources, [owner](const RootSource &source) { return source.owner == owner; });
+    }
+
+    auto Heap::mark_object(Obj *const object) -> void {
+        if (object == nullptr || object->is_marked) {
+            return;
+        }
+        object->is_marked = true;
+        m_gray.push_back(object);
+    }
+
+    auto Heap::collect() -> void {
+        const auto before = m_stats.bytes_allocated;
+
+        for (const auto &source : m_root_sources) {
+            source.mark(source.owner, *this);
+        }
+        while (!m_gray.empty()) {
+            auto *const object = m_gray.back();
+            m_gray.pop_back();
+            blacken(object);
+        }
+        // The intern table only refers to strings something else keeps alive.
+        std::erase_if(m_strings, [](const auto &entry) { return !entry.second->is_marked; });
+        sweep();
+
+        const auto next = static_cast<double>(m_stats.bytes_allocated) * m_settings.growth_factor;
+        m_next_gc = std::max(static_cast<std::size_t>(next), m_settings.min_threshold);
+        ++m_stats.collections;
+        LOX_DEBUG("Heap: Collected {} bytes, {} remain, next collection at {}", before - m_stats.bytes_allocated,
+                  m_stats.bytes_allocated, m_next_gc);
+    }
+
+    auto Heap::blacken(Obj *const object) -> void {
+        switch (object->type) {
+        case ObjType::string:
+        case ObjType::native:
+            break;
+        case ObjType::function: {
+            const auto *const function = static_cast<ObjFunction *>(object);
+            mark_object(function->name);
+            for (const auto constant : function->chunk.constants()) {
+                mark_value(constant);
+            }
+            break;
+        }
+        case ObjType::closure: {
+            const auto *const closure = static_cast<ObjClosure *>(object);
+            mark_object(closure->function);
+            // Upvalues not yet filled in by OP_CLOSURE are null, which mark_object skips.
+            for (auto *const upvalue : closure->upvalues) {
+                mark_object(upvalue);
+            }
+            break;
+        }
+        case ObjType::upvalue:
+            // An open upvalue's variable is on the stack, which the VM marks; a closed one's lives here.
+            mark_value(static_cast<ObjUpvalue *>(object)->closed);
+            break;
+        }
+    }
+
+    auto Heap::sweep() noexcept -> void {
+        Obj **link = &m_objects;
+        while (*link != nullptr) {
+            auto *const object = *link;
+            if (object->is_marked) {
+                object->is_marked = false;
+                link = &object->next;
+                continue;
+            }
+            *link = object->next;
+            m_stats.bytes_allocated -= object_size(*object);
+            free_object(object);
+        }
+    }
+
+} // namespace lox::vm
@@ -0,0 +1,219 @@
+#ifndef LOX_VM_OBJECT_HPP
+#define LOX_VM_OBJECT_HPP
+
+#include "lox/vm/chunk.hpp"
+#include "lox/vm/value.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/// Define LOX_DEBUG_STRESS_GC=1 to make every heap collect before each allocation by default.
+#ifndef LOX_DEBUG_STRESS_GC
+#define LOX_DEBUG_STRESS_GC 0
+#endif
+
+namespace lox::vm {
+
+    enum class ObjType : std::uint8_t { string, function, native, closure, upvalue };
+
+    /// The header shared by every heap object. Objects are chained through @c next so the heap can sweep them.
+    struct Obj {
+        ObjType type;
+        /// Set while the collector has found the object reachable; clear between collections.
+        bool is_marked = false;
+        Obj *next = nullptr;
+
+        explicit Obj(const ObjType t) noexcept : type(t) {}
+        Obj(const Obj &) = delete;
+        Obj(Obj &&) = delete;
+        auto operator=(const Obj &) -> Obj & = delete;
+        auto operator=(Obj &&) -> Obj & = delete;
+
+    protected:
+        ~Obj() = default;
+    };
+
+    /// An immutable, interned string.
+    struct ObjString final : Obj {
+        std::string chars;
+
+        explicit ObjString(std::string s) noexcept : Obj(ObjType::string), chars(std::move(s)) {}
+    };
+
+    /// Where OP_CLOSURE finds one of a new closure's upvalues: a local slot of the enclosing frame, or one of the
+    /// enclosing closure's own upvalues.
+    struct UpvalueCapture {
+        std::uint8_t index;
+        bool is_local;
+    };
+
+    /// A compiled function: its bytecode, arity and name (null for the top-level script).
+    struct ObjFunction final : Obj {
+        int arity = 0;
+        Chunk chunk;
+        ObjString *name = nullptr;
+        /// The variables each closure over this function captures, in upvalue index order.
+        std::vector<UpvalueCapture> captures;
+
+        ObjFunction() noexcept : Obj(ObjType::function) {}
+    };
+
+    using NativeFn = auto (*)(std::span<const Value> arguments) noexcept -> Value;
+
+    /// A function implemented in C++.
+    struct ObjNative final : Obj {
+        NativeFn function;
+        int arity;
+
+        ObjNative(const NativeFn fn, const int a) noexcept : Obj(ObjType::native), function(fn), arity(a) {}
+    };
+
+    /**
+     * @brief A variable captured by a closure.
+     *
+     * While the variable's frame is live the upvalue is open and refers to its stack slot; the VM keeps open upvalues
+     * in a list so that closures capturing the same slot share one upvalue. When the slot goes out of scope the value
+     * is copied into @c closed.
+     */
+    struct ObjUpvalue final : Obj {
+        /// The captured slot, as an index into the VM stack, while the upvalue is open.
+        std::size_t slot;
+        Value closed;
+        bool is_closed = false;
+        /// The next open upvalue, ordered by decreasing slot.
+        ObjUpvalue *next_open = nullptr;
+
+        explicit ObjUpvalue(const std::size_t s) noexcept : Obj(ObjType::upvalue), slot(s) {}
+    };
+
+    /// A function together with the variables it captured when it was created. The VM only ever calls closures.
+    struct ObjClosure final : Obj {
+        ObjFunction *function;
+        std::vector<ObjUpvalue *> upvalues;
+
+        explicit ObjClosure(ObjFunction *f) : Obj(ObjType::closure), function(f), upvalues(f->captures.size()) {}
+    };
+
+    [[nodiscard]] inline auto is_obj_type(const Value &value, const ObjType type) noexcept -> bool {
+        return value.is_object() && value.as_object()->type == type;
+    }
+
+    [[nodiscard]] inline auto is_string(const Value &value) noexcept -> bool {
+        return is_obj_type(value, ObjType::string);
+    }
+
+    [[nodiscard]] inline auto as_string(const Value &value) noexcept -> ObjString * {
+        return static_cast<ObjString *>(value.as_object());
+    }
+
+    /// Tuning for the Heap's collector.
+    struct GcSettings {
+        /// After a collection, the next one waits until the heap has grown to this multiple of what survived.
+        double growth_factor = 2.0;
+        /// The heap size the first collection waits for, and the least any later one waits for.
+        std::size_t min_threshold = std::size_t{1} << 20U;
+        /// Collect before every allocation, so an object the collector cannot reach from a root is freed at once
+        /// instead of whenever the threshold happens to be crossed. Very slow; for tests and debugging.
+        bool stress = LOX_DEBUG_STRESS_GC != 0;
+    };
+
+    /// What the Heap's collector has done so far.
+    struct HeapStats {
+        /// The approximate size of every live object: its header and, for strings, the characters.
+        std::size_t bytes_allocated = 0;
+        std::size_t peak_bytes = 0;
+        std::size_t collections = 0;
+    };
+
+    /**
+     * @brief Allocates and owns every object created by the compiler and the VM, and frees those no longer reachable.
+     *
+     * Strings are interned: equal contents always yield the same ObjString, so strings compare by pointer.
+     *
+     * Collection is tracing mark-sweep. Whatever holds objects the heap cannot see into, the compiler and the VM,
+     * registers with add_roots() and marks them when asked; marked objects go on a gray worklist, and the collector
+     * pops them one at a time to mark what they refer to until the list is empty. Every object still unmarked is then
+     * freed, and dropped from the intern table first, which does not keep strings alive by itself.
+     *
+     * A collection runs before an allocation once the heap has grown past a threshold set after the previous one; see
+     * GcSettings. The object being allocated does not exist yet, but anything passed to its constructor must already
+     * be reachable from a root, and so must anything the caller still needs once the allocation returns.
+     */
+    class Heap final {
+    public:
+        explicit Heap(GcSettings settings = {}) noexcept
+            : m_settings(settings), m_next_gc(settings.min_threshold) {}
+
+        Heap(const Heap &) = delete;
+        Heap(Heap &&) = delete;
+        auto operator=(const Heap &) -> Heap & = delete;
+        auto operator=(Heap &&) -> Heap & = delete;
+
+        ~Heap();
+
+        /// Returns the interned string equal to @p chars, creating it if needed.
+        auto intern(std::string_view chars) -> ObjString *;
+        /// Like intern, but takes ownership of @p chars when the string is new.
+        auto intern(std::string &&chars) -> ObjString *;
+
+        auto new_function() -> ObjFunction *;
+        auto new_native(NativeFn function, int arity) -> ObjNative *;
+        auto new_closure(ObjFunction *function) -> ObjClosure *;
+        auto new_upvalue(std::size_t slot) -> ObjUpvalue *;
+
+        /**
+         * Registers @p owner as a source of roots until remove_roots(): each collection calls its
+         * `mark_roots(Heap &) const`, which must mark every object the owner refers to with mark_object() or
+         * mark_value().
+         */
+        template <typename T> auto add_roots(const T &owner) -> void {
+            m_root_sources.push_back(RootSource{
+                .owner = &owner,
+                .mark = [](const void *source, Heap &heap) { static_cast<const T *>(source)->mark_roots(heap); },
+            });
+        }
+        auto remove_roots(const void *owner) noexcept -> void;
+
+        auto mark_object(Obj *object) -> void;
+        auto mark_value(const Value value) -> void {
+            if (value.is_object()) {
+                mark_object(value.as_object());
+            }
+        }
+
+        /// Frees every object not reachable from a registered root.
+        auto collect() -> void;
+
+        [[nodiscard]] auto stats() const noexcept -> const HeapStats & { return m_stats; }
+
+    private:
+        struct RootSource {
+            const void *owner;
+            void (*mark)(const void *owner, Heap &heap);
+        };
+
+        /// Constructs a T, collecting first if the heap has reached its threshold, and links it into the heap.
+        template <typename T, typename... Args> auto allocate(Args &&...args) -> T *;
+        /// Marks everything @p object refers to.
+        auto blacken(Obj *object) -> void;
+        auto sweep() noexcept -> void;
+
+        GcSettings m_settings;
+        HeapStats m_stats;
+        std::size_t m_next_gc;
+        Obj *m_objects = nullptr;
+        /// Objects marked but not yet blackened.
+        std::vector<Obj *> m_gray;
+        std::vector<RootSource> m_root_sources;
+        // Keys view the chars of the string they map to, which never move once allocated.
+        std::unordered_map<std::string_view, ObjString *> m_strings;
+    };
+
+} // namespace lox::vm
+
+#endif
@@ -0,0 +1,304 @@
+#include "lox/vm/optimize.hpp"
+
+#include "lox/vm/chunk.hpp"
+#include "lox/vm/common.hpp"
+#include "lox/vm/value.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace lox::vm {
+
+    namespace {
+
+        constexpr auto no_target = std::numeric_limits<std::size_t>::max();
+
+        struct Instruction {
+            OpCode op;
+            std::array<std::uint8_t, 3> operands{};
+            std::size_t source_offset = 0;
+            /// For jumps, the index of the instruction jumped to; instructions.size() means the end of the code.
+            std::size_t target = no_target;
+            bool is_target = false;
+            bool removed = false;
+        };
+
+        [[nodiscard]] constexpr auto is_jump(const OpCode op) noexcept -> bool {
+            return is_forward_jump(op) || op == OpCode::OP_LOOP;
+        }
+
+        /// Instructions that only push a value and can neither fail nor have side effects.
+        [[nodiscard]] constexpr auto is_pure_push(const OpCode op) noexcept -> bool {
+            switch (op) {
+            case OpCode::OP_CONSTANT:
+            case OpCode::OP_CONSTANT_LONG:
+            case OpCode::OP_NIL:
+            case OpCode::OP_TRUE:
+            case OpCode::OP_FALSE:
+            case OpCode::OP_GET_LOCAL:
+            case OpCode::OP_GET_UPVALUE:
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        [[nodiscard]] constexpr auto fused_locals(const OpCode op) noexcept -> OpCode {
+            switch (op) {
+            case OpCode::OP_ADD:
+                return OpCode::OP_ADD_LOCALS;
+            case OpCode::OP_SUBTRACT:
+                return OpCode::OP_SUBTRACT_LOCALS;
+            case OpCode::OP_MULTIPLY:
+                return OpCode::OP_MULTIPLY_LOCALS;
+            case OpCode::OP_DIVIDE:
+                return OpCode::OP_DIVIDE_LOCALS;
+            default:
+                return op;
+            }
+        }
+
+        [[nodiscard]] constexpr auto fused_compare_jump(const OpCode op) noexcept -> OpCode {
+            switch (op) {
+            case OpCode::OP_EQUAL:
+                return OpCode::OP_EQUAL_JUMP_IF_FALSE;
+            case OpCode::OP_GREATER:
+                return OpCode::OP_GREATER_JUMP_IF_FALSE;
+            case OpCode::OP_LESS:
+                return OpCode::OP_LESS_JUMP_IF_FALSE;
+            default:
+                return op;
+            }
+        }
+
+        [[nodiscard]] auto constant_index(const Instruction &instruction) noexcept -> std::size_t {
+            if (instruction.op == OpCode::OP_CONSTANT) {
+                return instruction.operands[0];
+            }
+            return static_cast<std::size_t>(instruction.operands[0]) << 16U |
+                   static_cast<std::size_t>(instruction.operands[1]) << 8U | instruction.operands[2];
+        }
+
+        /// Whether the constant operand of @p instruction can hold @p index without growing the instruction.
+        [[nodiscard]] auto fits_constant(const Instruction &instruction, const std::size_t index) noexcept -> bool {
+            if (instruction.op == OpCode::OP_CONSTANT) {
+                return index <= std::numeric_limits<std::uint8_t>::max();
+            }
+            return index <= CONSTANT_LONG_MAX;
+        }
+
+        /// Points @p instruction at constant @p index in the same form; fits_constant must hold.
+        auto set_constant(Instruction &instruction, const std::size_t index) noexcept -> void {
+            if (instruction.op == OpCode::OP_CONSTANT) {
+                instruction.operands[0] = static_cast<std::uint8_t>(index);
+                return;
+            }
+            instruction.operands = {static_cast<std::uint8_t>((index >> 16U) & 0xffU),
+                                    static_cast<std::uint8_t>((index >> 8U) & 0xffU),
+                                    static_cast<std::uint8_t>(index & 0xffU)};
+        }
+
+        auto decode(const Chunk &chunk) -> std::vector<Instruction> {
+            const auto code = chunk.code();
+            std::vector<Instruction> instructions;
+            std::vector<std::size_t> index_at(code.size() + 1, no_target);
+            std::vector<std::size_t> offsets;
+
+            for (std::size_t offset = 0; offset < code.size();) {
+                Instruction instruction{.op = static_cast<OpCode>(code[offset])};
+                instruction.source_offset = chunk.source_map().source_offset(offset);
+                const auto operands = operand_bytes(instruction.op);
+                for (std::size_t i = 0; i < operands; ++i) {
+                    instruction.operands[i] = code[offset + 1 + i];
+                }
+
+                index_at[offset] = instructions.size();
+                offsets.push_back(offset);
+                instructions.push_back(instruction);
+                offset += 1 + operands;
+            }
+            index_at[code.size()] = instructions.size();
+
+            for (std::size_t i = 0; i < instructions.size(); ++i) {
+                auto &instruction = instructions[i];
+                if (!is_jump(instruction.op)) {
+                    continue;
+                }
+                const auto distance = static_cast<std::size_t>(instruction.operands[0]) << 8U | instruction.operands[1];
+                const auto after = offsets[i] + 3;
+                instruction.target = index_at[instruction.op == OpCode::OP_LOOP ? after - distance : after + distance];
+                if (instruction.target < instructions.size()) {
+                    instructions[instruction.target].is_target = true;
+                }
+            }
+            return instructions;
+        }
+
+        class Rewriter {
+        public:
+            Rewriter(std::vector<Instruction> &instructions, ChunkBuilder &builder, PeepholeStats &stats) noexcept
+                : m_instructions(instructions), m_builder(builder), m_stats(stats) {}
+
+            /// Applies every rule once at each position; returns whether anything changed.
+            auto pass() -> bool {
+                bool changed = false;
+                for (std::size_t i = 0; i < m_instructions.size(); ++i) {
+                    if (!m_instructions[i].removed) {
+                        changed |= rewrite_at(i);
+                    }
+                }
+                return changed;
+            }
+
+        private:
+            [[nodiscard]] auto next_live(std::size_t i) const noexcept -> std::size_t {
+                do {
+                    ++i;
+                } while (i < m_instructions.size() && m_instructions[i].removed);
+                return i;
+            }
+
+            /// The live instruction after @p i if no jump lands on it, so that it can be fused into @p i.
+            [[nodiscard]] auto fusable_after(const std::size_t i) noexcept -> Instruction * {
+                const auto j = next_live(i);
+                if (j >= m_instructions.size() || m_instructions[j].is_target) {
+                    return nullptr;
+                }
+                return &m_instructions[j];
+            }
+
+            auto rewrite_at(const std::size_t i) -> bool {
+                auto &first = m_instructions[i];
+                auto *second = fusable_after(i);
+                if (second == nullptr) {
+                    return false;
+                }
+
+                if ((first.op == OpCode::OP_CONSTANT || first.op == OpCode::OP_CONSTANT_LONG) &&
+                    second->op == OpCode::OP_NEGATE) {
+                    // Read through the builder: an earlier fold may have added this constant.
+                    const auto value = m_builder.constant(constant_index(first));
+                    // A negated value not yet in the pool goes at the end. Only fold if that index still fits the
+                    // instruction: growing OP_CONSTANT into OP_CONSTANT_LONG could push a jump out of range.
+                    if (!value.is_number() || !fits_constant(first, m_builder.constants().size())) {
+                        return false;
+                    }
+                    set_constant(first, m_builder.add_constant(Value::number(-value.as_number())));
+                    second->removed = true;
+                    ++m_stats.folded_negations;
+                    return true;
+                }
+
+                if (is_pure_push(first.op) && second->op == OpCode::OP_POP) {
+                    first.removed = true;
+                    second->removed = true;
+                    // Jumps to first now land on whatever follows the pair, which must not be fused backwards.
+                    if (const auto next = next_live(i); first.is_target && next < m_instructions.size()) {
+                        m_instructions[next].is_target = true;
+                    }
+                    ++m_stats.removed_push_pops;
+                    return true;
+                }
+
+                if (first.op == OpCode::OP_CONSTANT &&
+                    (second->op == OpCode::OP_ADD || second->op == OpCode::OP_SUBTRACT)) {
+                    first.op = second->op == OpCode::OP_ADD ? OpCode::OP_ADD_CONSTANT : OpCode::OP_SUBTRACT_CONSTANT;
+                    first.source_offset = second->source_offset;
+                    second->removed = true;
+                    ++m_stats.superinstructions;
+                    return true;
+                }
+
+                if (fused_compare_jump(first.op) != first.op && second->op == OpCode::OP_JUMP_IF_FALSE) {
+                    // The comparison is the part that can fail, so first keeps its own source offset.
+                    first.op = fused_compare_jump(first.op);
+                    first.target = second->target;
+                    second->removed = true;
+                    ++m_stats.superinstructions;
+                    return true;
+                }
+
+                if (first.op == OpCode::OP_GET_LOCAL && second->op == OpCode::OP_GET_LOCAL) {
+                    auto *third = fusable_after(next_live(i));
+                    if (third == nullptr || fused_locals(third->op) == third->op) {
+                        return false;
+                    }
+                    first.op = fused_locals(third->op);
+                    first.operands[1] = second->operands[0];
+                    first.source_offset = third->source_offset;
+                    second->removed = true;
+                    third->removed = true;
+                    ++m_stats.superinstructions;
+                    return true;
+                }
+
+                return false;
+            }
+
+            std::vector<Instruction> &m_instructions;
+            ChunkBuilder &m_builder;
+            PeepholeStats &m_stats;
+        };
+
+        auto encode(const std::vector<Instruction> &instructions, ChunkBuilder &builder) -> void {
+            // New offsets, with new_offsets[i] for a removed instruction being that of the next live one.
+            std::vector<std::size_t> new_offsets(instructions.size() + 1);
+            std::size_t offset = 0;
+            for (std::size_t i = 0; i < instructions.size(); ++i) {
+                new_offsets[i] = offset;
+                if (!instructions[i].removed) {
+                    offset += 1 + operand_bytes(instructions[i].op);
+                }
+            }
+            new_offsets[instructions.size()] = offset;
+
+            for (std::size_t i = 0; i < instructions.size(); ++i) {
+                const auto &instruction = instructions[i];
+                if (instruction.removed) {
+                    continue;
+                }
+                builder.write(static_cast<std::uint8_t>(instruction.op), instruction.source_offset);
+
+                if (is_jump(instruction.op)) {
+                    // No rewrite grows an instruction, so jumps only get shorter and the distance still fits in
+                    // two bytes.
+                    const auto after = new_offsets[i] + 3;
+                    const auto target = new_offsets[instruction.target];
+                    const auto distance = instruction.op == OpCode::OP_LOOP ? after - target : target - after;
+                    builder.write(static_cast<std::uint8_t>((distance >> 8U) & 0xffU), instruction.source_offset);
+                    builder.write(static_cast<std::uint8_t>(distance & 0xffU), instruction.source_offset);
+                    continue;
+                }
+                for (std::size_t j = 0; j < operand_bytes(instruction.op); ++j) {
+                    builder.write(instruction.operands[j], instruction.source_offset);
+                }
+            }
+        }
+
+    } // namespace
+
+    auto peephole_optimize(const Chunk &chunk, PeepholeStats *stats) -> Chunk {
+        PeepholeStats local_stats;
+        auto &counts = stats != nullptr ? *stats : local_stats;
+
+        ChunkBuilder builder;
+        // No rewrite makes a frame deeper, so the original bound still holds.
+        builder.note_stack_depth(chunk.max_stack());
+        // The pool is already deduplicated, so re-adding it in order keeps every index.
+        for (const auto &constant : chunk.constants()) {
+            static_cast<void>(builder.add_constant(constant));
+        }
+
+        auto instructions = decode(chunk);
+        Rewriter rewriter{instructions, builder, counts};
+        while (rewriter.pass()) {
+        }
+
+        encode(instructions, builder);
+        return builder.finish();
+    }
+
+} // namespace lox::vm
@@ -0,0 +1,35 @@
+#ifndef LOX_VM_OPTIMIZE_HPP
+#define LOX_VM_OPTIMIZE_HPP
+
+#include "lox/vm/chunk.hpp"
+
+#include <cstddef>
+
+namespace lox::vm {
+
+    /// What a peephole pass changed, for tests and diagnostics.
+    struct PeepholeStats {
+        std::size_t superinstructions = 0;
+        std::size_t folded_negations = 0;
+        std::size_t removed_push_pops = 0;
+    };
+
+    /**
+     * @brief Rewrites @p chunk with common instruction sequences fused and dead pushes removed.
+     *
+     * The pass decodes the chunk into instructions, resolves jump targets, and rewrites until nothing changes:
+     *   - OP_CONSTANT k, OP_ADD / OP_SUBTRACT             -> OP_ADD_CONSTANT / OP_SUBTRACT_CONSTANT k
+     *   - OP_GET_LOCAL a, OP_GET_LOCAL b, arithmetic      -> OP_<arithmetic>_LOCALS a b
+     *   - OP_EQUAL / OP_GREATER / OP_LESS, OP_JUMP_IF_FALSE -> OP_<compare>_JUMP_IF_FALSE
+     *   - OP_CONSTANT of a number, OP_NEGATE              -> OP_CONSTANT of the negated number
+     *   - a side-effect-free push followed by OP_POP      -> nothing
+     *
+     * A sequence is only fused when no jump lands inside it. Jumps are re-encoded against the new layout, and each
+     * fused instruction keeps the source offset of the component that can fail, so runtime errors still point at
+     * the operator.
+     */
+    [[nodiscard]] auto peephole_optimize(const Chunk &chunk, PeepholeStats *stats = nullptr) -> Chunk;
+
+} // namespace lox::vm
+
+#endif
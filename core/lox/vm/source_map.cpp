@@ -0,0 +1,97 @@
+#include "lox/vm/source_map.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+namespace lox::vm {
+
+    namespace {
+
+        auto write_varint(std::vector<std::uint8_t> &out, std::uint64_t value) -> void {
+            while (value >= 0x80U) {
+                out.push_back(static_cast<std::uint8_t>(value | 0x80U));
+                value >>= 7U;
+            }
+            out.push_back(static_cast<std::uint8_t>(value));
+        }
+
+        auto read_varint(const std::uint8_t *&cursor) noexcept -> std::uint64_t {
+            std::uint64_t value = 0;
+            for (unsigned shift = 0;; shift += 7) {
+                const auto byte = *cursor++;
+                value |= static_cast<std::uint64_t>(byte & 0x7fU) << shift;
+                if ((byte & 0x80U) == 0) {
+                    return value;
+                }
+            }
+        }
+
+        constexpr auto zigzag_encode(const std::int64_t value) noexcept -> std::uint64_t {
+            return (static_cast<std::uint64_t>(value) << 1U) ^ static_cast<std::uint64_t>(value >> 63);
+        }
+
+        constexpr auto zigzag_decode(const std::uint64_t value) noexcept -> std::int64_t {
+            return static_cast<std::int64_t>(value >> 1U) ^ -static_cast<std::int64_t>(value & 1U);
+        }
+
+        static_assert(zigzag_decode(zigzag_encode(-3)) == -3);
+        static_assert(zigzag_decode(zigzag_encode(1234567)) == 1234567);
+
+    } // namespace
+
+    auto SourceMapBuilder::append(const std::size_t source_offset) -> void {
+        if (m_run_length > 0 && source_offset != m_run_offset) {
+            flush_run();
+        }
+        m_run_offset = source_offset;
+        ++m_run_length;
+    }
+
+    auto SourceMapBuilder::finish() -> SourceMap {
+        if (m_run_length > 0) {
+            flush_run();
+        }
+        return SourceMap{m_encoded, m_checkpoints, m_encoded_size};
+    }
+
+    auto SourceMapBuilder::flush_run() -> void {
+        if (m_run_count % SourceMap::checkpoint_interval == 0) {
+            m_checkpoints.push_back(SourceMapCheckpoint{.code_offset = m_encoded_size,
+                                                        .source_offset = m_encoded_offset,
+                                                        .encoded_position = m_encoded.size()});
+        }
+        ++m_run_count;
+        m_encoded_size += m_run_length;
+
+        write_varint(m_encoded, m_run_length);
+        write_varint(m_encoded, zigzag_encode(static_cast<std::int64_t>(m_run_offset) -
+                                              static_cast<std::int64_t>(m_encoded_offset)));
+        m_encoded_offset = m_run_offset;
+        m_run_length = 0;
+    }
+
+    auto SourceMap::source_offset(const std::size_t code_offset) const noexcept -> std::size_t {
+        // The last checkpoint at or before code_offset; the first checkpoint is always at code offset zero.
+        const auto checkpoint = std::prev(std::ranges::upper_bound(m_checkpoints, code_offset, {},
+                                                                   &SourceMapCheckpoint::code_offset));
+
+        const auto *cursor = m_encoded.data() + checkpoint->encoded_position;
+        const auto *const end = m_encoded.data() + m_encoded.size();
+
+        std::size_t run_start = checkpoint->code_offset;
+        std::size_t offset = checkpoint->source_offset;
+        while (cursor != end) {
+            const auto length = read_varint(cursor);
+            offset = static_cast<std::size_t>(static_cast<std::int64_t>(offset) + zigzag_decode(read_varint(cursor)));
+            run_start += length;
+            if (code_offset < run_start) {
+                break;
+            }
+        }
+        return offset;
+    }
+
+} // namespace lox::vm
@@ -0,0 +1,88 @@
+#ifndef LOX_VM_SOURCE_MAP_HPP
+#define LOX_VM_SOURCE_MAP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace lox::vm {
+
+    /// Decoder state at the start of a run, letting a lookup skip the runs before it.
+    struct SourceMapCheckpoint {
+        std::size_t code_offset;
+        std::size_t source_offset;
+        std::size_t encoded_position;
+    };
+
+    /**
+     * @brief Maps each byte of a chunk's code back to the source offset it was compiled from, compactly.
+     *
+     * Consecutive code bytes compiled from the same node form a run. Each run is stored as a varint length followed
+     * by the zigzag varint delta from the previous run's source offset, so a typical instruction costs two or three
+     * bytes of table instead of eight bytes per code byte.
+     *
+     * Every checkpoint_interval runs a checkpoint records where decoding can resume, so a lookup binary-searches the
+     * checkpoints and then decodes at most that many runs. Lookups serve only the disassembler and runtime error
+     * reporting, never the dispatch loop.
+     *
+     * A SourceMap is a read-only view; the encoded bytes and checkpoints are owned by a SourceMapBuilder or by the
+     * Chunk they were frozen into.
+     */
+    class SourceMap final {
+    public:
+        static constexpr std::size_t checkpoint_interval = 128;
+
+        constexpr SourceMap() noexcept = default;
+        constexpr SourceMap(const std::span<const std::uint8_t> encoded,
+                            const std::span<const SourceMapCheckpoint> checkpoints, const std::size_t size) noexcept
+            : m_encoded(encoded), m_checkpoints(checkpoints), m_size(size) {}
+
+        /// Returns the source offset of the code byte at @p code_offset, which must be less than size().
+        [[nodiscard]] auto source_offset(std::size_t code_offset) const noexcept -> std::size_t;
+
+        /// The number of code bytes described.
+        [[nodiscard]] auto size() const noexcept -> std::size_t { return m_size; }
+
+        [[nodiscard]] auto encoded() const noexcept -> std::span<const std::uint8_t> { return m_encoded; }
+        [[nodiscard]] auto checkpoints() const noexcept -> std::span<const SourceMapCheckpoint> {
+            return m_checkpoints;
+        }
+
+        /// Bytes taken by the encoded table and its checkpoints.
+        [[nodiscard]] auto memory_bytes() const noexcept -> std::size_t {
+            return m_encoded.size_bytes() + m_checkpoints.size_bytes();
+        }
+
+    private:
+        std::span<const std::uint8_t> m_encoded;
+        std::span<const SourceMapCheckpoint> m_checkpoints;
+        std::size_t m_size = 0;
+    };
+
+    /// Accumulates a SourceMap one code byte at a time while a chunk is being compiled.
+    class SourceMapBuilder final {
+    public:
+        /// Records that the next code byte was compiled from @p source_offset.
+        auto append(std::size_t source_offset) -> void;
+
+        /// Encodes the run still being appended to and returns a view of the finished table.
+        [[nodiscard]] auto finish() -> SourceMap;
+
+    private:
+        auto flush_run() -> void;
+
+        std::vector<std::uint8_t> m_encoded;
+        std::vector<SourceMapCheckpoint> m_checkpoints;
+        std::size_t m_run_count = 0;
+        /// Code bytes covered by the encoded runs.
+        std::size_t m_encoded_size = 0;
+        /// Source offset of the last encoded run, the base for the next delta.
+        std::size_t m_encoded_offset = 0;
+        std::size_t m_run_offset = 0;
+        std::size_t m_run_length = 0;
+    };
+
+} // namespace lox::vm
+
+#endif
@@ -0,0 +1,74 @@
+#include "lox/vm/value.hpp"
+
+#include "lox/vm/object.hpp"
+
+#include <cstdio>
+#include <format>
+#include <print>
+#include <string>
+
+namespace lox::vm {
+
+    namespace {
+
+        auto object_to_string(const Obj *object) -> std::string {
+            switch (object->type) {
+            case ObjType::string:
+                return static_cast<const ObjString *>(object)->chars;
+            case ObjType::function: {
+                const auto *const function = static_cast<const ObjFunction *>(object);
+                return function->name == nullptr ? "<script>" : std::format("<fn {}>", function->name->chars);
+            }
+            case ObjType::native:
+                return "<native fn>";
+            case ObjType::closure:
+                return object_to_string(static_cast<const ObjClosure *>(object)->function);
+            case ObjType::upvalue:
+                return "upvalue";
+            }
+            return "<object>";
+        }
+
+    } // namespace
+
+    auto value_to_string(const Value &value) -> std::string {
+        switch (value.type()) {
+        case ValueType::nil:
+            return "nil";
+        case ValueType::boolean:
+            return value.as_bool() ? "true" : "false";
+        case ValueType::number:
+            return std::format("{:g}", value.as_number());
+        case ValueType::object:
+            return object_to_string(value.as_object());
+        case ValueType::undefined:
+            return "<undefined>";
+        }
+        return "<unknown>";
+    }
+
+    auto print_value(std::FILE *out, const Value &value) noexcept -> void {
+        switch (value.type()) {
+        case ValueType::nil:
+            std::print(out, "nil");
+            break;
+        case ValueType::boolean:
+            std::print(out, "{}", value.as_bool() ? "true" : "false");
+            break;
+        case ValueType::number:
+            std::print(out, "{:g}", value.as_number());
+            break;
+        case ValueType::object:
+            if (is_string(value)) {
+                std::print(out, "{}", as_string(value)->chars);
+            } else {
+                std::print(out, "{}", object_to_string(value.as_object()));
+            }
+            break;
+        case ValueType::undefined:
+            std::print(out, "<undefined>");
+            break;
+        }
+    }
+
+} // namespace lox::vm
@@ -1,10 +1,225 @@
 #ifndef LOX_VM_VALUE_HPP
 #define LOX_VM_VALUE_HPP
 
+#include <bit>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#ifndef LOX_NAN_BOXING
+#define LOX_NAN_BOXING 1
+#endif
+
 namespace lox::vm {
 
-    using Value = double;
+    struct Obj;
+
+    enum class ValueType : std::uint8_t { nil, boolean, number, object, undefined };
+
+    /**
+     * @brief A Lox value: nil, a boolean, a double, or a pointer to a heap object.
+     *
+     * Values are small, trivially copyable and compared by identity for objects; strings are interned, so identity is
+     * also content equality for them.
+     *
+     * One more state, undefined, is never visible to Lox code: it marks a global slot whose variable has not been
+     * defined yet.
+     *
+     * By default a value is NaN-boxed into a single 64-bit word, so the stack, constant pools and globals hold one
+     * machine word per value. A double is stored as itself. Every other value is a quiet NaN no arithmetic produces,
+     * with the kind of value and any payload in the bits the NaN leaves free:
+     *   - nil, false, true and undefined are small tags in the low bits;
+     *   - an object sets the sign bit as well and keeps its pointer in the low 48 bits.
+     *
+     * Building with LOX_NAN_BOXING=0 selects a tagged union with the same interface instead. It is twice the size but
+     * shows up plainly in a debugger.
+     */
+#if LOX_NAN_BOXING
+    class Value final {
+    public:
+        constexpr Value() noexcept = default;
+
+        [[nodiscard]] static constexpr auto nil() noexcept -> Value { return Value{nil_bits}; }
+        [[nodiscard]] static constexpr auto boolean(const bool b) noexcept -> Value {
+            return Value{b ? true_bits : false_bits};
+        }
+        /// @p n is stored as is. Every double Lox sees comes from a literal or from arithmetic, which only makes NaNs
+        /// with a clear payload, so none can be mistaken for a tag; checking for NaN here cost a fifth of the time of
+        /// floating-point-heavy loops.
+        [[nodiscard]] static constexpr auto number(const double n) noexcept -> Value {
+            return Value{std::bit_cast<std::uint64_t>(n)};
+        }
+        [[nodiscard]] static auto object(Obj *const o) noexcept -> Value {
+            return Value{sign_bit | quiet_nan | static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(o))};
+        }
+
+        /// The sentinel stored in global slots that have a name but no definition yet.
+        [[nodiscard]] static constexpr auto undefined() noexcept -> Value { return Value{undefined_bits}; }
+
+        [[nodiscard]] constexpr auto type() const noexcept -> ValueType {
+            if (is_number()) {
+                return ValueType::number;
+            }
+            if (is_object()) {
+                return ValueType::object;
+            }
+            switch (m_bits) {
+            case false_bits:
+            case true_bits:
+                return ValueType::boolean;
+            case undefined_bits:
+                return ValueType::undefined;
+            default:
+                return ValueType::nil;
+            }
+        }
+        [[nodiscard]] constexpr auto is_nil() const noexcept -> bool { return m_bits == nil_bits; }
+        [[nodiscard]] constexpr auto is_bool() const noexcept -> bool { return (m_bits | 1U) == true_bits; }
+        [[nodiscard]] constexpr auto is_number() const noexcept -> bool { return (m_bits & quiet_nan) != quiet_nan; }
+        [[nodiscard]] constexpr auto is_object() const noexcept -> bool {
+            return (m_bits & (sign_bit | quiet_nan)) == (sign_bit | quiet_nan);
+        }
+        [[nodiscard]] constexpr auto is_undefined() const noexcept -> bool { return m_bits == undefined_bits; }
+
+        [[nodiscard]] constexpr auto as_bool() const noexcept -> bool { return m_bits == true_bits; }
+        [[nodiscard]] constexpr auto as_number() const noexcept -> double { return std::bit_cast<double>(m_bits); }
+        [[nodiscard]] auto as_object() const noexcept -> Obj * {
+            return reinterpret_cast<Obj *>(static_cast<std::uintptr_t>(m_bits & ~(sign_bit | quiet_nan)));
+        }
+
+        /// The boxed word. It identifies a value exactly, telling 0 from -0 and matching a NaN with itself, which
+        /// operator== does not.
+        [[nodiscard]] constexpr auto bits() const noexcept -> std::uint64_t { return m_bits; }
+
+        /// nil and false are falsey; every other value is truthy.
+        [[nodiscard]] constexpr auto is_falsey() const noexcept -> bool {
+            return m_bits == nil_bits || m_bits == false_bits;
+        }
+
+        friend constexpr auto operator==(const Value &a, const Value &b) noexcept -> bool {
+            // Numbers compare as doubles, so NaN is unequal to itself and -0 equals 0; anything else by its word.
+            if (a.is_number() && b.is_number()) {
+                return a.as_number() == b.as_number();
+            }
+            return a.m_bits == b.m_bits;
+        }
+
+    private:
+        static constexpr std::uint64_t sign_bit = 0x8000'0000'0000'0000;
+        /// The exponent, the quiet bit and one more: no double arithmetic produces a NaN with all of these set.
+        static constexpr std::uint64_t quiet_nan = 0x7ffc'0000'0000'0000;
+        static constexpr std::uint64_t nil_bits = quiet_nan | 1U;
+        static constexpr std::uint64_t false_bits = quiet_nan | 2U;
+        static constexpr std::uint64_t true_bits = quiet_nan | 3U;
+        static constexpr std::uint64_t undefined_bits = quiet_nan | 4U;
+
+        explicit constexpr Value(const std::uint64_t bits) noexcept : m_bits(bits) {}
+
+        std::uint64_t m_bits = nil_bits;
+    };
+
+    static_assert(sizeof(void *) == sizeof(std::uint64_t),
+                  "NaN-boxing needs 64-bit pointers; build with LOX_NAN_BOXING=0");
+    static_assert(sizeof(Value) == sizeof(std::uint64_t));
+#else
+    class Value final {
+    public:
+        constexpr Value() noexcept = default;
+
+        [[nodiscard]] static constexpr auto nil() noexcept -> Value { return Value{}; }
+        [[nodiscard]] static constexpr auto boolean(const bool b) noexcept -> Value {
+            Value value;
+            value.m_type = ValueType::boolean;
+            value.m_as.boolean = b;
+            return value;
+        }
+        [[nodiscard]] static constexpr auto number(const double n) noexcept -> Value {
+            Value value;
+            value.m_type = ValueType::number;
+            value.m_as.number = n;
+            return value;
+        }
+        [[nodiscard]] static constexpr auto object(Obj *const o) noexcept -> Value {
+            Value value;
+            value.m_type = ValueType::object;
+            value.m_as.object = o;
+            return value;
+        }
+
+        /// The sentinel stored in global slots that have a name but no definition yet.
+        [[nodiscard]] static constexpr auto undefined() noexcept -> Value {
+            Value value;
+            value.m_type = ValueType::undefined;
+            return value;
+        }
+
+        [[nodiscard]] constexpr auto type() const noexcept -> ValueType { return m_type; }
+        [[nodiscard]] constexpr auto is_nil() const noexcept -> bool { return m_type == ValueType::nil; }
+        [[nodiscard]] constexpr auto is_bool() const noexcept -> bool { return m_type == ValueType::boolean; }
+        [[nodiscard]] constexpr auto is_number() const noexcept -> bool { return m_type == ValueType::number; }
+        [[nodiscard]] constexpr auto is_object() const noexcept -> bool { return m_type == ValueType::object; }
+        [[nodiscard]] constexpr auto is_undefined() const noexcept -> bool { return m_type == ValueType::undefined; }
+
+        [[nodiscard]] constexpr auto as_bool() const noexcept -> bool { return m_as.boolean; }
+        [[nodiscard]] constexpr auto as_number() const noexcept -> double { return m_as.number; }
+        [[nodiscard]] constexpr auto as_object() const noexcept -> Obj * { return m_as.object; }
+
+        /// The payload's bit pattern. Together with type() it identifies a value exactly, telling 0 from -0 and
+        /// matching a NaN with itself, which operator== does not.
+        [[nodiscard]] auto bits() const noexcept -> std::uint64_t {
+            switch (m_type) {
+            case ValueType::nil:
+            case ValueType::undefined:
+                return 0;
+            case ValueType::boolean:
+                return m_as.boolean ? 1 : 0;
+            case ValueType::number:
+                return std::bit_cast<std::uint64_t>(m_as.number);
+            case ValueType::object:
+                return reinterpret_cast<std::uintptr_t>(m_as.object);
+            }
+            return 0;
+        }
+
+        /// nil and false are falsey; every other value is truthy.
+        [[nodiscard]] constexpr auto is_falsey() const noexcept -> bool {
+            return is_nil() || (is_bool() && !as_bool());
+        }
+
+        friend constexpr auto operator==(const Value &a, const Value &b) noexcept -> bool {
+            if (a.m_type != b.m_type) {
+                return false;
+            }
+            switch (a.m_type) {
+            case ValueType::nil:
+            case ValueType::undefined:
+                return true;
+            case ValueType::boolean:
+                return a.m_as.boolean == b.m_as.boolean;
+            case ValueType::number:
+                return a.m_as.number == b.m_as.number;
+            case ValueType::object:
+                return a.m_as.object == b.m_as.object;
+            }
+            return false;
+        }
+
+    private:
+        ValueType m_type = ValueType::nil;
+        union {
+            bool boolean;
+            double number;
+            Obj *object;
+        } m_as{.number = 0.0};
+    };
+#endif
+
+    /// Formats @p value the way Lox's print statement shows it.
+    [[nodiscard]] auto value_to_string(const Value &value) -> std::string;
+
+    /// Writes @p value to @p out without building an intermediate string for numbers and literals.
+    auto print_value(std::FILE *out, const Value &value) noexcept -> void;
 
-}
+} // namespace lox::vm
 
 #endif
@@ -0,0 +1,272 @@
+#include "lox/vm/verify.hpp"
+
+#include "lox/vm/chunk.hpp"
+#include "lox/vm/common.hpp"
+#include "lox/vm/object.hpp"
+#include "lox/vm/value.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <format>
+#include <limits>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace lox::vm {
+
+    namespace {
+
+        constexpr auto unreached = std::numeric_limits<std::size_t>::max();
+
+        class ChunkVerifier {
+        public:
+            ChunkVerifier(const ObjFunction &function, const std::size_t global_count)
+                : m_function(function), m_code(function.chunk.code()), m_constants(function.chunk.constants()),
+                  m_global_count(global_count), m_depth(m_code.size(), unreached),
+                  m_is_instruction(m_code.size(), false) {}
+
+            auto verify() -> std::expected<void, std::string> {
+                if (m_code.empty()) {
+                    return fail(0, "execution runs off the end of the code");
+                }
+                if (auto decoded = decode(); !decoded) {
+                    return decoded;
+                }
+
+                // The frame starts out holding the callee and its arguments.
+                const auto entry_depth = static_cast<std::size_t>(m_function.arity) + 1;
+                m_max_depth = entry_depth;
+                if (auto entered = reach(0, entry_depth); !entered) {
+                    return entered;
+                }
+                while (!m_worklist.empty()) {
+                    const auto offset = m_worklist.back();
+                    m_worklist.pop_back();
+                    if (auto checked = check(offset); !checked) {
+                        return checked;
+                    }
+                }
+
+                if (m_max_depth > m_function.chunk.max_stack()) {
+                    return fail(0, std::format("needs {} stack slots but the chunk records {}", m_max_depth,
+                                               m_function.chunk.max_stack()));
+                }
+                return {};
+            }
+
+        private:
+            /// Checks that every opcode is known and that its operands fit in the code.
+            auto decode() -> std::expected<void, std::string> {
+                for (std::size_t offset = 0; offset < m_code.size();) {
+                    if (m_code[offset] >= OPCODE_COUNT) {
+                        return fail(offset, std::format("unknown opcode {}", m_code[offset]));
+                    }
+                    const auto width = 1 + operand_bytes(static_cast<OpCode>(m_code[offset]));
+                    if (offset + width > m_code.size()) {
+                        return fail(offset, "operands run past the end of the code");
+                    }
+                    m_is_instruction[offset] = true;
+                    offset += width;
+                }
+                return {};
+            }
+
+            /// Checks the instruction at @p offset against the depth it is reached at and queues its successors.
+            auto check(const std::size_t offset) -> std::expected<void, std::string> {
+                const auto op = static_cast<OpCode>(m_code[offset]);
+                const auto *const operands = m_code.data() + offset + 1;
+                const auto next = offset + 1 + operand_bytes(op);
+                const auto depth = m_depth[offset];
+
+                const auto effect = stack_effect(op, operand_bytes(op) > 0 ? operands[0] : 0);
+                if (effect.pops > depth) {
+                    return fail(offset, std::format("pops {} values but the stack holds {}", effect.pops, depth));
+                }
+                if (auto operands_valid = check_operands(offset, op, operands, depth); !operands_valid) {
+                    return operands_valid;
+                }
+
+                const auto after = depth - effect.pops + effect.pushes;
+                m_max_depth = std::max(m_max_depth, after);
+
+                switch (op) {
+                case OpCode::OP_RETURN:
+                    return {};
+                case OpCode::OP_JUMP:
+                    return reach_jump(offset, next + read_short(operands), after);
+                case OpCode::OP_LOOP: {
+                    const auto distance = read_short(operands);
+                    if (distance > next) {
+                        return fail(offset, "loops back before the start of the code");
+                    }
+                    return reach_jump(offset, next - distance, after);
+                }
+                default:
+                    if (is_forward_jump(op)) {
+                        if (auto jumped = reach_jump(offset, next + read_short(operands), after); !jumped) {
+                            return jumped;
+                        }
+                    }
+                    if (next == m_code.size()) {
+                        return fail(offset, "execution runs off the end of the code");
+                    }
+                    return reach(next, after);
+                }
+            }
+
+            auto check_operands(const std::size_t offset, const OpCode op, const std::uint8_t *operands,
+                                const std::size_t depth) -> std::expected<void, std::string> {
+                switch (op) {
+                case OpCode::OP_CONSTANT:
+                case OpCode::OP_ADD_CONSTANT:
+                case OpCode::OP_SUBTRACT_CONSTANT:
+                    return check_constant(offset, operands[0]);
+                case OpCode::OP_CONSTANT_LONG:
+                    return check_constant(offset, read_long(operands));
+                case OpCode::OP_GET_LOCAL:
+                case OpCode::OP_SET_LOCAL:
+                    return check_local(offset, operands[0], depth);
+                case OpCode::OP_ADD_LOCALS:
+                case OpCode::OP_SUBTRACT_LOCALS:
+                case OpCode::OP_MULTIPLY_LOCALS:
+                case OpCode::OP_DIVIDE_LOCALS:
+                    if (auto first = check_local(offset, operands[0], depth); !first) {
+                        return first;
+                    }
+                    return check_local(offset, operands[1], depth);
+                case OpCode::OP_GET_GLOBAL:
+                case OpCode::OP_DEFINE_GLOBAL:
+                case OpCode::OP_SET_GLOBAL:
+                    return check_global(offset, operands[0]);
+                case OpCode::OP_GET_GLOBAL_LONG:
+                case OpCode::OP_DEFINE_GLOBAL_LONG:
+                case OpCode::OP_SET_GLOBAL_LONG:
+                    return check_global(offset, read_long(operands));
+                case OpCode::OP_GET_UPVALUE:
+                case OpCode::OP_SET_UPVALUE:
+                    if (operands[0] >= m_function.captures.size()) {
+                        return fail(offset, std::format("upvalue {} out of range", operands[0]));
+                    }
+                    return {};
+                case OpCode::OP_CLOSURE:
+                    return check_closure(offset, operands[0], depth);
+                case OpCode::OP_CLOSURE_LONG:
+                    return check_closure(offset, read_long(operands), depth);
+                default:
+                    return {};
+                }
+            }
+
+            auto check_constant(const std::size_t offset, const std::size_t index) -> std::expected<void, std::string> {
+                if (index >= m_constants.size()) {
+                    return fail(offset, std::format("constant {} out of range", index));
+                }
+                return {};
+            }
+
+            auto check_local(const std::size_t offset, const std::size_t slot, const std::size_t depth)
+                -> std::expected<void, std::string> {
+                if (slot >= depth) {
+                    return fail(offset, std::format("local slot {} out of range", slot));
+                }
+                return {};
+            }
+
+            auto check_global(const std::size_t offset, const std::size_t slot) -> std::expected<void, std::string> {
+                if (slot >= m_global_count) {
+                    return fail(offset, std::format("global slot {} out of range", slot));
+                }
+                return {};
+            }
+
+            /// Checks that the constant is a function whose captures name locals or upvalues of this function.
+            auto check_closure(const std::size_t offset, const std::size_t index, const std::size_t depth)
+                -> std::expected<void, std::string> {
+                if (auto in_range = check_constant(offset, index); !in_range) {
+                    return in_range;
+                }
+                if (!is_obj_type(m_constants[index], ObjType::function)) {
+                    return fail(offset, std::format("constant {} is not a function", index));
+                }
+                const auto *const function = static_cast<const ObjFunction *>(m_constants[index].as_object());
+                for (const auto capture : function->captures) {
+                    // A local function captures itself through the slot its closure is about to be pushed into.
+                    const auto limit = capture.is_local ? depth + 1 : m_function.captures.size();
+                    if (capture.index >= limit) {
+                        return fail(offset, std::format("captured {} {} out of range",
+                                                        capture.is_local ? "local" : "upvalue", capture.index));
+                    }
+                }
+                return {};
+            }
+
+            auto reach_jump(const std::size_t offset, const std::size_t target, const std::size_t depth)
+                -> std::expected<void, std::string> {
+                if (target >= m_code.size() || !m_is_instruction[target]) {
+                    return fail(offset, std::format("jump to offset {} is not an instruction", target));
+                }
+                return reach(target, depth);
+            }
+
+            /// Records that @p offset is reached with @p depth values on the stack, queueing it the first time.
+            auto reach(const std::size_t offset, const std::size_t depth) -> std::expected<void, std::string> {
+                if (m_depth[offset] == unreached) {
+                    m_depth[offset] = depth;
+                    m_worklist.push_back(offset);
+                    return {};
+                }
+                if (m_depth[offset] != depth) {
+                    return fail(offset, std::format("reached with stack depths {} and {}", m_depth[offset], depth));
+                }
+                return {};
+            }
+
+            [[nodiscard]] static auto read_short(const std::uint8_t *operands) noexcept -> std::size_t {
+                return static_cast<std::size_t>(operands[0]) << 8U | operands[1];
+            }
+
+            [[nodiscard]] static auto read_long(const std::uint8_t *operands) noexcept -> std::size_t {
+                return static_cast<std::size_t>(operands[0]) << 16U | static_cast<std::size_t>(operands[1]) << 8U |
+                       operands[2];
+            }
+
+            [[nodiscard]] auto fail(const std::size_t offset, const std::string_view message) const
+                -> std::unexpected<std::string> {
+                const auto name = m_function.name != nullptr ? std::string_view{m_function.name->chars} : "<script>";
+                return std::unexpected(std::format("Invalid bytecode in {} at offset {}: {}", name, offset, message));
+            }
+
+            const ObjFunction &m_function;
+            std::span<const std::uint8_t> m_code;
+            std::span<const Value> m_constants;
+            std::size_t m_global_count;
+            /// The stack depth each instruction is reached at, or unreached.
+            std::vector<std::size_t> m_depth;
+            std::vector<bool> m_is_instruction;
+            std::vector<std::size_t> m_worklist;
+            std::size_t m_max_depth = 0;
+        };
+
+    } // namespace
+
+    auto verify(const ObjFunction &function, const std::size_t global_count) -> std::expected<void, std::string> {
+        if (auto verified = ChunkVerifier{function, global_count}.verify(); !verified) {
+            return verified;
+        }
+        for (const auto &constant : function.chunk.constants()) {
+            if (!is_obj_type(constant, ObjType::function)) {
+                continue;
+            }
+            const auto &nested = *static_cast<const ObjFunction *>(constant.as_object());
+            if (auto verified = verify(nested, global_count); !verified) {
+                return verified;
+            }
+        }
+        return {};
+    }
+
+} // namespace lox::vm
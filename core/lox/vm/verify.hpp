@@ -0,0 +1,33 @@
+#ifndef LOX_VM_VERIFY_HPP
+#define LOX_VM_VERIFY_HPP
+
+#include "lox/vm/object.hpp"
+
+#include <cstddef>
+#include <expected>
+#include <string>
+
+namespace lox::vm {
+
+    /**
+     * @brief Checks that @p function's bytecode, and that of every function nested in its constants, is well formed.
+     *
+     * Each chunk is decoded once to check that every opcode is known and its operands lie within the code, then
+     * walked along all control-flow paths from offset zero, tracking how many values the frame holds:
+     *   - jumps land on an instruction boundary inside the code, and no path falls off the end;
+     *   - constant indices are inside the pool, and OP_CLOSURE's constant is a function;
+     *   - local slots are below the current depth, upvalue indices below the function's capture count, and global
+     *     slots below @p global_count;
+     *   - no instruction pops more values than the frame holds, and every path reaching an instruction does so at
+     *     the same depth.
+     *
+     * Finally the deepest the frame gets must not exceed the chunk's recorded max_stack, which the VM trusts when it
+     * checks for room once per call, so verified code runs without checking the stack on every instruction. The
+     * error names the function and the code offset of the first problem found.
+     */
+    [[nodiscard]] auto verify(const ObjFunction &function, std::size_t global_count)
+        -> std::expected<void, std::string>;
+
+} // namespace lox::vm
+
+#endif
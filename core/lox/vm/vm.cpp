@@ -1,17 +1,62 @@
 #include "lox/vm/vm.hpp"
 
+#include "lox/syntax/source.hpp"
 #include "lox/vm/chunk.hpp"
 #include "lox/vm/common.hpp"
 #include "lox/vm/compile.hpp"
+#include "lox/vm/object.hpp"
 #include "lox/vm/value.hpp"
+#include "lox/vm/verify.hpp"
 
-#include <spdlog/spdlog.h>
-
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <format>
+#include <functional>
+#include <iterator>
 #include <print>
+#include <span>
+#include <string>
 #include <string_view>
 
+/**
+ * LOX_COMPUTED_GOTO=0 makes run() dispatch through a switch. Otherwise, on compilers with labels as values (GCC and
+ * Clang), it jumps through a table of handler addresses instead: see LOX_VM_NEXT in run().
+ */
+#if (!defined(LOX_COMPUTED_GOTO) || LOX_COMPUTED_GOTO) && (defined(__GNUC__) || defined(__clang__))
+#define LOX_THREADED_DISPATCH 1
+#else
+#define LOX_THREADED_DISPATCH 0
+#endif
+
 namespace lox::vm {
 
+    namespace {
+
+        auto clock_native(std::span<const Value> /*arguments*/) noexcept -> Value {
+            static const auto start = std::chrono::steady_clock::now();
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            return Value::number(elapsed.count());
+        }
+
+        constexpr std::string_view numbers_expected = "Operands must be numbers.";
+        constexpr std::string_view numbers_or_strings_expected = "Operands must be two numbers or two strings.";
+
+        [[nodiscard]] auto read_short(const std::uint8_t *&ip) noexcept -> std::uint16_t {
+            ip += 2;
+            return static_cast<std::uint16_t>(ip[-2] << 8U | ip[-1]);
+        }
+
+        /// Reads the three-byte big-endian operand of a @c _LONG instruction.
+        [[nodiscard]] auto read_long(const std::uint8_t *&ip) noexcept -> std::uint32_t {
+            ip += 3;
+            return static_cast<std::uint32_t>(ip[-3]) << 16U | static_cast<std::uint32_t>(ip[-2]) << 8U | ip[-1];
+        }
+
+    } // namespace
+
+    auto threaded_dispatch() noexcept -> bool { return LOX_THREADED_DISPATCH != 0; }
+
     auto interpret_result_to_string(InterpretResult result) noexcept -> std::string_view {
         switch (result) {
         case InterpretResult::ok:
@@ -25,70 +70,586 @@ namespace lox::vm {
         }
     }
 
-    VirtualMachine::VirtualMachine() : ip(0), m_stack(), m_chunks() { m_stack.reserve(STACK_MAX); }
+    VirtualMachine::VirtualMachine(std::FILE *out, std::FILE *err, const GcSettings gc)
+        : m_out(out), m_err(err), m_heap(gc) {
+        // The heap is a member, so the VM stays registered for as long as the heap exists.
+        m_heap.add_roots(*this);
+        m_frames.reserve(FRAMES_MAX);
+        define_native("clock", clock_native, 0);
+    }
 
     auto VirtualMachine::interpret(std::string_view source) noexcept -> InterpretResult {
-        Chunk chunk;
-        m_chunks.push_back(std::move(chunk));
-        ip = 0;
+        m_source = nullptr;
+
+        Compiler compiler{m_heap, m_globals};
+        const auto function = compiler.compile(source);
+        if (!function) {
+            std::println(m_err, "{}", function.error());
+            return InterpretResult::compile_error;
+        }
 
-        Compiler compiler;
-        if (!compiler.compile(source, &chunk)) {
+        return run_script(function.value());
+    }
+
+    auto VirtualMachine::interpret(const syntax::SourceFile &file) noexcept -> InterpretResult {
+        m_source = &file;
+
+        Compiler compiler{m_heap, m_globals};
+        const auto function = compiler.compile(file);
+        if (!function) {
+            std::println(m_err, "{}", function.error());
             return InterpretResult::compile_error;
         }
 
-        return InterpretResult::ok;
-        // return run();
+        return run_script(function.value());
+    }
+
+    auto VirtualMachine::run_script(ObjFunction *const function) noexcept -> InterpretResult {
+        // Everything below trusts the bytecode: operands, jump targets and stack depths are checked here, once.
+        if (const auto verified = verify(*function, m_globals.size()); !verified) {
+            std::println(m_err, "{}", verified.error());
+            return InterpretResult::compile_error;
+        }
+
+        reset_stack();
+        // Nothing refers to the script function but this frame, so it sits in slot zero while its closure is made.
+        push(Value::object(function));
+        auto *const closure = m_heap.new_closure(function);
+        m_stack_top[-1] = Value::object(closure);
+        if (!call(closure, 0)) {
+            return InterpretResult::runtime_error;
+        }
+        return run();
     }
 
     auto VirtualMachine::run() noexcept -> InterpretResult {
-        while (true) {
-#ifndef NDEBUG
+        // The running frame's state lives in locals so it can stay in registers. LOX_VM_LOAD_FRAME() refreshes them
+        // when the frame changes; ip is written back to the frame only before a call or a runtime error, and the
+        // stack top to m_stack_top only around calls and before allocating, when the collector marks the stack.
+        CallFrame *frame = nullptr;
+        const std::uint8_t *ip = nullptr;
+        const Value *constants = nullptr;
+        Value *slots = nullptr;
+        Value *stack_top = m_stack_top;
+        uint8_t instruction = 0;
+
+#define LOX_VM_LOAD_FRAME()                                                                                            \
+    do {                                                                                                               \
+        frame = &m_frames.back();                                                                                      \
+        ip = frame->ip;                                                                                                \
+        constants = frame->closure->function->chunk.constants().data();                                                \
+        slots = m_stack.get() + frame->slots;                                                                          \
+    } while (false)
+#define LOX_VM_ERROR(message)                                                                                          \
+    do {                                                                                                               \
+        frame->ip = ip;                                                                                                \
+        runtime_error(message);                                                                                        \
+        return InterpretResult::runtime_error;                                                                         \
+    } while (false)
+
+        LOX_VM_LOAD_FRAME();
+
+#ifdef LOX_DEBUG_TRACE_EXECUTION
+        const auto trace = [this, &frame, &ip, &stack_top] {
             std::print("          ");
-            for (const auto &slot : m_stack) {
-                std::print("[ {} ]", slot);
+            for (const auto *slot = m_stack.get(); slot != stack_top; ++slot) {
+                std::print("[ {} ]", value_to_string(*slot));
             }
             std::println();
-            m_chunks.back().disassemble_instruction(ip);
+            const auto &chunk = frame->closure->function->chunk;
+            chunk.disassemble_instruction(static_cast<size_t>(ip - chunk.code().data()),
+                                          m_source != nullptr ? &m_source->lines() : nullptr);
+        };
+#define LOX_VM_TRACE() trace()
+#else
+#define LOX_VM_TRACE() static_cast<void>(0)
 #endif
-            uint8_t instruction = 0;
-            switch (instruction = read_byte()) {
-            case static_cast<uint8_t>(OpCode::OP_CONSTANT): {
-                Value constant = read_constant();
-                m_stack.push_back(constant);
-            } break;
-            case static_cast<uint8_t>(OpCode::OP_ADD): {
-                perform_binary_operation(std::plus<>{});
-            } break;
-            case static_cast<uint8_t>(OpCode::OP_SUBTRACT): {
-                perform_binary_operation(std::minus<>{});
-                break;
+
+        // Each handler ends in LOX_VM_NEXT(). Threaded, that fetches the next opcode and jumps straight to its
+        // handler, giving every handler its own indirect branch; otherwise it goes back round the loop to the switch.
+#if LOX_THREADED_DISPATCH
+        // In OpCode order; the verifier has rejected any other byte.
+        static void *const dispatch_table[] = {
+            &&OP_CONSTANT,
+            &&OP_CONSTANT_LONG,
+            &&OP_NIL,
+            &&OP_TRUE,
+            &&OP_FALSE,
+            &&OP_POP,
+            &&OP_GET_LOCAL,
+            &&OP_SET_LOCAL,
+            &&OP_GET_GLOBAL,
+            &&OP_GET_GLOBAL_LONG,
+            &&OP_DEFINE_GLOBAL,
+            &&OP_DEFINE_GLOBAL_LONG,
+            &&OP_SET_GLOBAL,
+            &&OP_SET_GLOBAL_LONG,
+            &&OP_GET_UPVALUE,
+            &&OP_SET_UPVALUE,
+            &&OP_EQUAL,
+            &&OP_GREATER,
+            &&OP_LESS,
+            &&OP_ADD,
+            &&OP_SUBTRACT,
+            &&OP_MULTIPLY,
+            &&OP_DIVIDE,
+            &&OP_NOT,
+            &&OP_NEGATE,
+            &&OP_PRINT,
+            &&OP_JUMP,
+            &&OP_JUMP_IF_FALSE,
+            &&OP_LOOP,
+            &&OP_CALL,
+            &&OP_CLOSURE,
+            &&OP_CLOSURE_LONG,
+            &&OP_CLOSE_UPVALUE,
+            &&OP_RETURN,
+            &&OP_ADD_CONSTANT,
+            &&OP_SUBTRACT_CONSTANT,
+            &&OP_ADD_LOCALS,
+            &&OP_SUBTRACT_LOCALS,
+            &&OP_MULTIPLY_LOCALS,
+            &&OP_DIVIDE_LOCALS,
+            &&OP_EQUAL_JUMP_IF_FALSE,
+            &&OP_GREATER_JUMP_IF_FALSE,
+            &&OP_LESS_JUMP_IF_FALSE,
+        };
+        static_assert(std::size(dispatch_table) == OPCODE_COUNT);
+#define LOX_VM_CASE(op) op
+#define LOX_VM_NEXT()                                                                                                  \
+    do {                                                                                                               \
+        LOX_VM_TRACE();                                                                                                \
+        goto *dispatch_table[instruction = *ip++];                                                                     \
+    } while (false)
+
+        LOX_VM_NEXT();
+        {
+#else
+#define LOX_VM_CASE(op) case static_cast<uint8_t>(OpCode::op)
+#define LOX_VM_NEXT() continue
+
+        while (true) {
+            LOX_VM_TRACE();
+            switch (instruction = *ip++) {
+#endif
+            LOX_VM_CASE(OP_CONSTANT): {
+                *stack_top++ = constants[*ip++];
+                LOX_VM_NEXT();
             }
-            case static_cast<uint8_t>(OpCode::OP_MULTIPLY): {
-                perform_binary_operation(std::multiplies<>{});
-                break;
+            LOX_VM_CASE(OP_CONSTANT_LONG): {
+                *stack_top++ = constants[read_long(ip)];
+                LOX_VM_NEXT();
+            }
+            LOX_VM_CASE(OP_NIL): {
+                *stack_top++ = Value::nil();
+                LOX_VM_NEXT();
+            }
+            LOX_VM_CASE(OP_TRUE): {
+                *stack_top++ = Value::boolean(true);
+                LOX_VM_NEXT();
+            }
+            LOX_VM_CASE(OP_FALSE): {
+                *stack_top++ = Value::boolean(false);
+                LOX_VM_NEXT();
+            }
+            LOX_VM_CASE(OP_POP): {
+                --stack_top;
+                LOX_VM_NEXT();
+            }
+            LOX_VM_CASE(OP_GET_LOCAL): {
+                const auto slot = *ip++;
+                *stack_top++ = slots[slot];
+                LOX_VM_NEXT();
+            }
+            LOX_VM_CASE(OP_SET_LOCAL): {
+                const auto slot = *ip++;
+                slots[slot] = stack_top[-1];
+                LOX_VM_NEXT();
+            }
+            LOX_VM_CASE(OP_GET_GLOBAL):
+            LOX_VM_CASE(OP_GET_GLOBAL_LONG): {
+                const auto slot =
+                    instruction == static_cast<uint8_t>(OpCode::OP_GET_GLOBAL) ? *ip++ : read_long(ip);
+                const auto value = m_globals[slot];
+                if (value.is_undefined()) {
+                    LOX_VM_ERROR(std::format("Undefined variable '{}'.", m_globals.name(slot)->chars));
+                }
+                *stack_top++ = value;
+                LOX_VM_NEXT();
+            }
+            LOX_VM_CASE(OP_DEFINE_GLOBAL):
+            LOX_VM_CASE(OP_DEFINE_GLOBAL_LONG): {
+                const auto slot =
+                    instruction == static_cast<uint8_t>(OpCode::OP_DEFINE_GLOBAL) ? *ip++ : read_long(ip);
+                m_globals[slot] = *--stack_top;
+                LOX_VM_NEXT();
+            }
+            LOX_VM_CASE(OP_SET_GLOBAL):
+            LOX_VM_CASE(OP_SET_GLOBAL_LONG): {
+                const auto slot =
+                    instruction == static_cast<uint8_t>(OpCode::OP_SET_GLOBAL) ? *ip++ : read_long(ip);
+                auto &global = m_globals[slot];
+                if (global.is_undefined()) {
+                    LOX_VM_ERROR(std::format("Undefined variable '{}'.", m_globals.name(slot)->chars));
+                }
+                global = stack_top[-1];
+                LOX_VM_NEXT();
+            }
+            LOX_VM_CASE(OP_GET_UPVALUE): {
+                const auto slot = *ip++;
+                *stack_top++ = upvalue_value(*frame->closure->upvalues[slot]);
+                LOX_VM_NEXT();
+            }
+            LOX_VM_CASE(OP_SET_UPVALUE): {
+                const auto slot = *ip++;
+                upvalue_value(*frame->closure->upvalues[slot]) = stack_top[-1];
+                LOX_VM_NEXT();
+            }
+            LOX_VM_CASE(OP_EQUAL): {
+                stack_top[-2] = Value::boolean(stack_top[-2] == stack_top[-1]);
+                --stack_top;
+                LOX_VM_NEXT();
+            }
+            LOX_VM_CASE(OP_GREATER): {
+                if (!binary_operation(stack_top, std::greater<>{})) {
+                    LOX_VM_ERROR(numbers_expected);
+                }
+                --stack_top;
+                LOX_VM_NEXT();
+            }
+            LOX_VM_CASE(OP_LESS): {
+                if (!binary_operation(stack_top, std::less<>{})) {
+                    LOX_VM_ERROR(numbers_expected);
+                }
+                --stack_top;
+                LOX_VM_NEXT();
+            }
+            LOX_VM_CASE(OP_ADD): {
+                if (!add(stack_top[-2], stack_top[-1], stack_top[-2], stack_top)) {
+                    LOX_VM_ERROR(numbers_or_strings_expected);
+                }
+                --stack_top;
+                LOX_VM_NEXT();
+            }
+            LOX_VM_CASE(OP_SUBTRACT): {
+                if (!binary_operation(stack_top, std::minus<>{})) {
+                    LOX_VM_ERROR(numbers_expected);
+                }
+                --stack_top;
+                LOX_VM_NEXT();
+            }
+            LOX_VM_CASE(OP_MULTIPLY): {
+                if (!binary_operation(stack_top, std::multiplies<>{})) {
+                    LOX_VM_ERROR(numbers_expected);
+                }
+                --stack_top;
+                LOX_VM_NEXT();
+            }
+            LOX_VM_CASE(OP_DIVIDE): {
+                if (!binary_operation(stack_top, std::divides<>{})) {
+                    LOX_VM_ERROR(numbers_expected);
+                }
+                --stack_top;
+                LOX_VM_NEXT();
+            }
+            LOX_VM_CASE(OP_NOT): {
+                stack_top[-1] = Value::boolean(stack_top[-1].is_falsey());
+                LOX_VM_NEXT();
+            }
+            LOX_VM_CASE(OP_NEGATE): {
+                if (!stack_top[-1].is_number()) {
+                    LOX_VM_ERROR("Operand must be a number.");
+                }
+                stack_top[-1] = Value::number(-stack_top[-1].as_number());
+                LOX_VM_NEXT();
+            }
+            LOX_VM_CASE(OP_PRINT): {
+                print_value(m_out, *--stack_top);
+                std::fputc('\n', m_out);
+                LOX_VM_NEXT();
+            }
+            LOX_VM_CASE(OP_JUMP): {
+                const auto offset = read_short(ip);
+                ip += offset;
+                LOX_VM_NEXT();
             }
-            case static_cast<uint8_t>(OpCode::OP_DIVIDE): {
-                perform_binary_operation(std::divides<>{});
-            } break;
-            case static_cast<uint8_t>(OpCode::OP_NEGATE): {
-                if (m_stack.empty()) {
-                    spdlog::error("Stack underflow");
+            LOX_VM_CASE(OP_JUMP_IF_FALSE): {
+                const auto offset = read_short(ip);
+                if (stack_top[-1].is_falsey()) {
+                    ip += offset;
+                }
+                LOX_VM_NEXT();
+            }
+            LOX_VM_CASE(OP_LOOP): {
+                const auto offset = read_short(ip);
+                ip -= offset;
+                LOX_VM_NEXT();
+            }
+            LOX_VM_CASE(OP_CALL): {
+                const auto arg_count = *ip++;
+                frame->ip = ip;
+                m_stack_top = stack_top;
+                if (!call_value(stack_top[-1 - arg_count], arg_count)) {
                     return InterpretResult::runtime_error;
                 }
-                m_stack.back() = -m_stack.back();
-            } break;
-            case static_cast<uint8_t>(OpCode::OP_RETURN): {
-                std::println("{}", m_stack.back());
-                return InterpretResult::ok;
+                stack_top = m_stack_top;
+                LOX_VM_LOAD_FRAME();
+                LOX_VM_NEXT();
+            }
+            LOX_VM_CASE(OP_CLOSURE):
+            LOX_VM_CASE(OP_CLOSURE_LONG): {
+                const auto index = instruction == static_cast<uint8_t>(OpCode::OP_CLOSURE) ? *ip++ : read_long(ip);
+                auto *const function = static_cast<ObjFunction *>(constants[index].as_object());
+                // Allocating may collect: publish the stack top first, and push the closure before capturing
+                // upvalues, which allocates again.
+                m_stack_top = stack_top;
+                auto *const closure = m_heap.new_closure(function);
+                *stack_top++ = Value::object(closure);
+                m_stack_top = stack_top;
+                for (size_t i = 0; i < closure->upvalues.size(); ++i) {
+                    const auto capture = function->captures[i];
+                    closure->upvalues[i] = capture.is_local ? capture_upvalue(frame->slots + capture.index)
+                                                            : frame->closure->upvalues[capture.index];
+                }
+                LOX_VM_NEXT();
+            }
+            LOX_VM_CASE(OP_CLOSE_UPVALUE): {
+                --stack_top;
+                close_upvalues(static_cast<size_t>(stack_top - m_stack.get()));
+                LOX_VM_NEXT();
+            }
+            LOX_VM_CASE(OP_RETURN): {
+                const Value result = *--stack_top;
+                close_upvalues(frame->slots);
+                m_frames.pop_back();
+                if (m_frames.empty()) {
+                    m_stack_top = m_stack.get();
+                    return InterpretResult::ok;
+                }
+                // The callee's window starts at its own slot zero, which the result replaces.
+                stack_top = slots;
+                *stack_top++ = result;
+                LOX_VM_LOAD_FRAME();
+                LOX_VM_NEXT();
+            }
+            LOX_VM_CASE(OP_ADD_CONSTANT): {
+                if (!add(stack_top[-1], constants[*ip++], stack_top[-1], stack_top)) {
+                    LOX_VM_ERROR(numbers_or_strings_expected);
+                }
+                LOX_VM_NEXT();
+            }
+            LOX_VM_CASE(OP_SUBTRACT_CONSTANT): {
+                if (!number_operation(stack_top[-1], constants[*ip++], std::minus<>{}, stack_top[-1])) {
+                    LOX_VM_ERROR(numbers_expected);
+                }
+                LOX_VM_NEXT();
+            }
+            LOX_VM_CASE(OP_ADD_LOCALS): {
+                const Value a = slots[*ip++];
+                const Value b = slots[*ip++];
+                if (!add(a, b, *stack_top, stack_top)) {
+                    LOX_VM_ERROR(numbers_or_strings_expected);
+                }
+                ++stack_top;
+                LOX_VM_NEXT();
+            }
+            LOX_VM_CASE(OP_SUBTRACT_LOCALS): {
+                const Value a = slots[*ip++];
+                const Value b = slots[*ip++];
+                if (!number_operation(a, b, std::minus<>{}, *stack_top)) {
+                    LOX_VM_ERROR(numbers_expected);
+                }
+                ++stack_top;
+                LOX_VM_NEXT();
+            }
+            LOX_VM_CASE(OP_MULTIPLY_LOCALS): {
+                const Value a = slots[*ip++];
+                const Value b = slots[*ip++];
+                if (!number_operation(a, b, std::multiplies<>{}, *stack_top)) {
+                    LOX_VM_ERROR(numbers_expected);
+                }
+                ++stack_top;
+                LOX_VM_NEXT();
             }
+            LOX_VM_CASE(OP_DIVIDE_LOCALS): {
+                const Value a = slots[*ip++];
+                const Value b = slots[*ip++];
+                if (!number_operation(a, b, std::divides<>{}, *stack_top)) {
+                    LOX_VM_ERROR(numbers_expected);
+                }
+                ++stack_top;
+                LOX_VM_NEXT();
             }
+            LOX_VM_CASE(OP_EQUAL_JUMP_IF_FALSE): {
+                const auto offset = read_short(ip);
+                stack_top[-2] = Value::boolean(stack_top[-2] == stack_top[-1]);
+                if ((--stack_top)[-1].is_falsey()) {
+                    ip += offset;
+                }
+                LOX_VM_NEXT();
+            }
+            LOX_VM_CASE(OP_GREATER_JUMP_IF_FALSE): {
+                const auto offset = read_short(ip);
+                if (!binary_operation(stack_top, std::greater<>{})) {
+                    LOX_VM_ERROR(numbers_expected);
+                }
+                if ((--stack_top)[-1].is_falsey()) {
+                    ip += offset;
+                }
+                LOX_VM_NEXT();
+            }
+            LOX_VM_CASE(OP_LESS_JUMP_IF_FALSE): {
+                const auto offset = read_short(ip);
+                if (!binary_operation(stack_top, std::less<>{})) {
+                    LOX_VM_ERROR(numbers_expected);
+                }
+                if ((--stack_top)[-1].is_falsey()) {
+                    ip += offset;
+                }
+                LOX_VM_NEXT();
+            }
+#if !LOX_THREADED_DISPATCH
+            default:
+                LOX_VM_ERROR(std::format("Unknown opcode {}.", instruction));
+            }
+#endif
+        }
+
+#undef LOX_VM_NEXT
+#undef LOX_VM_CASE
+#undef LOX_VM_ERROR
+#undef LOX_VM_LOAD_FRAME
+#undef LOX_VM_TRACE
+    }
+
+    auto VirtualMachine::add(const Value a, const Value b, Value &result, Value *const top) noexcept -> bool {
+        if (a.is_number() && b.is_number()) {
+            result = Value::number(a.as_number() + b.as_number());
+            return true;
+        }
+        if (is_string(a) && is_string(b)) {
+            m_stack_top = top;
+            result = Value::object(m_heap.intern(as_string(a)->chars + as_string(b)->chars));
+            return true;
         }
+        return false;
+    }
+
+    auto VirtualMachine::call_value(const Value callee, const int arg_count) noexcept -> bool {
+        if (callee.is_object()) {
+            switch (callee.as_object()->type) {
+            case ObjType::closure:
+                return call(static_cast<ObjClosure *>(callee.as_object()), arg_count);
+            case ObjType::native: {
+                const auto *const native = static_cast<ObjNative *>(callee.as_object());
+                if (arg_count != native->arity) {
+                    runtime_error(std::format("Expected {} arguments but got {}.", native->arity, arg_count));
+                    return false;
+                }
+                auto *const arguments = m_stack_top - arg_count;
+                const Value result = native->function(std::span<const Value>{arguments, m_stack_top});
+                m_stack_top = arguments - 1;
+                push(result);
+                return true;
+            }
+            default:
+                break;
+            }
+        }
+        runtime_error("Can only call functions and classes.");
+        return false;
+    }
+
+    auto VirtualMachine::call(ObjClosure *closure, const int arg_count) noexcept -> bool {
+        if (arg_count != closure->function->arity) {
+            runtime_error(std::format("Expected {} arguments but got {}.", closure->function->arity, arg_count));
+            return false;
+        }
+        if (m_frames.size() == FRAMES_MAX) {
+            runtime_error("Stack overflow.");
+            return false;
+        }
+        // The only stack check a call makes: the body then pushes without bounds checks.
+        const auto slots = stack_size() - static_cast<size_t>(arg_count) - 1;
+        if (slots + closure->function->chunk.max_stack() > STACK_MAX) {
+            runtime_error("Stack overflow.");
+            return false;
+        }
+        m_frames.push_back(CallFrame{.closure = closure, .ip = closure->function->chunk.code().data(), .slots = slots});
+        return true;
+    }
+
+    auto VirtualMachine::capture_upvalue(const size_t slot) -> ObjUpvalue * {
+        ObjUpvalue *previous = nullptr;
+        auto *upvalue = m_open_upvalues;
+        while (upvalue != nullptr && upvalue->slot > slot) {
+            previous = upvalue;
+            upvalue = upvalue->next_open;
+        }
+        if (upvalue != nullptr && upvalue->slot == slot) {
+            return upvalue;
+        }
+
+        auto *const created = m_heap.new_upvalue(slot);
+        created->next_open = upvalue;
+        (previous == nullptr ? m_open_upvalues : previous->next_open) = created;
+        return created;
+    }
+
+    auto VirtualMachine::close_upvalues(const size_t last) noexcept -> void {
+        while (m_open_upvalues != nullptr && m_open_upvalues->slot >= last) {
+            auto *const upvalue = m_open_upvalues;
+            upvalue->closed = m_stack[upvalue->slot];
+            upvalue->is_closed = true;
+            m_open_upvalues = upvalue->next_open;
+            upvalue->next_open = nullptr;
+        }
+    }
+
+    auto VirtualMachine::define_native(const std::string_view name, const NativeFn function, const int arity)
+        -> void {
+        // The name is rooted through the globals before the native is allocated.
+        const auto slot = m_globals.slot(m_heap.intern(name));
+        m_globals[slot] = Value::object(m_heap.new_native(function, arity));
+    }
+
+    auto VirtualMachine::mark_roots(Heap &heap) const -> void {
+        for (const auto *slot = m_stack.get(); slot != m_stack_top; ++slot) {
+            heap.mark_value(*slot);
+        }
+        for (const auto &frame : m_frames) {
+            heap.mark_object(frame.closure);
+        }
+        for (auto *upvalue = m_open_upvalues; upvalue != nullptr; upvalue = upvalue->next_open) {
+            heap.mark_object(upvalue);
+        }
+        m_globals.mark(heap);
+    }
+
+    auto VirtualMachine::runtime_error(const std::string_view message) noexcept -> void {
+        std::println(m_err, "{}", message);
+
+        for (auto frame = m_frames.rbegin(); frame != m_frames.rend(); ++frame) {
+            const auto *const function = frame->closure->function;
+            // ip has moved past the failing instruction's opcode, so step back into it.
+            const auto code_offset = static_cast<size_t>(frame->ip - function->chunk.code().data()) - 1;
+            const auto offset = function->chunk.source_map().source_offset(code_offset);
+            const auto where = function->name == nullptr ? std::string{"script"}
+                                                         : std::format("{}()", function->name->chars);
+            if (m_source != nullptr) {
+                std::println(m_err, "[line {}] in {}", m_source->locate(offset).line, where);
+            } else {
+                std::println(m_err, "[offset {}] in {}", offset, where);
+            }
+        }
+
+        reset_stack();
     }
 
-    [[nodiscard]] auto VirtualMachine::read_byte() noexcept -> uint8_t { return m_chunks.back().code[ip++]; }
-    [[nodiscard]] auto VirtualMachine::read_constant() noexcept -> Value {
-        return m_chunks.back().constants[read_byte()];
+    auto VirtualMachine::reset_stack() noexcept -> void {
+        m_stack_top = m_stack.get();
+        m_frames.clear();
+        m_open_upvalues = nullptr;
     }
 
 } // namespace lox::vm
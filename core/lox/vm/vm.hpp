@@ -1,24 +1,39 @@
 #ifndef LOX_VM_VM_HPP
 #define LOX_VM_VM_HPP
 
+#include "lox/syntax/source.hpp"
 #include "lox/vm/chunk.hpp"
-
-#include <spdlog/spdlog.h>
-
+#include "lox/vm/common.hpp"
+#include "lox/vm/globals.hpp"
+#include "lox/vm/object.hpp"
+#include "lox/vm/value.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string_view>
+#include <type_traits>
 #include <vector>
 
 namespace lox::vm {
 
-    constexpr size_t STACK_MAX = 256;
+    constexpr size_t FRAMES_MAX = 64;
+    constexpr size_t STACK_MAX = FRAMES_MAX * UINT8_COUNT;
 
     enum class InterpretResult : uint8_t { ok, compile_error, runtime_error };
 
     [[nodiscard]] auto interpret_result_to_string(InterpretResult result) noexcept -> std::string_view;
 
+    /// Whether the VM was built to dispatch through a computed-goto table rather than a switch; see LOX_COMPUTED_GOTO.
+    [[nodiscard]] auto threaded_dispatch() noexcept -> bool;
+
     class VirtualMachine final {
 
     public:
-        VirtualMachine();
+        /// Creates a VM that prints program output to @p out and runtime errors to @p err, collecting garbage as
+        /// @p gc says.
+        explicit VirtualMachine(std::FILE *out = stdout, std::FILE *err = stderr, GcSettings gc = {});
         ~VirtualMachine() = default;
 
         VirtualMachine(const VirtualMachine &) = delete;
@@ -27,30 +42,101 @@ namespace lox::vm {
         auto operator=(VirtualMachine &&) -> VirtualMachine & = delete;
 
         [[nodiscard]] auto interpret(std::string_view source) noexcept -> InterpretResult;
+        /// Compiles and runs @p file. Compiled code borrows from the file, so it must outlive the VM.
+        [[nodiscard]] auto interpret(const syntax::SourceFile &file) noexcept -> InterpretResult;
+
+        [[nodiscard]] auto heap_stats() const noexcept -> const HeapStats & { return m_heap.stats(); }
 
     private:
+        friend class Heap;
+
+        /// An in-progress call: the closure running, its next instruction and where its stack window starts. run()
+        /// works from local copies of the running frame's ip and stack window and only writes ip back here before
+        /// anything that reads it: a call, which pushes a frame above it, or a runtime error's stack trace.
+        struct CallFrame {
+            ObjClosure *closure;
+            const std::uint8_t *ip;
+            size_t slots;
+        };
+
         [[nodiscard]] auto run() noexcept -> InterpretResult;
 
-        [[nodiscard]] auto read_byte() noexcept -> uint8_t;
-        [[nodiscard]] auto read_constant() noexcept -> Value;
+        // Unchecked: call() made sure the frame has room for its chunk's max_stack, and verify() that no chunk
+        // pops more than it pushed. run() keeps its own copy of the stack top and spills it to m_stack_top before
+        // calling anything that uses these.
+        auto push(Value value) noexcept -> void { *m_stack_top++ = value; }
+        auto pop() noexcept -> Value { return *--m_stack_top; }
+        [[nodiscard]] auto peek(size_t distance) const noexcept -> Value {
+            return *(m_stack_top - 1 - distance);
+        }
+        /// The number of values on the stack, which is also the index of the next free slot.
+        [[nodiscard]] auto stack_size() const noexcept -> size_t {
+            return static_cast<size_t>(m_stack_top - m_stack.get());
+        }
+
+        [[nodiscard]] auto call_value(Value callee, int arg_count) noexcept -> bool;
+        [[nodiscard]] auto call(ObjClosure *closure, int arg_count) noexcept -> bool;
+
+        /// Returns the open upvalue for stack slot @p slot, creating it if no closure has captured the slot yet.
+        [[nodiscard]] auto capture_upvalue(size_t slot) -> ObjUpvalue *;
+        /// Closes every open upvalue at or above stack slot @p last, copying the variables off the stack.
+        auto close_upvalues(size_t last) noexcept -> void;
+        [[nodiscard]] auto upvalue_value(ObjUpvalue &upvalue) noexcept -> Value & {
+            return upvalue.is_closed ? upvalue.closed : m_stack[upvalue.slot];
+        }
+
+        /// Verifies @p function, the compiled script, then wraps it in a closure and runs it.
+        [[nodiscard]] auto run_script(ObjFunction *function) noexcept -> InterpretResult;
+        auto define_native(std::string_view name, NativeFn function, int arity) -> void;
+
+        /// Marks the stack, the frames' closures, the open upvalues and the globals.
+        auto mark_roots(Heap &heap) const -> void;
+
+        /// Reports a runtime error with a stack trace and unwinds the VM. Every frame's ip must be up to date.
+        auto runtime_error(std::string_view message) noexcept -> void;
+        auto reset_stack() noexcept -> void;
+
+        // The operations below leave reporting a type error to run(), which first has to write its ip back to the
+        // frame for the stack trace; they only say whether the operands had the right types.
 
-        template <typename BinOp> auto perform_binary_operation(BinOp op) noexcept -> void {
-            if (m_stack.size() < 2) {
-                spdlog::error("Stack underflow");
-                return;
+        /// Stores @p a + @p b in @p result for two numbers or two strings; false for any other operands. Joining
+        /// strings allocates, so it first publishes @p top, run()'s stack top, for the collector to mark.
+        [[nodiscard]] auto add(Value a, Value b, Value &result, Value *top) noexcept -> bool;
+
+        /// Stores @p op applied to two numbers in @p result; false if either operand is not a number.
+        template <typename BinOp>
+        [[nodiscard]] static auto number_operation(const Value a, const Value b, BinOp op, Value &result) noexcept
+            -> bool {
+            if (!a.is_number() || !b.is_number()) {
+                return false;
+            }
+            if constexpr (std::is_same_v<decltype(op(a.as_number(), b.as_number())), bool>) {
+                result = Value::boolean(op(a.as_number(), b.as_number()));
+            } else {
+                result = Value::number(op(a.as_number(), b.as_number()));
             }
-            const Value b = m_stack.back();
-            m_stack.pop_back();
-            const Value a = m_stack.back();
-            m_stack.pop_back();
-            const Value result = op(a, b);
-            m_stack.push_back(result);
+            return true;
         }
 
-    private:
-        size_t ip;
-        std::vector<Chunk> m_chunks;
-        std::vector<Value> m_stack;
+        /// Applies @p op to the two values below @p top, overwriting the left operand; the caller drops the right.
+        template <typename BinOp> [[nodiscard]] static auto binary_operation(Value *top, BinOp op) noexcept -> bool {
+            return number_operation(top[-2], top[-1], op, top[-2]);
+        }
+
+        std::FILE *m_out;
+        std::FILE *m_err;
+        Heap m_heap;
+        std::vector<CallFrame> m_frames;
+        /// The operand stack, STACK_MAX slots shared by all frames and never reallocated; the live part ends at
+        /// @c m_stack_top. It is a separate allocation rather than an inline array: keeping it inside the VM object
+        /// next to the call frames measured twice as slow.
+        std::unique_ptr<Value[]> m_stack = std::make_unique<Value[]>(STACK_MAX);
+        Value *m_stack_top = m_stack.get();
+        Globals m_globals;
+        /// Upvalues still referring to the stack, ordered by decreasing slot.
+        ObjUpvalue *m_open_upvalues = nullptr;
+        /// The script being run, for mapping code offsets to lines; null for in-memory source.
+        const syntax::SourceFile *m_source = nullptr;
     };
 
 } // namespace lox::vm
@@ -1,15 +1,20 @@
 #include "lox/ast/expr.hpp"
+#include "lox/ast/fold.hpp"
 #include "lox/ast/parse.hpp"
+#include "lox/ast/resolve.hpp"
 #include "lox/ast/stmt.hpp"
 #include "lox/syntax/lex.hpp"
+#include "lox/syntax/source.hpp"
 #include "lox/syntax/token.hpp"
 
+#include <cstddef>
 #include <cstdlib>
 #include <exception>
 #include <format>
 #include <print>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -43,19 +48,19 @@ static auto test_parse_literal_expression() -> bool {
         return false;
     }
 
-    const auto &statements = result.value();
+    const auto statements = result.value().statements();
     if (statements.size() != 1) {
         std::print("Expected 1 statement, got {}\n", statements.size());
         return false;
     }
 
-    const auto *expr_stmt = dynamic_cast<const lox::ast::ExpressionStatement *>(statements[0].get());
+    const auto *expr_stmt = lox::ast::as<lox::ast::ExpressionStatement>(statements[0]);
     if (!expr_stmt) {
         std::print("Expected expression statement\n");
         return false;
     }
 
-    const auto *literal = dynamic_cast<const lox::ast::LiteralExpression *>(expr_stmt->expression.get());
+    const auto *literal = lox::ast::as<lox::ast::LiteralExpression>(expr_stmt->expression);
     if (!literal) {
         std::print("Expected literal expression\n");
         return false;
@@ -80,19 +85,19 @@ static auto test_parse_binary_expression() -> bool {
         return false;
     }
 
-    const auto &statements = result.value();
+    const auto statements = result.value().statements();
     if (statements.size() != 1) {
         std::print("Expected 1 statement, got {}\n", statements.size());
         return false;
     }
 
-    const auto *expr_stmt = dynamic_cast<const lox::ast::ExpressionStatement *>(statements[0].get());
+    const auto *expr_stmt = lox::ast::as<lox::ast::ExpressionStatement>(statements[0]);
     if (!expr_stmt) {
         std::print("Expected expression statement\n");
         return false;
     }
 
-    const auto *binary = dynamic_cast<const lox::ast::BinaryExpression *>(expr_stmt->expression.get());
+    const auto *binary = lox::ast::as<lox::ast::BinaryExpression>(expr_stmt->expression);
     if (!binary) {
         std::print("Expected binary expression\n");
         return false;
@@ -116,19 +121,19 @@ static auto test_parse_unary_expression() -> bool {
         return false;
     }
 
-    const auto &statements = result.value();
+    const auto statements = result.value().statements();
     if (statements.size() != 1) {
         std::print("Expected 1 statement, got {}\n", statements.size());
         return false;
     }
 
-    const auto *expr_stmt = dynamic_cast<const lox::ast::ExpressionStatement *>(statements[0].get());
+    const auto *expr_stmt = lox::ast::as<lox::ast::ExpressionStatement>(statements[0]);
     if (!expr_stmt) {
         std::print("Expected expression statement\n");
         return false;
     }
 
-    const auto *unary = dynamic_cast<const lox::ast::UnaryExpression *>(expr_stmt->expression.get());
+    const auto *unary = lox::ast::as<lox::ast::UnaryExpression>(expr_stmt->expression);
     if (!unary) {
         std::print("Expected unary expression\n");
         return false;
@@ -152,25 +157,25 @@ static auto test_parse_grouping_expression() -> bool {
         return false;
     }
 
-    const auto &statements = result.value();
+    const auto statements = result.value().statements();
     if (statements.size() != 1) {
         std::print("Expected 1 statement, got {}\n", statements.size());
         return false;
     }
 
-    const auto *expr_stmt = dynamic_cast<const lox::ast::ExpressionStatement *>(statements[0].get());
+    const auto *expr_stmt = lox::ast::as<lox::ast::ExpressionStatement>(statements[0]);
     if (!expr_stmt) {
         std::print("Expected expression statement\n");
         return false;
     }
 
-    const auto *binary = dynamic_cast<const lox::ast::BinaryExpression *>(expr_stmt->expression.get());
+    const auto *binary = lox::ast::as<lox::ast::BinaryExpression>(expr_stmt->expression);
     if (!binary) {
         std::print("Expected binary expression\n");
         return false;
     }
 
-    const auto *grouping = dynamic_cast<const lox::ast::GroupingExpression *>(binary->left.get());
+    const auto *grouping = lox::ast::as<lox::ast::GroupingExpression>(binary->left);
     if (!grouping) {
         std::print("Expected grouping expression on left side\n");
         return false;
@@ -189,13 +194,13 @@ static auto test_parse_variable_declaration() -> bool {
         return false;
     }
 
-    const auto &statements = result.value();
+    const auto statements = result.value().statements();
     if (statements.size() != 1) {
         std::print("Expected 1 statement, got {}\n", statements.size());
         return false;
     }
 
-    const auto *var_stmt = dynamic_cast<const lox::ast::VarStatement *>(statements[0].get());
+    const auto *var_stmt = lox::ast::as<lox::ast::VarStatement>(statements[0]);
     if (!var_stmt) {
         std::print("Expected variable statement\n");
         return false;
@@ -224,19 +229,19 @@ static auto test_parse_assignment_expression() -> bool {
         return false;
     }
 
-    const auto &statements = result.value();
+    const auto statements = result.value().statements();
     if (statements.size() != 1) {
         std::print("Expected 1 statement, got {}\n", statements.size());
         return false;
     }
 
-    const auto *expr_stmt = dynamic_cast<const lox::ast::ExpressionStatement *>(statements[0].get());
+    const auto *expr_stmt = lox::ast::as<lox::ast::ExpressionStatement>(statements[0]);
     if (!expr_stmt) {
         std::print("Expected expression statement\n");
         return false;
     }
 
-    const auto *assignment = dynamic_cast<const lox::ast::AssignmentExpression *>(expr_stmt->expression.get());
+    const auto *assignment = lox::ast::as<lox::ast::AssignmentExpression>(expr_stmt->expression);
     if (!assignment) {
         std::print("Expected assignment expression\n");
         return false;
@@ -260,19 +265,19 @@ static auto test_parse_print_statement() -> bool {
         return false;
     }
 
-    const auto &statements = result.value();
+    const auto statements = result.value().statements();
     if (statements.size() != 1) {
         std::print("Expected 1 statement, got {}\n", statements.size());
         return false;
     }
 
-    const auto *print_stmt = dynamic_cast<const lox::ast::PrintStatement *>(statements[0].get());
+    const auto *print_stmt = lox::ast::as<lox::ast::PrintStatement>(statements[0]);
     if (!print_stmt) {
         std::print("Expected print statement\n");
         return false;
     }
 
-    const auto *literal = dynamic_cast<const lox::ast::LiteralExpression *>(print_stmt->expression.get());
+    const auto *literal = lox::ast::as<lox::ast::LiteralExpression>(print_stmt->expression);
     if (!literal) {
         std::print("Expected literal expression in print statement\n");
         return false;
@@ -291,13 +296,13 @@ static auto test_parse_if_statement() -> bool {
         return false;
     }
 
-    const auto &statements = result.value();
+    const auto statements = result.value().statements();
     if (statements.size() != 1) {
         std::print("Expected 1 statement, got {}\n", statements.size());
         return false;
     }
 
-    const auto *if_stmt = dynamic_cast<const lox::ast::IfStatement *>(statements[0].get());
+    const auto *if_stmt = lox::ast::as<lox::ast::IfStatement>(statements[0]);
     if (!if_stmt) {
         std::print("Expected if statement\n");
         return false;
@@ -331,13 +336,13 @@ static auto test_parse_while_statement() -> bool {
         return false;
     }
 
-    const auto &statements = result.value();
+    const auto statements = result.value().statements();
     if (statements.size() != 1) {
         std::print("Expected 1 statement, got {}\n", statements.size());
         return false;
     }
 
-    const auto *while_stmt = dynamic_cast<const lox::ast::WhileStatement *>(statements[0].get());
+    const auto *while_stmt = lox::ast::as<lox::ast::WhileStatement>(statements[0]);
     if (!while_stmt) {
         std::print("Expected while statement\n");
         return false;
@@ -366,13 +371,13 @@ static auto test_parse_function_declaration() -> bool {
         return false;
     }
 
-    const auto &statements = result.value();
+    const auto statements = result.value().statements();
     if (statements.size() != 1) {
         std::print("Expected 1 statement, got {}\n", statements.size());
         return false;
     }
 
-    const auto *fun_stmt = dynamic_cast<const lox::ast::FunctionDeclarationStatement *>(statements[0].get());
+    const auto *fun_stmt = lox::ast::as<lox::ast::FunctionDeclarationStatement>(statements[0]);
     if (!fun_stmt) {
         std::print("Expected function declaration statement\n");
         return false;
@@ -406,13 +411,13 @@ static auto test_parse_block_statement() -> bool {
         return false;
     }
 
-    const auto &statements = result.value();
+    const auto statements = result.value().statements();
     if (statements.size() != 1) {
         std::print("Expected 1 statement, got {}\n", statements.size());
         return false;
     }
 
-    const auto *block_stmt = dynamic_cast<const lox::ast::BlockStatement *>(statements[0].get());
+    const auto *block_stmt = lox::ast::as<lox::ast::BlockStatement>(statements[0]);
     if (!block_stmt) {
         std::print("Expected block statement\n");
         return false;
@@ -436,19 +441,19 @@ static auto test_parse_logical_expression() -> bool {
         return false;
     }
 
-    const auto &statements = result.value();
+    const auto statements = result.value().statements();
     if (statements.size() != 1) {
         std::print("Expected 1 statement, got {}\n", statements.size());
         return false;
     }
 
-    const auto *expr_stmt = dynamic_cast<const lox::ast::ExpressionStatement *>(statements[0].get());
+    const auto *expr_stmt = lox::ast::as<lox::ast::ExpressionStatement>(statements[0]);
     if (!expr_stmt) {
         std::print("Expected expression statement\n");
         return false;
     }
 
-    const auto *logical = dynamic_cast<const lox::ast::LogicalExpression *>(expr_stmt->expression.get());
+    const auto *logical = lox::ast::as<lox::ast::LogicalExpression>(expr_stmt->expression);
     if (!logical) {
         std::print("Expected logical expression\n");
         return false;
@@ -462,6 +467,382 @@ static auto test_parse_logical_expression() -> bool {
     return true;
 }
 
+static auto test_parse_call_expression() -> bool {
+    const auto source = "add(1, 2 * 3) == 7;";
+    auto parser = lox::ast::Parser(source);
+
+    auto result = parser.parse();
+    if (!result) {
+        std::print("Parse error: {}\n", result.error());
+        return false;
+    }
+
+    const auto statements = result.value().statements();
+    if (statements.size() != 1) {
+        std::print("Expected 1 statement, got {}\n", statements.size());
+        return false;
+    }
+
+    const auto *expr_stmt = lox::ast::as<lox::ast::ExpressionStatement>(statements[0]);
+    if (!expr_stmt) {
+        std::print("Expected expression statement\n");
+        return false;
+    }
+
+    const auto *equality = lox::ast::as<lox::ast::BinaryExpression>(expr_stmt->expression);
+    if (!equality || equality->operator_token.kind != lox::syntax::TokenKind::equal_equal) {
+        std::print("Expected '==' at top level\n");
+        return false;
+    }
+
+    const auto *call = lox::ast::as<lox::ast::CallExpression>(equality->left);
+    if (!call) {
+        std::print("Expected call expression on left side\n");
+        return false;
+    }
+
+    if (call->arguments.size() != 2) {
+        std::print("Expected 2 arguments, got {}\n", call->arguments.size());
+        return false;
+    }
+
+    return true;
+}
+
+static auto test_parse_reports_lex_error() -> bool {
+    const auto source = "var x = 1; print x @ 2;";
+    auto parser = lox::ast::Parser(source);
+
+    auto result = parser.parse();
+    if (result) {
+        std::print("Expected lex error, got {} statements\n", result.value().size());
+        return false;
+    }
+
+    if (result.error().find("Unexpected character '@'") == std::string::npos) {
+        std::print("Expected unexpected character error, got '{}'\n", result.error());
+        return false;
+    }
+
+    return true;
+}
+
+static auto test_parse_lex_error_after_last_statement() -> bool {
+    const auto source = "print 1; \"unterminated";
+    auto parser = lox::ast::Parser(source);
+
+    auto result = parser.parse();
+    if (result) {
+        std::print("Expected lex error, got {} statements\n", result.value().size());
+        return false;
+    }
+
+    if (result.error() != "Unterminated string literal") {
+        std::print("Expected unterminated string error, got '{}'\n", result.error());
+        return false;
+    }
+
+    return true;
+}
+
+static auto test_parse_error_reports_line() -> bool {
+    lox::syntax::SourceManager sources;
+    const auto &file = sources.add("bad.lox", "var a = 1;\nprint a +;\n");
+    auto parser = lox::ast::Parser(file);
+
+    auto result = parser.parse();
+    if (result) {
+        std::print("Expected parse error, got {} statements\n", result.value().size());
+        return false;
+    }
+
+    if (!result.error().starts_with("bad.lox:2:10: ")) {
+        std::print("Expected error located at bad.lox:2:10, got '{}'\n", result.error());
+        return false;
+    }
+
+    return true;
+}
+
+static auto test_parse_assignment_error_reports_line() -> bool {
+    lox::syntax::SourceManager sources;
+    const auto &file = sources.add("bad.lox", "var a = 1;\n1 = a;\n");
+    auto parser = lox::ast::Parser(file);
+
+    auto result = parser.parse();
+    if (result) {
+        std::print("Expected parse error, got {} statements\n", result.value().size());
+        return false;
+    }
+
+    if (!result.error().starts_with("bad.lox:2:3: ") || !result.error().ends_with("Invalid assignment target")) {
+        std::print("Expected invalid assignment target at bad.lox:2:3, got '{}'\n", result.error());
+        return false;
+    }
+
+    return true;
+}
+
+namespace {
+
+    /// Records one letter per node in pre-order: upper case for expressions, lower case for statements.
+    struct KindRecorder {
+        std::string order;
+
+        void expr(const lox::ast::Expression *node) { lox::ast::visit(*node, *this); }
+        void stmt(const lox::ast::Statement *node) { lox::ast::visit(*node, *this); }
+
+        void operator()(const lox::ast::BinaryExpression &node) {
+            order += 'B';
+            expr(node.left);
+            expr(node.right);
+        }
+        void operator()(const lox::ast::UnaryExpression &node) {
+            order += 'U';
+            expr(node.operand);
+        }
+        void operator()(const lox::ast::GroupingExpression &node) {
+            order += 'G';
+            expr(node.expression);
+        }
+        void operator()(const lox::ast::LiteralExpression &) { order += 'L'; }
+        void operator()(const lox::ast::VariableExpression &) { order += 'V'; }
+        void operator()(const lox::ast::AssignmentExpression &node) {
+            order += 'A';
+            expr(node.value);
+        }
+        void operator()(const lox::ast::LogicalExpression &node) {
+            order += 'O';
+            expr(node.left);
+            expr(node.right);
+        }
+        void operator()(const lox::ast::CallExpression &node) {
+            order += 'C';
+            expr(node.callee);
+            for (const auto *argument : node.arguments) {
+                expr(argument);
+            }
+        }
+
+        void operator()(const lox::ast::ExpressionStatement &node) {
+            order += 'e';
+            expr(node.expression);
+        }
+        void operator()(const lox::ast::PrintStatement &node) {
+            order += 'p';
+            expr(node.expression);
+        }
+        void operator()(const lox::ast::VarStatement &) { order += 'v'; }
+        void operator()(const lox::ast::BlockStatement &node) {
+            order += 'b';
+            for (const auto *inner : node.statements) {
+                stmt(inner);
+            }
+        }
+        void operator()(const lox::ast::IfStatement &node) {
+            order += 'i';
+            expr(node.condition);
+            stmt(node.then_branch);
+            stmt(node.else_branch);
+        }
+        void operator()(const lox::ast::WhileStatement &node) {
+            order += 'w';
+            expr(node.condition);
+            stmt(node.body);
+        }
+        void operator()(const lox::ast::ForStatement &) { order += 'f'; }
+        void operator()(const lox::ast::ReturnStatement &node) {
+            order += 'r';
+            expr(node.value);
+        }
+        void operator()(const lox::ast::FunctionDeclarationStatement &node) {
+            order += 'd';
+            for (const auto *inner : node.body) {
+                stmt(inner);
+            }
+        }
+    };
+
+} // namespace
+
+// Every node kind must reach the visitor as its own type, including nodes nested inside lists.
+static auto test_visit_dispatches_on_kind() -> bool {
+    const auto source = "fun f(a) { while (a and true) { a = -a; } return (a + 1); }"
+                        "if (f(2)) print f; else { var x; }";
+    auto parser = lox::ast::Parser(source);
+
+    auto result = parser.parse();
+    if (!result) {
+        std::print("Parse failed: {}\n", result.error());
+        return false;
+    }
+
+    KindRecorder recorder;
+    for (const auto *stmt : result.value().statements()) {
+        recorder.stmt(stmt);
+    }
+
+    if (const std::string expected = "dwOVLbeAUVrGBVLiCVLpVbv"; recorder.order != expected) {
+        std::print("Expected visit order '{}', got '{}'\n", expected, recorder.order);
+        return false;
+    }
+
+    return true;
+}
+
+static auto test_fold_constant_expressions() -> bool {
+    const auto source = R"(print (1 + 2) * -3; print "a" + "b" == "ab"; print !nil or x; print 1 <= 0 / 0;)"
+                        R"(print -"s";)";
+    auto parser = lox::ast::Parser(source);
+
+    auto result = parser.parse();
+    if (!result) {
+        std::print("Parse error: {}\n", result.error());
+        return false;
+    }
+
+    const auto stats = lox::ast::fold_constants(result.value());
+    const auto statements = result.value().statements();
+
+    // 0 / 0 is NaN, and `<=` is `!(a > b)` in the VM, so it folds to true rather than false.
+    const std::vector<std::string_view> expected = {"-9", "true", "true", "true"};
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        const auto *print = lox::ast::as<lox::ast::PrintStatement>(statements[i]);
+        const auto *literal = lox::ast::as<lox::ast::LiteralExpression>(print->expression);
+        if (literal == nullptr || literal->value.lexeme != expected[i]) {
+            std::print("Statement {}: expected literal '{}', got {}\n", i, expected[i], print->expression->to_string());
+            return false;
+        }
+    }
+
+    // Negating a string fails at run time, so it must survive folding.
+    const auto *last = lox::ast::as<lox::ast::PrintStatement>(statements[4]);
+    if (lox::ast::as<lox::ast::UnaryExpression>(last->expression) == nullptr) {
+        std::print("Expected -\"s\" to be left unfolded\n");
+        return false;
+    }
+
+    // (1 + 2), its grouping, -3, the product; "a" + "b", ==; !nil, or; 0 / 0, <=.
+    if (stats.folded_expressions != 10 || stats.pruned_branches != 0) {
+        std::print("Unexpected stats: {} folded, {} pruned\n", stats.folded_expressions, stats.pruned_branches);
+        return false;
+    }
+
+    return true;
+}
+
+static auto test_fold_prunes_constant_branches() -> bool {
+    const auto source = R"(if (10 <= 20) print "yes"; else print "no"; if (nil) print "no"; while (1 > 2) print "no";)"
+                        R"(while (x) print "kept";)";
+    auto parser = lox::ast::Parser(source);
+
+    auto result = parser.parse();
+    if (!result) {
+        std::print("Parse error: {}\n", result.error());
+        return false;
+    }
+
+    const auto stats = lox::ast::fold_constants(result.value());
+    const auto statements = result.value().statements();
+
+    if (lox::ast::as<lox::ast::PrintStatement>(statements[0]) == nullptr) {
+        std::print("Expected the if to be replaced by its then branch, got {}\n", statements[0]->to_string());
+        return false;
+    }
+    for (const auto index : {1, 2}) {
+        const auto *block = lox::ast::as<lox::ast::BlockStatement>(statements[index]);
+        if (block == nullptr || !block->statements.empty()) {
+            std::print("Expected statement {} to be an empty block, got {}\n", index, statements[index]->to_string());
+            return false;
+        }
+    }
+    if (lox::ast::as<lox::ast::WhileStatement>(statements[3]) == nullptr) {
+        std::print("Expected the loop with a variable condition to be kept\n");
+        return false;
+    }
+
+    if (stats.pruned_branches != 3) {
+        std::print("Expected 3 pruned branches, got {}\n", stats.pruned_branches);
+        return false;
+    }
+
+    return true;
+}
+
+static auto test_resolve_binds_variables() -> bool {
+    const auto source = "var g; fun f(a) { var b; fun h() { return a + b + g; } b = a; }";
+    auto parser = lox::ast::Parser(source);
+
+    auto result = parser.parse();
+    if (!result) {
+        std::print("Parse error: {}\n", result.error());
+        return false;
+    }
+    if (const auto resolved = lox::ast::resolve(result.value()); !resolved) {
+        std::print("Resolve error: {}\n", resolved.error());
+        return false;
+    }
+
+    using Kind = lox::ast::Binding::Kind;
+    const auto *f = lox::ast::as<lox::ast::FunctionDeclarationStatement>(result.value().statements()[1]);
+    const auto *b = lox::ast::as<lox::ast::VarStatement>(f->body[0]);
+    const auto *h = lox::ast::as<lox::ast::FunctionDeclarationStatement>(f->body[1]);
+    const auto *assign = lox::ast::as<lox::ast::AssignmentExpression>(
+        lox::ast::as<lox::ast::ExpressionStatement>(f->body[2])->expression);
+
+    // In f, slot 0 is f itself, then a, b and h. b = a is local to f.
+    const auto *a_read = lox::ast::as<lox::ast::VariableExpression>(assign->value);
+    if (assign->binding.kind != Kind::local || assign->binding.index != 2 || a_read->binding.index != 1) {
+        std::print("Expected b and a to be locals 2 and 1 of f\n");
+        return false;
+    }
+
+    // h captures a and b from f in the order it first uses them, and leaves g global.
+    const auto *sum = lox::ast::as<lox::ast::BinaryExpression>(
+        lox::ast::as<lox::ast::ReturnStatement>(h->body[0])->value);
+    const auto *a_plus_b = lox::ast::as<lox::ast::BinaryExpression>(sum->left);
+    const auto *a = lox::ast::as<lox::ast::VariableExpression>(a_plus_b->left);
+    const auto *b_read = lox::ast::as<lox::ast::VariableExpression>(a_plus_b->right);
+    const auto *g = lox::ast::as<lox::ast::VariableExpression>(sum->right);
+    if (a->binding.kind != Kind::upvalue || a->binding.index != 0 || b_read->binding.kind != Kind::upvalue ||
+        b_read->binding.index != 1 || g->binding.kind != Kind::global) {
+        std::print("Unexpected bindings in h\n");
+        return false;
+    }
+    if (h->upvalues.size() != 2 || !h->upvalues[0].is_local || h->upvalues[0].index != 1 ||
+        h->upvalues[1].index != 2) {
+        std::print("Expected h to capture slots 1 and 2 of f\n");
+        return false;
+    }
+    if (!b->captured || h->captured) {
+        std::print("Expected b, but not h, to be marked captured\n");
+        return false;
+    }
+
+    return true;
+}
+
+static auto test_resolve_reports_scope_errors() -> bool {
+    const auto expect_error = [](const char *source, const std::string_view message) {
+        auto parser = lox::ast::Parser(source);
+        auto result = parser.parse();
+        if (!result) {
+            std::print("Parse error: {}\n", result.error());
+            return false;
+        }
+        const auto resolved = lox::ast::resolve(result.value());
+        if (resolved || resolved.error().find(message) == std::string::npos) {
+            std::print("Expected an error containing '{}' for: {}\n", message, source);
+            return false;
+        }
+        return true;
+    };
+
+    return expect_error("{ var a = 1; { var a = a; } }", "own initializer") &&
+           expect_error("fun f() { var x; fun g() { var y = x; var y; } }", "Already a variable") &&
+           expect_error("{ return; }", "Can't return from top-level code.");
+}
+
 auto main() noexcept -> int {
     const std::vector<std::pair<std::string, bool (*)()>> tests = {
         {"parse_literal_expression", test_parse_literal_expression},
@@ -475,7 +856,17 @@ auto main() noexcept -> int {
         {"parse_while_statement", test_parse_while_statement},
         {"parse_function_declaration", test_parse_function_declaration},
         {"parse_block_statement", test_parse_block_statement},
-        {"parse_logical_expression", test_parse_logical_expression}};
+        {"parse_logical_expression", test_parse_logical_expression},
+        {"parse_call_expression", test_parse_call_expression},
+        {"parse_reports_lex_error", test_parse_reports_lex_error},
+        {"parse_lex_error_after_last_statement", test_parse_lex_error_after_last_statement},
+        {"parse_error_reports_line", test_parse_error_reports_line},
+        {"parse_assignment_error_reports_line", test_parse_assignment_error_reports_line},
+        {"visit_dispatches_on_kind", test_visit_dispatches_on_kind},
+        {"fold_constant_expressions", test_fold_constant_expressions},
+        {"fold_prunes_constant_branches", test_fold_prunes_constant_branches},
+        {"resolve_binds_variables", test_resolve_binds_variables},
+        {"resolve_reports_scope_errors", test_resolve_reports_scope_errors}};
 
     int failed_tests = 0;
     for (const auto &[name, test_func] : tests) {
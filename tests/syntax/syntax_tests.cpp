@@ -1,12 +1,25 @@
 #include "lox/syntax/lex.hpp"
+#include "lox/syntax/line_index.hpp"
+#include "lox/syntax/location.hpp"
+#include "lox/syntax/scan_kernels.hpp"
+#include "lox/syntax/source.hpp"
 #include "lox/syntax/token.hpp"
 
+#include <cstddef>
 #include <cstdlib>
+#include <filesystem>
 #include <format>
+#include <fstream>
 #include <iostream>
 #include <stdexcept>
+#include <string>
+#include <string_view>
 #include <vector>
 
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
 static auto test_lex_simple_snippet() -> std::vector<lox::syntax::Token> {
     const auto snippet = "var meaningOfLife = 42;";
     auto scanner = lox::syntax::Scanner(snippet);
@@ -27,6 +40,220 @@ static auto test_lex_simple_snippet() -> std::vector<lox::syntax::Token> {
     return tokens;
 }
 
+static auto lex_all(const std::string_view source, const lox::syntax::ScanKernels &kernels)
+    -> std::vector<lox::syntax::Token> {
+    auto scanner = lox::syntax::Scanner(source, kernels);
+    std::vector<lox::syntax::Token> tokens;
+
+    while (true) {
+        const auto token = scanner.get_next_token();
+        if (!token.has_value()) {
+            throw std::runtime_error(std::format("Lexing error: {}", token.error()));
+        }
+        tokens.push_back(token.value());
+        if (token.value().kind == lox::syntax::TokenKind::end_of_file) {
+            break;
+        }
+    }
+
+    return tokens;
+}
+
+// Every kernel the CPU supports must find the same run end as the scalar reference for runs that end at every
+// position relative to the 16- and 32-byte blocks, including runs that reach the end of the input.
+static auto test_scan_kernels_match_scalar() -> bool {
+    const auto &scalar = lox::syntax::scalar_scan_kernels();
+
+    for (const auto *kernels : lox::syntax::supported_scan_kernels()) {
+        struct Case {
+            const char *name;
+            lox::syntax::ScanKernels::RunFn reference;
+            lox::syntax::ScanKernels::RunFn candidate;
+            char fill;
+            std::string_view terminators;
+        };
+        const Case cases[] = {
+            {"skip_whitespace", scalar.skip_whitespace, kernels->skip_whitespace, ' ', "x\x80\x08\x0e;"},
+            {"skip_identifier", scalar.skip_identifier, kernels->skip_identifier, 'a', " \x80`{@[/:;"},
+            {"skip_digits", scalar.skip_digits, kernels->skip_digits, '7', "./:a\xb9"},
+            {"find_string_end", scalar.find_string_end, kernels->find_string_end, 'q', "\""},
+            {"find_newline", scalar.find_newline, kernels->find_newline, 'q', "\n"},
+        };
+
+        for (const auto &c : cases) {
+            for (std::size_t length = 0; length <= 80; ++length) {
+                for (const char terminator : c.terminators) {
+                    std::string input(length, c.fill);
+                    input.push_back(terminator);
+                    input.append(40, c.fill);
+                    for (const auto end : {input.size(), length + 1}) {
+                        const auto *const first = input.data();
+                        if (c.reference(first, first + end) != c.candidate(first, first + end)) {
+                            std::cerr << "Kernel " << c.name << " (" << kernels->name
+                                      << ") disagrees with scalar for run of " << length << " bytes\n";
+                            return false;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+static auto test_scan_kernels_same_token_stream() -> bool {
+    std::string source;
+    for (int i = 0; i < 64; ++i) {
+        const auto run = static_cast<std::size_t>(i);
+        source += std::format("{:{}}var a_rather_long_identifier_{}_name = 1{}.{} * \"{}\";\n", "", i, i,
+                              std::string(run, '9'), i, std::string(run, 's'));
+    }
+
+    const auto expected = lex_all(source, lox::syntax::scalar_scan_kernels());
+
+    for (const auto *kernels : lox::syntax::supported_scan_kernels()) {
+        const auto actual = lex_all(source, *kernels);
+
+        if (expected.size() != actual.size()) {
+            std::cerr << "Expected " << expected.size() << " tokens, got " << actual.size() << " (" << kernels->name
+                      << ")\n";
+            return false;
+        }
+
+        for (std::size_t i = 0; i < expected.size(); ++i) {
+            if (expected[i].to_string() != actual[i].to_string()) {
+                std::cerr << "Token " << i << " differs (" << kernels->name << "): " << expected[i].to_string()
+                          << " vs " << actual[i].to_string() << "\n";
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+static auto test_source_manager_maps_file() -> bool {
+    const auto path = std::filesystem::temp_directory_path() / "lox_source_manager_test.lox";
+    const std::string contents = "var answer = 42;\nprint answer;\n";
+    std::ofstream{path, std::ios::binary} << contents;
+
+    lox::syntax::SourceManager sources;
+    const auto &snippet = sources.add("<snippet>", "1;");
+    const auto file = sources.load(path.string());
+    std::filesystem::remove(path);
+
+    if (!file) {
+        std::cerr << "Failed to load script: " << file.error() << "\n";
+        return false;
+    }
+
+    const auto *const script = file.value();
+    if (script->text() != contents || script->name() != path.string()) {
+        std::cerr << "Loaded script does not match what was written\n";
+        return false;
+    }
+#if defined(__unix__) || defined(__APPLE__)
+    if (!script->is_mapped()) {
+        std::cerr << "Expected a regular file to be memory-mapped\n";
+        return false;
+    }
+#endif
+
+    if (snippet.id() == script->id() || sources.get(script->id()) != script || sources.get(snippet.id()) != &snippet ||
+        sources.get(lox::syntax::FileId::none) != nullptr) {
+        std::cerr << "File IDs are not distinct or do not resolve to their files\n";
+        return false;
+    }
+
+    auto scanner = lox::syntax::Scanner(*script);
+    for (auto token = scanner.get_next_token(); token.has_value(); token = scanner.get_next_token()) {
+        if (token->span.file != script->id()) {
+            std::cerr << "Token " << token->to_string() << " is not tied to its file\n";
+            return false;
+        }
+        if (token->kind == lox::syntax::TokenKind::end_of_file) {
+            return true;
+        }
+    }
+
+    std::cerr << "Lexing the loaded script failed\n";
+    return false;
+}
+
+static auto test_source_manager_reports_missing_file() -> bool {
+    lox::syntax::SourceManager sources;
+    if (const auto file = sources.load("/nonexistent/lox/script.lox"); file.has_value() || sources.size() != 0) {
+        std::cerr << "Expected loading a missing file to fail\n";
+        return false;
+    }
+    return true;
+}
+
+// Pipes cannot be mapped, so their contents must be read into a buffer instead.
+static auto test_source_manager_reads_pipe() -> bool {
+#if defined(__linux__)
+    int fds[2];
+    if (::pipe(fds) != 0) {
+        std::cerr << "Failed to create a pipe\n";
+        return false;
+    }
+
+    const std::string_view contents = "print \"piped\";";
+    const auto written = ::write(fds[1], contents.data(), contents.size());
+    ::close(fds[1]);
+
+    lox::syntax::SourceManager sources;
+    const auto file = sources.load(std::format("/dev/fd/{}", fds[0]));
+    ::close(fds[0]);
+
+    if (written != static_cast<ssize_t>(contents.size()) || !file) {
+        std::cerr << "Failed to load script from a pipe\n";
+        return false;
+    }
+    if (file.value()->is_mapped() || file.value()->text() != contents) {
+        std::cerr << "Expected the piped script to be read into a buffer\n";
+        return false;
+    }
+#endif
+    return true;
+}
+
+static auto test_line_index_locates_offsets() -> bool {
+    // Lines longer than a vector block make sure newlines are found across block boundaries.
+    const std::string long_line(70, 'x');
+    const std::string text = "a\n\nbc\n" + long_line + "\nlast";
+
+    for (const auto *kernels : lox::syntax::supported_scan_kernels()) {
+        const lox::syntax::LineIndex lines{text, *kernels};
+        if (lines.line_count() != 5 || lines.line_start(4) != 6 || lines.line_start(5) != 77) {
+            std::cerr << "Line index (" << kernels->name << ") found " << lines.line_count() << " lines\n";
+            return false;
+        }
+
+        struct Case {
+            std::size_t offset, line, column;
+        };
+        for (const auto &[offset, line, column] : {Case{0, 1, 1}, Case{1, 1, 2}, Case{2, 2, 1}, Case{4, 3, 2},
+                                                   Case{75, 4, 70}, Case{77, 5, 1}, Case{text.size(), 5, 5}}) {
+            if (const auto location = lines.locate(offset); location.line != line || location.column != column) {
+                std::cerr << "Offset " << offset << " located at " << location.to_string() << ", expected " << line
+                          << ":" << column << "\n";
+                return false;
+            }
+        }
+    }
+
+    lox::syntax::SourceManager sources;
+    const auto &file = sources.add("script.lox", "var a;\nprint a;");
+    if (const auto location = file.locate(13).to_string(); location != "script.lox:2:7") {
+        std::cerr << "Expected script.lox:2:7, got " << location << "\n";
+        return false;
+    }
+
+    return true;
+}
+
 auto main() noexcept -> int {
     // NOLINTNEXTLINE
     if (const auto tokens = test_lex_simple_snippet(); tokens.size() != 6) {
@@ -34,5 +261,11 @@ auto main() noexcept -> int {
         return EXIT_FAILURE;
     }
 
+    if (!test_scan_kernels_match_scalar() || !test_scan_kernels_same_token_stream() ||
+        !test_source_manager_maps_file() || !test_source_manager_reports_missing_file() ||
+        !test_source_manager_reads_pipe() || !test_line_index_locates_offsets()) {
+        return EXIT_FAILURE;
+    }
+
     return EXIT_SUCCESS;
 }
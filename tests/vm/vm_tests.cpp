@@ -0,0 +1,597 @@
+#include "lox/syntax/source.hpp"
+#include "lox/vm/chunk.hpp"
+#include "lox/vm/common.hpp"
+#include "lox/vm/compile.hpp"
+#include "lox/vm/globals.hpp"
+#include "lox/vm/object.hpp"
+#include "lox/vm/optimize.hpp"
+#include "lox/vm/source_map.hpp"
+#include "lox/vm/value.hpp"
+#include "lox/vm/verify.hpp"
+#include "lox/vm/vm.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <format>
+#include <limits>
+#include <print>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace {
+
+    struct RunResult {
+        lox::vm::InterpretResult result;
+        std::string out;
+        std::string err;
+    };
+
+    auto read_back(std::FILE *file) -> std::string {
+        std::string contents;
+        std::rewind(file);
+        for (int c = std::fgetc(file); c != EOF; c = std::fgetc(file)) {
+            contents.push_back(static_cast<char>(c));
+        }
+        std::fclose(file);
+        return contents;
+    }
+
+    /// Runs @p source on a fresh VM and captures what it prints.
+    auto run(const std::string_view source, const lox::vm::GcSettings gc = {}) -> RunResult {
+        auto *out = std::tmpfile();
+        auto *err = std::tmpfile();
+        lox::vm::InterpretResult result{};
+        {
+            lox::syntax::SourceManager sources;
+            const auto &file = sources.add("test.lox", std::string{source});
+            lox::vm::VirtualMachine vm{out, err, gc};
+            result = vm.interpret(file);
+        }
+        return {.result = result, .out = read_back(out), .err = read_back(err)};
+    }
+
+    auto expect_output(const std::string_view source, const std::string_view expected,
+                       const lox::vm::GcSettings gc = {}) -> bool {
+        const auto [result, out, err] = run(source, gc);
+        if (result != lox::vm::InterpretResult::ok) {
+            std::print("Expected OK, got {}: {}\n", lox::vm::interpret_result_to_string(result), err);
+            return false;
+        }
+        if (out != expected) {
+            std::print("Expected output '{}', got '{}'\n", expected, out);
+            return false;
+        }
+        return true;
+    }
+
+    auto expect_error(const std::string_view source, const lox::vm::InterpretResult expected,
+                      const std::string_view message) -> bool {
+        const auto [result, out, err] = run(source);
+        if (result != expected) {
+            std::print("Expected {}, got {}\n", lox::vm::interpret_result_to_string(expected),
+                       lox::vm::interpret_result_to_string(result));
+            return false;
+        }
+        if (err.find(message) == std::string::npos) {
+            std::print("Expected error containing '{}', got '{}'\n", message, err);
+            return false;
+        }
+        return true;
+    }
+
+} // namespace
+
+static auto test_arithmetic() -> bool {
+    return expect_output("print 1 + 2 * 3; print (1 + 2) * 3; print -4 / 2; print 10 - 2 - 3;", "7\n9\n-2\n5\n");
+}
+
+static auto test_comparison_and_equality() -> bool {
+    return expect_output("print 1 < 2; print 2 <= 1; print 3 >= 3; print 1 != 1; print nil == false; print !nil;",
+                         "true\nfalse\ntrue\nfalse\nfalse\ntrue\n");
+}
+
+static auto test_strings() -> bool {
+    return expect_output(R"(var a = "lo"; print "hel" + a; print "hel" + "lo" == "hello";)", "hello\ntrue\n");
+}
+
+static auto test_value_representation() -> bool {
+    using lox::vm::Value;
+    using lox::vm::ValueType;
+    lox::vm::Heap heap;
+    auto *const string = heap.intern(std::string_view{"s"});
+
+    const auto nan = std::numeric_limits<double>::quiet_NaN();
+    const bool kinds_round_trip =
+        Value::nil().type() == ValueType::nil && Value::boolean(false).type() == ValueType::boolean &&
+        Value::boolean(true).as_bool() && !Value::boolean(false).as_bool() &&
+        Value::number(-2.5).as_number() == -2.5 && Value::number(nan).type() == ValueType::number &&
+        Value::object(string).type() == ValueType::object && Value::object(string).as_object() == string &&
+        Value::undefined().type() == ValueType::undefined;
+    const bool equality = Value::number(0.0) == Value::number(-0.0) && Value::number(nan) != Value::number(nan) &&
+                          Value::number(0.0).bits() != Value::number(-0.0).bits() &&
+                          Value::nil() != Value::boolean(false) &&
+                          Value::object(string) == Value::object(heap.intern(std::string_view{"s"}));
+    if (!kinds_round_trip || !equality) {
+        std::print("Values lost their type or payload (round trip {}, equality {})\n", kinds_round_trip, equality);
+        return false;
+    }
+#if LOX_NAN_BOXING
+    static_assert(sizeof(Value) == sizeof(double));
+#endif
+    return expect_output("var n = 0 / 0; print n == n; print -0 == 0; print nil == false; print !0;",
+                         "false\ntrue\nfalse\nfalse\n");
+}
+
+static auto test_globals_and_locals() -> bool {
+    return expect_output("var a = 1; { var a = 2; { var b = a + 1; print b; } print a; } a = a + 10; print a;",
+                         "3\n2\n11\n");
+}
+
+static auto test_control_flow() -> bool {
+    return expect_output("if (1 > 2) print \"no\"; else print \"yes\";"
+                         "print nil or \"default\"; print false and 1;"
+                         "var i = 0; while (i < 3) { print i; i = i + 1; }"
+                         "for (var j = 0; j < 2; j = j + 1) print j * 10;",
+                         "yes\ndefault\nfalse\n0\n1\n2\n0\n10\n");
+}
+
+static auto test_functions_and_recursion() -> bool {
+    return expect_output("fun fib(n) { if (n < 2) return n; return fib(n - 1) + fib(n - 2); }"
+                         "print fib(15); fun noop() {} print noop(); print fib;",
+                         "610\nnil\n<fn fib>\n");
+}
+
+static auto test_globals_are_late_bound() -> bool {
+    using lox::vm::InterpretResult;
+    // f is compiled before g is defined; the slot exists from f's mention and is filled by the definition.
+    if (!expect_output("fun f() { return g; } var g = 1; print f(); g = 2; print f();", "1\n2\n") ||
+        !expect_error("fun f() { return g; } f(); var g;", InterpretResult::runtime_error,
+                      "Undefined variable 'g'.") ||
+        !expect_error("h = 1;", InterpretResult::runtime_error, "Undefined variable 'h'.")) {
+        return false;
+    }
+
+    // Slots outlive a single script, so later scripts on the same VM see earlier definitions.
+    auto *out = std::tmpfile();
+    lox::vm::InterpretResult first{};
+    lox::vm::InterpretResult second{};
+    {
+        lox::vm::VirtualMachine vm{out};
+        first = vm.interpret("var a = 40; fun add(b) { return a + b; }");
+        second = vm.interpret("print add(2);");
+    }
+    const auto printed = read_back(out);
+    if (first != InterpretResult::ok || second != InterpretResult::ok || printed != "42\n") {
+        std::print("Expected the second script to print 42, got '{}'\n", printed);
+        return false;
+    }
+    return true;
+}
+
+// 300 distinct literals and globals push the pool past one-byte operands; repeated literals share a slot.
+static auto test_wide_constants() -> bool {
+    std::string source;
+    std::string expected;
+    for (int i = 0; i < 300; ++i) {
+        source += std::format("var g{0} = {0}; print g{0} + 0.5;", i);
+        expected += std::format("{}\n", i + 0.5);
+    }
+    return expect_output(source, expected);
+}
+
+static auto test_constant_pool_deduplicates() -> bool {
+    lox::vm::Heap heap;
+    lox::vm::Globals globals;
+    lox::vm::Compiler compiler{heap, globals};
+    const auto function = compiler.compile(R"(print 1; print 1; print -0; print 0; print "s"; print "s"; print 1;)");
+    if (!function) {
+        std::print("Compile error: {}\n", function.error());
+        return false;
+    }
+    // 1, 0, "s", and the -0 that `-0` folds to: it prints differently from 0, so it keeps its own slot.
+    if (const auto count = function.value()->chunk.constants().size(); count != 4) {
+        std::print("Expected 4 constants, got {}\n", count);
+        return false;
+    }
+    return true;
+}
+
+static auto test_chunk_builder_freezes() -> bool {
+    lox::vm::ChunkBuilder builder;
+    const auto constant = builder.add_constant(lox::vm::Value::number(2.5));
+    builder.write(static_cast<std::uint8_t>(lox::vm::OpCode::OP_CONSTANT), 4);
+    builder.write(static_cast<std::uint8_t>(constant), 4);
+    builder.write(static_cast<std::uint8_t>(lox::vm::OpCode::OP_RETURN), 9);
+
+    auto frozen = builder.finish();
+    if (builder.size() != 0) {
+        std::print("Expected finish to empty the builder\n");
+        return false;
+    }
+
+    // Moving must carry the single allocation along without touching its contents.
+    const auto chunk = std::move(frozen);
+    if (chunk.code().size() != 3 || chunk.code()[2] != static_cast<std::uint8_t>(lox::vm::OpCode::OP_RETURN)) {
+        std::print("Unexpected code after freezing\n");
+        return false;
+    }
+    if (chunk.constants().size() != 1 || chunk.constants()[0] != lox::vm::Value::number(2.5)) {
+        std::print("Unexpected constants after freezing\n");
+        return false;
+    }
+    if (chunk.source_map().source_offset(1) != 4 || chunk.source_map().source_offset(2) != 9) {
+        std::print("Unexpected source offsets after freezing\n");
+        return false;
+    }
+    return true;
+}
+
+static auto test_peephole_fuses_sequences() -> bool {
+    using lox::vm::OpCode;
+    const auto op = [](const OpCode code) { return static_cast<std::uint8_t>(code); };
+
+    lox::vm::ChunkBuilder builder;
+    const auto three = static_cast<std::uint8_t>(builder.add_constant(lox::vm::Value::number(3)));
+    const std::vector<std::uint8_t> code = {op(OpCode::OP_GET_LOCAL),
+                                            1,
+                                            op(OpCode::OP_GET_LOCAL),
+                                            2,
+                                            op(OpCode::OP_ADD),
+                                            op(OpCode::OP_CONSTANT),
+                                            three,
+                                            op(OpCode::OP_LESS),
+                                            op(OpCode::OP_JUMP_IF_FALSE),
+                                            0,
+                                            2,
+                                            op(OpCode::OP_TRUE),
+                                            op(OpCode::OP_POP),
+                                            op(OpCode::OP_NIL),
+                                            op(OpCode::OP_RETURN)};
+    for (const auto byte : code) {
+        builder.write(byte, 0);
+    }
+
+    lox::vm::PeepholeStats stats;
+    const auto chunk = lox::vm::peephole_optimize(builder.finish(), &stats);
+
+    // The jump that skipped the dead push/pop now lands directly on OP_NIL.
+    const std::vector<std::uint8_t> expected = {op(OpCode::OP_ADD_LOCALS),
+                                                1,
+                                                2,
+                                                op(OpCode::OP_CONSTANT),
+                                                three,
+                                                op(OpCode::OP_LESS_JUMP_IF_FALSE),
+                                                0,
+                                                0,
+                                                op(OpCode::OP_NIL),
+                                                op(OpCode::OP_RETURN)};
+    if (!std::ranges::equal(chunk.code(), expected)) {
+        std::print("Unexpected optimized code\n");
+        chunk.disassemble("optimized");
+        return false;
+    }
+    if (stats.superinstructions != 2 || stats.removed_push_pops != 1) {
+        std::print("Unexpected stats: {} superinstructions, {} push/pops removed\n", stats.superinstructions,
+                   stats.removed_push_pops);
+        return false;
+    }
+    return true;
+}
+
+static auto test_peephole_keeps_short_constants() -> bool {
+    using lox::vm::OpCode;
+    const auto op = [](const OpCode code) { return static_cast<std::uint8_t>(code); };
+
+    // With 256 constants the negated value would need OP_CONSTANT_LONG, which would lengthen the jumped-over code.
+    lox::vm::ChunkBuilder builder;
+    for (int i = 0; i < 256; ++i) {
+        static_cast<void>(builder.add_constant(lox::vm::Value::number(i)));
+    }
+    const std::vector<std::uint8_t> code = {op(OpCode::OP_JUMP),
+                                            0,
+                                            3,
+                                            op(OpCode::OP_CONSTANT),
+                                            7,
+                                            op(OpCode::OP_NEGATE),
+                                            op(OpCode::OP_NIL),
+                                            op(OpCode::OP_RETURN)};
+    for (const auto byte : code) {
+        builder.write(byte, 0);
+    }
+
+    lox::vm::PeepholeStats stats;
+    const auto chunk = lox::vm::peephole_optimize(builder.finish(), &stats);
+    if (!std::ranges::equal(chunk.code(), code) || stats.folded_negations != 0) {
+        std::print("Negation was folded into a wider constant\n");
+        chunk.disassemble("optimized");
+        return false;
+    }
+    return true;
+}
+
+static auto test_optimized_code_runs() -> bool {
+    return expect_output("fun f(a, b) { var c = a + b; if (a < b) return c - 1; return c * -2; }"
+                         "print f(1, 2); print f(3, 1); print --3; print \"a\" + \"b\";"
+                         "for (var i = 0; i < 3; i = i + 1) { 1; i; }"
+                         "var n = 0; while (n < 5) n = n + 2; print n;",
+                         "2\n-8\n3\nab\n6\n") &&
+           // Removing `2; POP` moves the `and` jump's target onto the block's final POP, which must stay unfused.
+           expect_output("var a = false; { var x = a and 1; 2; } print a;", "false\n");
+}
+
+static auto test_folded_code_matches_runtime() -> bool {
+    lox::vm::Heap heap;
+    lox::vm::Globals globals;
+    lox::vm::Compiler compiler{heap, globals};
+    const auto function = compiler.compile("if (10 <= 20) print 1; else print 2; while (false) print 3;");
+    if (!function) {
+        std::print("Compile error: {}\n", function.error());
+        return false;
+    }
+    // The comparison folds to true, leaving only the then branch: the constant 1 is all that remains.
+    if (const auto count = function.value()->chunk.constants().size(); count != 1) {
+        std::print("Expected 1 constant, got {}\n", count);
+        return false;
+    }
+    if (const auto &stats = compiler.fold_stats(); stats.folded_expressions != 1 || stats.pruned_branches != 2) {
+        std::print("Unexpected stats: {} folded, {} pruned\n", stats.folded_expressions, stats.pruned_branches);
+        return false;
+    }
+
+    return expect_output("print -0; print 1 / 0; print 0 / 0 == 0 / 0; print 0.1 + 0.2 == 0.3;"
+                         "print (\"a\" + \"b\") + \"c\"; print nil or \"x\"; print 1 and false; print !(1 >= 0 / 0);",
+                         "-0\ninf\nfalse\nfalse\nabc\nx\nfalse\nfalse\n");
+}
+
+static auto test_closures_capture_variables() -> bool {
+    // A counter keeps its variable alive after the call that declared it returns.
+    return expect_output("fun make() { var n = 0; fun inc() { n = n + 1; return n; } return inc; }"
+                         "var a = make(); var b = make(); a(); print a(); print b();",
+                         "2\n1\n") &&
+           // Two closures over one variable share it, both while it is on the stack and after it is closed.
+           expect_output("var get; var set;"
+                         "{ var x = \"before\"; fun g() { return x; } fun s(v) { x = v; } get = g; set = s;"
+                         "  set(\"open\"); print x; }"
+                         "print get(); set(\"closed\"); print get();",
+                         "open\nopen\nclosed\n") &&
+           // Each loop iteration's block local is captured separately; the middle function only passes x through.
+           expect_output("var fs0; var fs1;"
+                         "for (var i = 0; i < 2; i = i + 1) { var j = i;"
+                         "  fun outer() { fun inner() { return j * 10; } return inner; }"
+                         "  if (i == 0) fs0 = outer(); else fs1 = outer(); }"
+                         "print fs0(); print fs1();",
+                         "0\n10\n") &&
+           // A local function can call itself through an upvalue.
+           expect_output("{ fun fact(n) { if (n < 2) return 1; return n * fact(n - 1); } print fact(5); }", "120\n");
+}
+
+static auto test_gc_keeps_reachable_objects() -> bool {
+    // Collecting before every allocation frees anything not reachable from a root the moment it is missed.
+    const lox::vm::GcSettings stress{.stress = true};
+    return expect_output("fun make(prefix) { var n = 0; fun next() { n = n + 1; return prefix + \"!\"; } return next; }"
+                         "var a = make(\"a\"); var b = make(\"b\");"
+                         "for (var i = 0; i < 3; i = i + 1) { a(); print b() + a(); }",
+                         "b!a!\nb!a!\nb!a!\n", stress) &&
+           expect_output("var s = \"\"; for (var i = 0; i < 5; i = i + 1) s = s + \"ab\"; print s;",
+                         "ababababab\n", stress) &&
+           expect_output("{ fun fact(n) { if (n < 2) return 1; return n * fact(n - 1); } print fact(5); }", "120\n",
+                         stress);
+}
+
+static auto test_gc_frees_garbage() -> bool {
+    // Every iteration makes a closure and the upvalue it captures, then drops both.
+    constexpr std::string_view source = "for (var i = 0; i < 50000; i = i + 1) {"
+                                        "  var x = i; fun f() { return x; } if (f() != i) print \"wrong\"; }"
+                                        "print \"done\";";
+    auto *out = std::tmpfile();
+    lox::vm::VirtualMachine vm{out, stderr, lox::vm::GcSettings{.growth_factor = 2.0, .min_threshold = 64 * 1024}};
+    if (const auto result = vm.interpret(source); result != lox::vm::InterpretResult::ok) {
+        std::print("Expected OK, got {}\n", lox::vm::interpret_result_to_string(result));
+        std::fclose(out);
+        return false;
+    }
+    if (const auto printed = read_back(out); printed != "done\n") {
+        std::print("Expected output 'done', got '{}'\n", printed);
+        return false;
+    }
+    // Without collection the loop would leave several megabytes behind.
+    const auto &stats = vm.heap_stats();
+    if (stats.collections == 0 || stats.peak_bytes > 256 * 1024) {
+        std::print("Expected a bounded heap, got {} collections peaking at {} bytes\n", stats.collections,
+                   stats.peak_bytes);
+        return false;
+    }
+    return true;
+}
+
+static auto test_compiler_records_max_stack() -> bool {
+    lox::vm::Heap heap;
+    lox::vm::Globals globals;
+    lox::vm::Compiler compiler{heap, globals};
+    const auto function =
+        compiler.compile("var a = 1; print a + a * a; fun f(x) { return x; } while (a) { if (a) a = nil; else a; }");
+    if (!function) {
+        std::print("Compile error: {}\n", function.error());
+        return false;
+    }
+    if (const auto verified = lox::vm::verify(*function.value(), globals.size()); !verified) {
+        std::print("Unexpected verifier error: {}\n", verified.error());
+        return false;
+    }
+    // The script slot plus the three reads of a before any operator runs.
+    if (const auto depth = function.value()->chunk.max_stack(); depth != 4) {
+        std::print("Expected a max stack of 4, got {}\n", depth);
+        return false;
+    }
+    // Callee, x, and the copy of x being returned.
+    for (const auto &constant : function.value()->chunk.constants()) {
+        if (lox::vm::is_obj_type(constant, lox::vm::ObjType::function)) {
+            const auto *nested = static_cast<const lox::vm::ObjFunction *>(constant.as_object());
+            if (nested->chunk.max_stack() != 3) {
+                std::print("Expected f to have a max stack of 3, got {}\n", nested->chunk.max_stack());
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static auto test_verifier_rejects_malformed_code() -> bool {
+    using lox::vm::OpCode;
+    constexpr auto op = [](const OpCode code) { return static_cast<std::uint8_t>(code); };
+
+    const auto rejects = [](const std::vector<std::uint8_t> &code, const std::string_view message,
+                            const std::size_t max_stack = 8) {
+        lox::vm::Heap heap;
+        lox::vm::ChunkBuilder builder;
+        builder.add_constant(lox::vm::Value::number(1));
+        builder.note_stack_depth(max_stack);
+        for (const auto byte : code) {
+            builder.write(byte, 0);
+        }
+        auto *function = heap.new_function();
+        function->chunk = builder.finish();
+
+        const auto verified = lox::vm::verify(*function, 0);
+        if (verified) {
+            std::print("Expected the verifier to reject code with '{}'\n", message);
+            return false;
+        }
+        if (verified.error().find(message) == std::string::npos) {
+            std::print("Expected verifier error containing '{}', got '{}'\n", message, verified.error());
+            return false;
+        }
+        return true;
+    };
+
+    return rejects({op(OpCode::OP_ADD), op(OpCode::OP_RETURN)}, "pops 2 values but the stack holds 1") &&
+           rejects({op(OpCode::OP_CONSTANT), 1, op(OpCode::OP_RETURN)}, "constant 1 out of range") &&
+           rejects({op(OpCode::OP_GET_LOCAL), 1, op(OpCode::OP_RETURN)}, "local slot 1 out of range") &&
+           rejects({op(OpCode::OP_GET_GLOBAL), 0, op(OpCode::OP_RETURN)}, "global slot 0 out of range") &&
+           rejects({op(OpCode::OP_GET_UPVALUE), 0, op(OpCode::OP_RETURN)}, "upvalue 0 out of range") &&
+           rejects({op(OpCode::OP_CLOSURE), 0, op(OpCode::OP_RETURN)}, "constant 0 is not a function") &&
+           rejects({op(OpCode::OP_NIL)}, "runs off the end") &&
+           rejects({op(OpCode::OP_CONSTANT)}, "operands run past the end") &&
+           rejects({0xff}, "unknown opcode 255") &&
+           rejects({op(OpCode::OP_JUMP), 0, 1, op(OpCode::OP_CONSTANT), 0, op(OpCode::OP_RETURN)},
+                   "jump to offset 4 is not an instruction") &&
+           rejects({op(OpCode::OP_LOOP), 0, 4, op(OpCode::OP_RETURN)}, "loops back before the start") &&
+           // Only one path pushes before the branches meet.
+           rejects({op(OpCode::OP_TRUE), op(OpCode::OP_JUMP_IF_FALSE), 0, 1, op(OpCode::OP_NIL), op(OpCode::OP_RETURN)},
+                   "reached with stack depths") &&
+           rejects({op(OpCode::OP_NIL), op(OpCode::OP_NIL), op(OpCode::OP_RETURN)},
+                   "needs 3 stack slots but the chunk records 2", 2);
+}
+
+static auto test_source_map_round_trips() -> bool {
+    std::vector<std::size_t> offsets = {0, 0, 0, 7, 7, 3, 200, 200, 200, 200, 100000, 5, 5, 100001};
+    // Enough runs to span several checkpoints.
+    for (std::size_t i = 0; i < 2000; ++i) {
+        offsets.push_back(i / 3 * 11 + (i % 5 == 0 ? 40 : 0));
+    }
+    lox::vm::SourceMapBuilder builder;
+    for (const auto offset : offsets) {
+        builder.append(offset);
+    }
+    const auto map = builder.finish();
+    if (map.size() != offsets.size()) {
+        std::print("Expected {} bytes described, got {}\n", offsets.size(), map.size());
+        return false;
+    }
+    for (std::size_t i = 0; i < offsets.size(); ++i) {
+        if (const auto offset = map.source_offset(i); offset != offsets[i]) {
+            std::print("Code byte {}: expected source offset {}, got {}\n", i, offsets[i], offset);
+            return false;
+        }
+    }
+    return true;
+}
+
+static auto test_native_clock() -> bool { return expect_output("print clock() >= 0;", "true\n"); }
+
+static auto test_runtime_error_reports_trace() -> bool {
+    const auto [result, out, err] = run("fun f() {\n  return 1 + nil;\n}\nf();\n");
+    if (result != lox::vm::InterpretResult::runtime_error) {
+        std::print("Expected runtime error, got {}\n", lox::vm::interpret_result_to_string(result));
+        return false;
+    }
+    const std::string expected = "Operands must be two numbers or two strings.\n[line 2] in f()\n[line 4] in script\n";
+    if (err != expected) {
+        std::print("Expected '{}', got '{}'\n", expected, err);
+        return false;
+    }
+    return true;
+}
+
+static auto test_runtime_errors() -> bool {
+    using lox::vm::InterpretResult;
+    return expect_error("print undefined;", InterpretResult::runtime_error, "Undefined variable 'undefined'.") &&
+           expect_error("-\"s\";", InterpretResult::runtime_error, "Operand must be a number.") &&
+           expect_error("fun f(a) {} f();", InterpretResult::runtime_error, "Expected 1 arguments but got 0.") &&
+           expect_error("\"s\"();", InterpretResult::runtime_error, "Can only call functions") &&
+           expect_error("fun f() { f(); } f();", InterpretResult::runtime_error, "Stack overflow.");
+}
+
+static auto test_compile_errors() -> bool {
+    using lox::vm::InterpretResult;
+    return expect_error("return 1;", InterpretResult::compile_error, "Can't return from top-level code.") &&
+           expect_error("{ var a = a; }", InterpretResult::compile_error, "own initializer") &&
+           expect_error("{ var a; var a; }", InterpretResult::compile_error, "Already a variable") &&
+           expect_error("if (false) return;", InterpretResult::compile_error, "Can't return from top-level code.") &&
+           expect_error("{\n  var a; var a;\n}", InterpretResult::compile_error, "test.lox:2:"); // located
+}
+
+auto main() noexcept -> int {
+    const std::vector<std::pair<std::string, bool (*)()>> tests = {
+        {"arithmetic", test_arithmetic},
+        {"comparison_and_equality", test_comparison_and_equality},
+        {"strings", test_strings},
+        {"value_representation", test_value_representation},
+        {"globals_and_locals", test_globals_and_locals},
+        {"control_flow", test_control_flow},
+        {"functions_and_recursion", test_functions_and_recursion},
+        {"globals_are_late_bound", test_globals_are_late_bound},
+        {"wide_constants", test_wide_constants},
+        {"constant_pool_deduplicates", test_constant_pool_deduplicates},
+        {"chunk_builder_freezes", test_chunk_builder_freezes},
+        {"peephole_fuses_sequences", test_peephole_fuses_sequences},
+        {"peephole_keeps_short_constants", test_peephole_keeps_short_constants},
+        {"optimized_code_runs", test_optimized_code_runs},
+        {"folded_code_matches_runtime", test_folded_code_matches_runtime},
+        {"closures_capture_variables", test_closures_capture_variables},
+        {"gc_keeps_reachable_objects", test_gc_keeps_reachable_objects},
+        {"gc_frees_garbage", test_gc_frees_garbage},
+        {"compiler_records_max_stack", test_compiler_records_max_stack},
+        {"verifier_rejects_malformed_code", test_verifier_rejects_malformed_code},
+        {"source_map_round_trips", test_source_map_round_trips},
+        {"native_clock", test_native_clock},
+        {"runtime_error_reports_trace", test_runtime_error_reports_trace},
+        {"runtime_errors", test_runtime_errors},
+        {"compile_errors", test_compile_errors}};
+
+    int failed_tests = 0;
+    for (const auto &[name, test_func] : tests) {
+        std::print("Running test: {}... ", name);
+        try {
+            if (test_func()) {
+                std::println("PASSED");
+            } else {
+                std::println("FAILED");
+                failed_tests++;
+            }
+        } catch (const std::exception &e) {
+            std::println("FAILED (exception: {})", e.what());
+            failed_tests++;
+        }
+    }
+
+    std::println("\nTest Summary: {}/{} tests passed", (tests.size() - failed_tests), tests.size());
+
+    return failed_tests == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}